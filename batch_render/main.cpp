@@ -0,0 +1,333 @@
+// Ⱦ·ȾͼƬУÿ̳߳һRenderer
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <Windows.h>
+#include <d3d9.h>
+#include "Renderer.h"
+#include "Camera.h"
+#include "CameraPath.h"
+#include "Light.h"
+#include "Scene.h"
+#include "Texture2D.h"
+#include "ImageWriter.h"
+#include "Logger.h"
+#include "util.h"
+
+using std::string;
+using std::vector;
+
+enum ImageFormat
+{
+    kPpm = 0,
+    kPng = 1
+};
+
+class BatchSettings
+{
+public:
+    BatchSettings(void)
+        :frame_count(100)
+        ,width(320)
+        ,height(240)
+        ,shading_mode(kGouraud)
+        ,format(kPng)
+        ,thread_count(0) {}
+
+    string scene_file;
+    string path_file;
+    string output_prefix;
+    string texture_file;
+    int frame_count;
+    int width;
+    int height;
+    ShadingMode shading_mode;
+    ImageFormat format;
+    // 0ʾCPU
+    int thread_count;
+};
+
+// й̹߳Ⱦڼֻ֡ͨInterlocked
+class BatchJob
+{
+public:
+    const BatchSettings *settings;
+    const CameraPath *path;
+    Scene *scene;
+    Texture2D *texture;
+    Light *light;
+    volatile LONG next_frame;
+    volatile LONG failed_frames;
+};
+
+static void print_usage(void)
+{
+    printf("usage: batch_render <scene.X> <camera_path.txt> <output_prefix> [options]\n"
+           "  -n <frames>    frame count, default 100\n"
+           "  -s <w>x<h>     resolution, default 320x240\n"
+           "  -m <mode>      frame|fill|flat|gouraud|phong, default gouraud\n"
+           "  -f <format>    ppm|png, default png\n"
+           "  -t <texture>   texture file\n"
+           "  -j <threads>   worker count, default cpu count\n");
+}
+
+static bool parse_shading_mode(const char *s, ShadingMode *mode)
+{
+    static const char *kNames[kShadingModeCount] = {"frame", "fill", "flat", "gouraud", "phong"};
+    for (int i = 0; i < kShadingModeCount; ++i)
+    {
+        if (strcmp(s, kNames[i]) == 0)
+        {
+            *mode = static_cast<ShadingMode>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parse_args(int argc, char *argv[], BatchSettings *settings)
+{
+    if (argc < 4)
+        return false;
+    settings->scene_file = argv[1];
+    settings->path_file = argv[2];
+    settings->output_prefix = argv[3];
+
+    for (int i = 4; i < argc; ++i)
+    {
+        const char *opt = argv[i];
+        if (i + 1 >= argc)
+            return false;
+        const char *value = argv[++i];
+        if (strcmp(opt, "-n") == 0)
+        {
+            settings->frame_count = atoi(value);
+        }
+        else if (strcmp(opt, "-s") == 0)
+        {
+            if (sscanf_s(value, "%dx%d", &settings->width, &settings->height) != 2)
+                return false;
+        }
+        else if (strcmp(opt, "-m") == 0)
+        {
+            if (!parse_shading_mode(value, &settings->shading_mode))
+                return false;
+        }
+        else if (strcmp(opt, "-f") == 0)
+        {
+            if (strcmp(value, "ppm") == 0)
+                settings->format = kPpm;
+            else if (strcmp(value, "png") == 0)
+                settings->format = kPng;
+            else
+                return false;
+        }
+        else if (strcmp(opt, "-t") == 0)
+        {
+            settings->texture_file = value;
+        }
+        else if (strcmp(opt, "-j") == 0)
+        {
+            settings->thread_count = atoi(value);
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return settings->frame_count > 0 && settings->width > 0 && settings->height > 0;
+}
+
+// .XȻҪD3D豸洰ڴһʾ豸
+static IDirect3DDevice9 *create_load_device(IDirect3D9 *d3d9)
+{
+    D3DPRESENT_PARAMETERS params;
+    memset(&params, 0, sizeof(params));
+    params.BackBufferWidth = 1;
+    params.BackBufferHeight = 1;
+    params.BackBufferFormat = D3DFMT_UNKNOWN;
+    params.BackBufferCount = 1;
+    params.SwapEffect = D3DSWAPEFFECT_DISCARD;
+    params.hDeviceWindow = GetDesktopWindow();
+    params.Windowed = true;
+
+    static const D3DDEVTYPE kDeviceTypes[2] = {D3DDEVTYPE_HAL, D3DDEVTYPE_REF};
+    for (int i = 0; i < 2; ++i)
+    {
+        IDirect3DDevice9 *device = nullptr;
+        HRESULT hr = d3d9->CreateDevice(D3DADAPTER_DEFAULT,
+                                        kDeviceTypes[i],
+                                        params.hDeviceWindow,
+                                        D3DCREATE_SOFTWARE_VERTEXPROCESSING,
+                                        &params,
+                                        &device);
+        if (SUCCEEDED(hr))
+            return device;
+    }
+    return nullptr;
+}
+
+static string get_frame_file(const BatchSettings &settings, int frame)
+{
+    char buf[32] = {0};
+    sprintf_s(buf, "_%04d.%s", frame, settings.format == kPng ? "png" : "ppm");
+    return settings.output_prefix + buf;
+}
+
+static DWORD WINAPI render_worker(LPVOID param)
+{
+    BatchJob *job = static_cast<BatchJob *>(param);
+    const BatchSettings &settings = *job->settings;
+
+    Renderer renderer;
+    renderer.InitializeOffscreen(settings.width, settings.height);
+    renderer.set_shading_mode(settings.shading_mode);
+    // ԴֻRenderer
+    renderer.set_light(job->light);
+    if (job->texture)
+        renderer.set_texture(job->texture);
+
+    Camera camera;
+    camera.set_far(100.0f);
+    camera.set_near(0.1f);
+    camera.set_fov(60.0f);
+    camera.set_aspect(static_cast<float>(settings.width) / settings.height);
+    renderer.set_camera(&camera);
+
+    float start = job->path->get_start_time();
+    float duration = job->path->get_end_time() - start;
+    for (;;)
+    {
+        int frame = InterlockedIncrement(&job->next_frame) - 1;
+        if (frame >= settings.frame_count)
+            break;
+
+        float t = settings.frame_count > 1 ? static_cast<float>(frame) / (settings.frame_count - 1) : 0.0f;
+        Vector3 pos;
+        Quat ori;
+        job->path->Sample(start + duration * t, &pos, &ori);
+        camera.set_pos(pos);
+        camera.set_ori(ori);
+
+        renderer.BeginFrame();
+        job->scene->Draw(&renderer);
+        renderer.EndFrame();
+
+        string file = get_frame_file(settings, frame);
+        bool ret = false;
+        if (settings.format == kPng)
+            ret = write_png(file, renderer.get_color_buffer(), settings.width, settings.height, renderer.get_pitch());
+        else
+            ret = write_ppm(file, renderer.get_color_buffer(), settings.width, settings.height, renderer.get_pitch());
+        if (!ret)
+            InterlockedIncrement(&job->failed_frames);
+    }
+
+    renderer.Uninitialize();
+    return 0;
+}
+
+static int run_batch(const BatchSettings &settings, IDirect3DDevice9 *device)
+{
+    CameraPath path;
+    if (!path.Load(settings.path_file))
+        return 1;
+
+    Scene scene;
+    scene.LoadFromXFile(settings.scene_file, device);
+    if (!scene.IsLoaded())
+        return 1;
+
+    Texture2D texture(device);
+    if (!settings.texture_file.empty())
+    {
+        // ֮߳ǰȾڼֻ
+        if (!texture.Load(settings.texture_file) || !texture.Lock())
+            return 1;
+    }
+
+    Light light;
+    light.set_position(0, 0, -1);
+    light.set_ambient(0.2f, 0.2f, 0.2f);
+    light.set_diffuse(0.7f, 0.7f, 0.7f);
+    light.set_specular(0.7f, 0.7f, 0.7f, 0.6f);
+    light.attenuation0 = 0.2f;
+    light.attenuation1 = 0.1f;
+    light.attenuation2 = 0.08f;
+
+    int thread_count = settings.thread_count;
+    if (thread_count <= 0)
+    {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        thread_count = static_cast<int>(info.dwNumberOfProcessors);
+    }
+    thread_count = clamp(thread_count, 1, min_t(settings.frame_count, static_cast<int>(MAXIMUM_WAIT_OBJECTS)));
+
+    BatchJob job;
+    job.settings = &settings;
+    job.path = &path;
+    job.scene = &scene;
+    job.texture = texture.IsLocked() ? &texture : nullptr;
+    job.light = &light;
+    job.next_frame = 0;
+    job.failed_frames = 0;
+
+    double start = get_time_ms();
+    vector<HANDLE> threads;
+    for (int i = 0; i < thread_count; ++i)
+    {
+        HANDLE thread = CreateThread(nullptr, 0, render_worker, &job, 0, nullptr);
+        if (thread)
+            threads.push_back(thread);
+    }
+    if (threads.empty())
+    {
+        GT_LOG_ERROR("create render worker failed: %d", GetLastError());
+        return 1;
+    }
+    WaitForMultipleObjects(static_cast<DWORD>(threads.size()), &threads[0], TRUE, INFINITE);
+    for (size_t i = 0; i < threads.size(); ++i)
+    {
+        CloseHandle(threads[i]);
+    }
+    double elapsed = get_time_ms() - start;
+
+    GT_LOG_INFO("rendered %d frames %dx%d with %d workers in %.1f ms, %.2f fps, %d failed",
+                settings.frame_count, settings.width, settings.height,
+                static_cast<int>(threads.size()), elapsed,
+                elapsed > 0.0 ? settings.frame_count * 1000.0 / elapsed : 0.0,
+                static_cast<int>(job.failed_frames));
+    return job.failed_frames == 0 ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+    BatchSettings settings;
+    if (!parse_args(argc, argv, &settings))
+    {
+        print_usage();
+        return 1;
+    }
+
+    IDirect3D9 *d3d9 = Direct3DCreate9(D3D_SDK_VERSION);
+    if (!d3d9)
+    {
+        GT_LOG_ERROR("Direct3DCreate9 failed");
+        return 1;
+    }
+    IDirect3DDevice9 *device = create_load_device(d3d9);
+    if (!device)
+    {
+        GT_LOG_ERROR("create load device failed: %d", GetLastError());
+        SafeRelease(&d3d9);
+        return 1;
+    }
+
+    int ret = run_batch(settings, device);
+
+    SafeRelease(&device);
+    SafeRelease(&d3d9);
+    return ret;
+}
@@ -57,7 +57,7 @@ void Renderer::Initialize(HWND hwnd, int width, int height)
                                      &d3d_device_);
     if (FAILED(hr))
     {
-        Logger::GtLogError("d3d9 CreateDevice failed: %d\n", GetLastError());
+        GT_LOG_ERROR("d3d9 CreateDevice failed: %d\n", GetLastError());
         SafeRelease(&d3d_device_);
         SafeRelease(&d3d9_);
         return;
@@ -66,7 +66,7 @@ void Renderer::Initialize(HWND hwnd, int width, int height)
     hr = d3d_device_->GetBackBuffer(0, 0, D3DBACKBUFFER_TYPE_MONO, &d3d_backbuffer_);
     if (FAILED(hr))
     {
-        Logger::GtLogError("d3d GetBackBuffer failed: %d\n", GetLastError());
+        GT_LOG_ERROR("d3d GetBackBuffer failed: %d\n", GetLastError());
         SafeRelease(&d3d_device_);
         SafeRelease(&d3d9_);
         return;
@@ -240,7 +240,7 @@ void Renderer::BeginFrame(void)
     HRESULT res = d3d_backbuffer_->LockRect(&lockinfo, NULL, D3DLOCK_DISCARD);
     if (FAILED(res))
     {
-        Logger::GtLogError("d3d LockRect failed: %d", GetLastError());
+        GT_LOG_ERROR("d3d LockRect failed: %d", GetLastError());
         return;
     }
     buffer_ = static_cast<uint32 *>(lockinfo.pBits);
@@ -36,7 +36,7 @@ public:
     void DrawPixel(int x, int y, uint32 c)
     {
         int idx = y * (pitch_ / 4) + x;
-//        Logger::GtLogInfo("idx %d", idx);
+//        GT_LOG_INFO("idx %d", idx);
         buffer_[idx] = c;
     }
 
@@ -47,7 +47,7 @@ public:
         HRESULT res = d3d_backbuffer_->GetDC(&hdc);
         if (FAILED(res))
         {
-            Logger::GtLogError("d3d9 GetDC failed: %d", GetLastError());
+            GT_LOG_ERROR("d3d9 GetDC failed: %d", GetLastError());
             return;
         }
 
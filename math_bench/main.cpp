@@ -0,0 +1,436 @@
+// ѧ΢׼vector.hmatrix.hquaternion.hж·õ㣬Լİ汾
+// ÿԤȲ궨ÿĵȡÿʱķλ
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <Windows.h>
+#include <emmintrin.h>
+#include "vector.h"
+#include "matrix.h"
+#include "quaternion.h"
+#include "Logger.h"
+
+using std::string;
+using std::vector;
+
+// ĳȣݶL1/L2
+static const int kBatch = 1024;
+// ÿĿʱ
+static const double kSampleMs = 2.0;
+static const int kWarmupSamples = 3;
+
+class BenchSettings
+{
+public:
+    BenchSettings(void)
+        :samples(51) {}
+
+    // ֻаfilter
+    string filter;
+    int samples;
+};
+
+// ÿ׼count㣬ֵۼӵsinkֹŻ
+typedef float (*BenchFunc)(int count);
+
+class BenchEntry
+{
+public:
+    const char *name;
+    BenchFunc func;
+};
+
+// ݣʱ
+static Vector3 g_vec3_a[kBatch];
+static Vector3 g_vec3_b[kBatch];
+static Vector3 g_vec3_out[kBatch];
+static Vector4 g_vec4_a[kBatch];
+static Vector4 g_vec4_b[kBatch];
+static Vector4 g_vec4_out[kBatch];
+static Matrix33 g_mat33[kBatch];
+static Matrix44 g_mat44[kBatch];
+static Matrix44 g_mat44_out[kBatch];
+static Quat g_quat[kBatch];
+// 任SoAÿ__m128Ϊ4ͬһ
+static __m128 g_soa_x[kBatch / 4];
+static __m128 g_soa_y[kBatch / 4];
+static __m128 g_soa_z[kBatch / 4];
+static __m128 g_soa_out[4][kBatch / 4];
+
+static volatile float g_sink;
+
+static float random_float(void)
+{
+    return static_cast<float>(rand()) / RAND_MAX * 2.0f - 1.0f;
+}
+
+static void init_data(void)
+{
+    srand(12345);
+    for (int i = 0; i < kBatch; ++i)
+    {
+        g_vec3_a[i] = Vector3(random_float(), random_float(), random_float());
+        g_vec3_b[i] = Vector3(random_float(), random_float(), random_float());
+        g_vec4_a[i] = Vector4(random_float(), random_float(), random_float(), 1.0f);
+        g_vec4_b[i] = Vector4(random_float(), random_float(), random_float(), 1.0f);
+
+        // תżƽƣ֤
+        Quat q = Quat::GetRotationX(random_float() * 180.0f) * Quat::GetRotationY(random_float() * 180.0f);
+        g_quat[i] = q;
+        Matrix33 r = q.GetMatrix33();
+        Matrix33 s;
+        s.SetScaling(1.5f + random_float(), 1.5f + random_float(), 1.5f + random_float());
+        g_mat33[i] = r * s;
+        g_mat44[i] = Matrix44::CreateIdentity();
+        g_mat44[i].SetMatrix33(g_mat33[i]);
+        g_mat44[i].SetTranslation(random_float(), random_float(), random_float());
+
+        reinterpret_cast<float *>(g_soa_x)[i] = g_vec3_a[i].x;
+        reinterpret_cast<float *>(g_soa_y)[i] = g_vec3_a[i].y;
+        reinterpret_cast<float *>(g_soa_z)[i] = g_vec3_a[i].z;
+    }
+}
+
+static float bench_vec3_add(int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        int k = i & (kBatch - 1);
+        g_vec3_out[k] = g_vec3_a[k] + g_vec3_b[k];
+    }
+    return g_vec3_out[0].x;
+}
+
+static float bench_vec3_dot(int count)
+{
+    float sum = 0.0f;
+    for (int i = 0; i < count; ++i)
+    {
+        int k = i & (kBatch - 1);
+        sum += DotProduct(g_vec3_a[k], g_vec3_b[k]);
+    }
+    return sum;
+}
+
+static float bench_vec3_cross(int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        int k = i & (kBatch - 1);
+        g_vec3_out[k] = CrossProduct(g_vec3_a[k], g_vec3_b[k]);
+    }
+    return g_vec3_out[0].x;
+}
+
+static float bench_vec3_normalize(int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        int k = i & (kBatch - 1);
+        Vector3 v = g_vec3_a[k];
+        v.SetNormalize();
+        g_vec3_out[k] = v;
+    }
+    return g_vec3_out[0].x;
+}
+
+static float bench_vec4_lerp(int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        int k = i & (kBatch - 1);
+        g_vec4_out[k] = g_vec4_a[k] + (g_vec4_b[k] - g_vec4_a[k]) * 0.25f;
+    }
+    return g_vec4_out[0].x;
+}
+
+static float bench_vec3_mul_mat33(int count)
+{
+    const Matrix33 &m = g_mat33[0];
+    for (int i = 0; i < count; ++i)
+    {
+        int k = i & (kBatch - 1);
+        g_vec3_out[k] = g_vec3_a[k] * m;
+    }
+    return g_vec3_out[0].x;
+}
+
+static float bench_vec4_mul_mat44(int count)
+{
+    const Matrix44 &m = g_mat44[0];
+    for (int i = 0; i < count; ++i)
+    {
+        int k = i & (kBatch - 1);
+        g_vec4_out[k] = g_vec4_a[k] * m;
+    }
+    return g_vec4_out[0].x;
+}
+
+static float bench_mat33_inverse(int count)
+{
+    float sum = 0.0f;
+    for (int i = 0; i < count; ++i)
+    {
+        Matrix33 m = g_mat33[i & (kBatch - 1)];
+        m.SetInverse();
+        sum += m.m00;
+    }
+    return sum;
+}
+
+static float bench_mat44_mul(int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        int k = i & (kBatch - 1);
+        // operator*constȸ
+        Matrix44 m = g_mat44[k];
+        g_mat44_out[k] = m * g_mat44[(k + 1) & (kBatch - 1)];
+    }
+    return g_mat44_out[0].m00;
+}
+
+static float bench_quat_to_mat33(int count)
+{
+    float sum = 0.0f;
+    for (int i = 0; i < count; ++i)
+    {
+        Matrix33 m = g_quat[i & (kBatch - 1)].GetMatrix33();
+        sum += m.m00 + m.m11;
+    }
+    return sum;
+}
+
+static float bench_quat_mul(int count)
+{
+    float sum = 0.0f;
+    for (int i = 0; i < count; ++i)
+    {
+        int k = i & (kBatch - 1);
+        Quat q = g_quat[k] * g_quat[(k + 1) & (kBatch - 1)];
+        sum += q.w;
+    }
+    return sum;
+}
+
+static float bench_quat_slerp(int count)
+{
+    float sum = 0.0f;
+    for (int i = 0; i < count; ++i)
+    {
+        int k = i & (kBatch - 1);
+        Quat q = Slerp(g_quat[k], g_quat[(k + 1) & (kBatch - 1)], 0.3f);
+        sum += q.w;
+    }
+    return sum;
+}
+
+// Ϊ汾countƣRenderer::TransformVerticesѭͬ
+static float bench_batch_transform_aos(int count)
+{
+    const Matrix44 &m = g_mat44[0];
+    for (int done = 0; done < count; done += kBatch)
+    {
+        int n = min_t(kBatch, count - done);
+        for (int k = 0; k < n; ++k)
+        {
+            const Vector3 &p = g_vec3_a[k];
+            g_vec4_out[k] = Vector4(p.x, p.y, p.z, 1.0f) * m;
+        }
+    }
+    return g_vec4_out[0].x;
+}
+
+// ͬı任SoAһδ4㣬ΪǷĶ
+static float bench_batch_transform_soa_sse(int count)
+{
+    const Matrix44 &m = g_mat44[0];
+    __m128 c[4][4];
+    for (int row = 0; row < 4; ++row)
+    {
+        for (int col = 0; col < 4; ++col)
+        {
+            c[row][col] = _mm_set1_ps(m.e[row][col]);
+        }
+    }
+    for (int done = 0; done < count; done += kBatch)
+    {
+        int n = min_t(kBatch, count - done);
+        for (int k = 0; k < n / 4; ++k)
+        {
+            __m128 x = g_soa_x[k];
+            __m128 y = g_soa_y[k];
+            __m128 z = g_soa_z[k];
+            for (int col = 0; col < 4; ++col)
+            {
+                g_soa_out[col][k] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, c[0][col]), _mm_mul_ps(y, c[1][col])),
+                                               _mm_add_ps(_mm_mul_ps(z, c[2][col]), c[3][col]));
+            }
+        }
+    }
+    return _mm_cvtss_f32(g_soa_out[0][0]);
+}
+
+static float bench_batch_normal(int count)
+{
+    const Matrix33 &m = g_mat33[0];
+    for (int done = 0; done < count; done += kBatch)
+    {
+        int n = min_t(kBatch, count - done);
+        for (int k = 0; k < n; ++k)
+        {
+            Vector3 v = g_vec3_b[k] * m;
+            v.SetNormalize();
+            g_vec3_out[k] = v;
+        }
+    }
+    return g_vec3_out[0].x;
+}
+
+// ÿʵmodel_viewͷ߾RendererInstanceMatrixļͬ
+static float bench_batch_instance_matrices(int count)
+{
+    const Matrix44 &view = g_mat44[0];
+    float sum = 0.0f;
+    for (int i = 0; i < count; ++i)
+    {
+        int k = i & (kBatch - 1);
+        Matrix44 model_view = g_mat44[k];
+        model_view = model_view * view;
+        Matrix33 normal = model_view.GetMatrix33();
+        normal.SetInverse();
+        normal.SetTranspose();
+        g_mat44_out[k] = model_view;
+        sum += normal.m00;
+    }
+    return sum;
+}
+
+static const BenchEntry kBenches[] =
+{
+    {"vec3_add", bench_vec3_add},
+    {"vec3_dot", bench_vec3_dot},
+    {"vec3_cross", bench_vec3_cross},
+    {"vec3_normalize", bench_vec3_normalize},
+    {"vec4_lerp", bench_vec4_lerp},
+    {"vec3_mul_mat33", bench_vec3_mul_mat33},
+    {"vec4_mul_mat44", bench_vec4_mul_mat44},
+    {"mat33_inverse", bench_mat33_inverse},
+    {"mat44_mul", bench_mat44_mul},
+    {"quat_to_mat33", bench_quat_to_mat33},
+    {"quat_mul", bench_quat_mul},
+    {"quat_slerp", bench_quat_slerp},
+    {"batch_transform_aos", bench_batch_transform_aos},
+    {"batch_transform_soa_sse", bench_batch_transform_soa_sse},
+    {"batch_normal", bench_batch_normal},
+    {"batch_instance_matrices", bench_batch_instance_matrices},
+};
+
+static double g_counter_to_ns;
+
+static long long read_counter(void)
+{
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return counter.QuadPart;
+}
+
+// һÿ
+static double run_sample(BenchFunc func, int count)
+{
+    long long start = read_counter();
+    g_sink = func(count);
+    long long end = read_counter();
+    return (end - start) * g_counter_to_ns / count;
+}
+
+static void run_bench(const BenchEntry &bench, int samples)
+{
+    // 궨ֱһkSampleMsͬʱԤ
+    int count = kBatch;
+    for (;;)
+    {
+        double ns = run_sample(bench.func, count);
+        if (ns * count >= kSampleMs * 1e6 || count >= (1 << 28))
+            break;
+        count *= 2;
+    }
+    for (int i = 0; i < kWarmupSamples; ++i)
+    {
+        run_sample(bench.func, count);
+    }
+
+    vector<double> times(samples);
+    for (int i = 0; i < samples; ++i)
+    {
+        times[i] = run_sample(bench.func, count);
+    }
+    std::sort(times.begin(), times.end());
+    double p50 = times[samples / 2];
+    double p90 = times[min_t(samples - 1, samples * 90 / 100)];
+    double p99 = times[min_t(samples - 1, samples * 99 / 100)];
+    GT_LOG_INFO("%-26s min %8.3f  p50 %8.3f  p90 %8.3f  p99 %8.3f ns/op  %8.2f Mop/s",
+                bench.name, times[0], p50, p90, p99, p50 > 0.0 ? 1000.0 / p50 : 0.0);
+}
+
+static void print_usage(void)
+{
+    printf("usage: math_bench [options]\n"
+           "  -f <name>      run benchmarks whose name contains <name>\n"
+           "  -s <samples>   samples per benchmark, default 51\n");
+}
+
+static bool parse_args(int argc, char *argv[], BenchSettings *settings)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *opt = argv[i];
+        if (i + 1 >= argc)
+            return false;
+        const char *value = argv[++i];
+        if (strcmp(opt, "-f") == 0)
+        {
+            settings->filter = value;
+        }
+        else if (strcmp(opt, "-s") == 0)
+        {
+            settings->samples = atoi(value);
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return settings->samples > 0;
+}
+
+int main(int argc, char *argv[])
+{
+    BenchSettings settings;
+    if (!parse_args(argc, argv, &settings))
+    {
+        print_usage();
+        return 1;
+    }
+
+    // ̶һϲȼǨƺռĶ
+    SetThreadAffinityMask(GetCurrentThread(), 1);
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+
+    LARGE_INTEGER freq;
+    QueryPerformanceFrequency(&freq);
+    g_counter_to_ns = 1e9 / static_cast<double>(freq.QuadPart);
+
+    init_data();
+    int count = sizeof(kBenches) / sizeof(kBenches[0]);
+    for (int i = 0; i < count; ++i)
+    {
+        if (!settings.filter.empty() && strstr(kBenches[i].name, settings.filter.c_str()) == nullptr)
+            continue;
+        run_bench(kBenches[i], settings.samples);
+    }
+    Logger::Instance().Flush();
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,543 @@
+// عԣ̶һ鳡ÿɫģʽ˷ʽȾοͼƬȽϣ
+// ͬʱ¼ÿ֡ʱ䣬Ȼ׼ֵҲʧ
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <Windows.h>
+#include <d3d9.h>
+#include "Renderer.h"
+#include "Camera.h"
+#include "Light.h"
+#include "Scene.h"
+#include "Texture2D.h"
+#include "NormalMap.h"
+#include "MeshLod.h"
+#include "ImageWriter.h"
+#include "Logger.h"
+#include "util.h"
+
+using std::string;
+using std::vector;
+using std::map;
+
+// οͼƬķֱʣĶҪ-u
+static const int kWidth = 320;
+static const int kHeight = 240;
+// ʱǰȾ֡
+static const int kWarmupFrames = 2;
+
+class RegressionSettings
+{
+public:
+    RegressionSettings(void)
+        :res_dir("..\\res")
+        ,golden_dir("..\\res\\golden")
+        ,update(false)
+        ,frames(20)
+        ,tolerance(8)
+        ,max_bad_ratio(0.001f)
+        ,time_threshold(0.25f)
+        ,time_slack(0.2f) {}
+
+    string res_dir;
+    string golden_dir;
+    // ɲοͼƬ֡ʱ׼
+    bool update;
+    int frames;
+    // ֵͨ
+    int tolerance;
+    // toleranceر
+    float max_bad_ratio;
+    // ֡ʱȻ׼ı
+    float time_threshold;
+    // ֡ʱľ룬̵ܱ
+    float time_slack;
+};
+
+// һget_primitiveɵͼԪ.X
+class RegressionScene
+{
+public:
+    RegressionScene(void)
+        :primitive(nullptr)
+        ,scene(nullptr)
+        ,normal_map(nullptr)
+    {
+        world = Matrix44::CreateIdentity();
+    }
+
+    string name;
+    Primitive *primitive;
+    Scene *scene;
+    // ΪʱֻPhongģʽͼԪ
+    const NormalMap *normal_map;
+    // ֻͼԪƽŵҪת
+    Matrix44 world;
+    Vector3 camera_pos;
+};
+
+class RegressionCase
+{
+public:
+    string name;
+    const RegressionScene *scene;
+    ShadingMode mode;
+    // ʹʱtextureΪfalse
+    bool texture;
+    FilteringType filtering;
+};
+
+class RegressionResult
+{
+public:
+    RegressionResult(void)
+        :image_ok(false)
+        ,time_ok(false)
+        ,ms(0.0)
+        ,baseline_ms(0.0)
+        ,max_diff(0)
+        ,bad_pixels(0) {}
+
+    bool image_ok;
+    bool time_ok;
+    double ms;
+    double baseline_ms;
+    int max_diff;
+    int bad_pixels;
+};
+
+static void print_usage(void)
+{
+    printf("usage: regression [options]\n"
+           "  -r <dir>       resource dir with x\\tube.X and x\\tex2.bmp, default ..\\res\n"
+           "  -g <dir>       reference image dir, default ..\\res\\golden\n"
+           "  -u             write reference images and timings instead of comparing\n"
+           "  -n <frames>    timed frames per case, default 20\n"
+           "  -t <value>     per-channel tolerance, default 8\n"
+           "  -p <percent>   allowed slowdown against the timing baseline, default 25\n");
+}
+
+static bool parse_args(int argc, char *argv[], RegressionSettings *settings)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *opt = argv[i];
+        if (strcmp(opt, "-u") == 0)
+        {
+            settings->update = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+            return false;
+        const char *value = argv[++i];
+        if (strcmp(opt, "-r") == 0)
+        {
+            settings->res_dir = value;
+        }
+        else if (strcmp(opt, "-g") == 0)
+        {
+            settings->golden_dir = value;
+        }
+        else if (strcmp(opt, "-n") == 0)
+        {
+            settings->frames = atoi(value);
+        }
+        else if (strcmp(opt, "-t") == 0)
+        {
+            settings->tolerance = atoi(value);
+        }
+        else if (strcmp(opt, "-p") == 0)
+        {
+            settings->time_threshold = static_cast<float>(atof(value)) / 100.0f;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return settings->frames > 0 && settings->tolerance >= 0 && settings->time_threshold >= 0.0f;
+}
+
+// .XȻҪD3D豸洰ڴһʾ豸
+static IDirect3DDevice9 *create_load_device(IDirect3D9 *d3d9)
+{
+    D3DPRESENT_PARAMETERS params;
+    memset(&params, 0, sizeof(params));
+    params.BackBufferWidth = 1;
+    params.BackBufferHeight = 1;
+    params.BackBufferFormat = D3DFMT_UNKNOWN;
+    params.BackBufferCount = 1;
+    params.SwapEffect = D3DSWAPEFFECT_DISCARD;
+    params.hDeviceWindow = GetDesktopWindow();
+    params.Windowed = true;
+
+    static const D3DDEVTYPE kDeviceTypes[2] = {D3DDEVTYPE_HAL, D3DDEVTYPE_REF};
+    for (int i = 0; i < 2; ++i)
+    {
+        IDirect3DDevice9 *device = nullptr;
+        HRESULT hr = d3d9->CreateDevice(D3DADAPTER_DEFAULT,
+                                        kDeviceTypes[i],
+                                        params.hDeviceWindow,
+                                        D3DCREATE_SOFTWARE_VERTEXPROCESSING,
+                                        &params,
+                                        &device);
+        if (SUCCEEDED(hr))
+            return device;
+    }
+    return nullptr;
+}
+
+static void build_cases(const vector<RegressionScene> &scenes, vector<RegressionCase> *cases)
+{
+    static const char *kModeNames[kShadingModeCount] = {"frame", "fill", "flat", "gouraud", "phong"};
+    for (size_t i = 0; i < scenes.size(); ++i)
+    {
+        for (int m = 0; m < kShadingModeCount; ++m)
+        {
+            // ͼֻPhongģʽЧ
+            if (scenes[i].normal_map && m != kPhong)
+                continue;
+            // ߿ģʽ
+            int variants = m == kFrame ? 1 : 3;
+            for (int v = 0; v < variants; ++v)
+            {
+                RegressionCase c;
+                c.scene = &scenes[i];
+                c.mode = static_cast<ShadingMode>(m);
+                c.texture = v > 0;
+                c.filtering = v == 2 ? kBilinterFiltering : kNoneFiltering;
+                c.name = scenes[i].name + "_" + kModeNames[m];
+                if (c.texture)
+                    c.name += c.filtering == kBilinterFiltering ? "_bilinear" : "_point";
+                cases->push_back(c);
+            }
+        }
+    }
+}
+
+static void draw_scene(Renderer *renderer, const RegressionScene &scene)
+{
+    renderer->BeginFrame();
+    if (scene.scene)
+        scene.scene->Draw(renderer);
+    else
+        renderer->DrawPrimitive(scene.primitive, scene.world);
+    renderer->EndFrame();
+}
+
+// ؼʱ֡λ
+static double render_case(Renderer *renderer, Camera *camera, Texture2D *texture,
+                          const RegressionCase &c, int frames)
+{
+    camera->set_pos(c.scene->camera_pos);
+    camera->set_ori(Quat::GetIdentity());
+    renderer->set_shading_mode(c.mode);
+    renderer->set_normal_map(c.scene->normal_map);
+    if (c.texture && texture)
+    {
+        texture->set_filtering(c.filtering);
+        renderer->set_texture(texture);
+    }
+    else
+    {
+        renderer->set_texture(nullptr);
+    }
+
+    for (int i = 0; i < kWarmupFrames; ++i)
+    {
+        draw_scene(renderer, *c.scene);
+    }
+    vector<double> times(frames);
+    for (int i = 0; i < frames; ++i)
+    {
+        double start = get_time_ms();
+        draw_scene(renderer, *c.scene);
+        times[i] = get_time_ms() - start;
+    }
+    std::sort(times.begin(), times.end());
+    return times[frames / 2];
+}
+
+static void compare_image(const uint32 *actual, int pitch, const vector<uint32> &expected,
+                          int tolerance, RegressionResult *result)
+{
+    result->max_diff = 0;
+    result->bad_pixels = 0;
+    for (int y = 0; y < kHeight; ++y)
+    {
+        const uint32 *row = reinterpret_cast<const uint32 *>(reinterpret_cast<const uint8 *>(actual) + y * pitch);
+        for (int x = 0; x < kWidth; ++x)
+        {
+            uint32 a = row[x];
+            uint32 b = expected[y * kWidth + x];
+            int diff = 0;
+            for (int shift = 0; shift < 24; shift += 8)
+            {
+                int da = static_cast<int>((a >> shift) & 0xff) - static_cast<int>((b >> shift) & 0xff);
+                diff = max_t(diff, da < 0 ? -da : da);
+            }
+            result->max_diff = max_t(result->max_diff, diff);
+            if (diff > tolerance)
+                ++result->bad_pixels;
+        }
+    }
+}
+
+// ׼ļÿΪ 롱#ͷΪע
+static void load_timings(const string &file, map<string, double> *timings)
+{
+    FILE *fp = nullptr;
+    if (fopen_s(&fp, file.c_str(), "r") != 0 || !fp)
+        return;
+    char line[256] = {0};
+    while (fgets(line, sizeof(line), fp))
+    {
+        if (line[0] == '#')
+            continue;
+        char name[128] = {0};
+        double ms = 0.0;
+        if (sscanf_s(line, "%127s %lf", name, static_cast<unsigned>(sizeof(name)), &ms) == 2)
+            (*timings)[name] = ms;
+    }
+    fclose(fp);
+}
+
+static bool save_timings(const string &file, const vector<RegressionCase> &cases, const vector<RegressionResult> &results)
+{
+    FILE *fp = nullptr;
+    if (fopen_s(&fp, file.c_str(), "w") != 0 || !fp)
+    {
+        GT_LOG_ERROR("open timing file failed: %s", file.c_str());
+        return false;
+    }
+    fprintf(fp, "# case median_frame_ms\n");
+    for (size_t i = 0; i < cases.size(); ++i)
+    {
+        fprintf(fp, "%s %.3f\n", cases[i].name.c_str(), results[i].ms);
+    }
+    fclose(fp);
+    return true;
+}
+
+static int run_regression(const RegressionSettings &settings, IDirect3DDevice9 *device)
+{
+    Primitive primitives[kPrimitiveSize];
+    static const char *kPrimitiveNames[kPrimitiveSize] = {"triangle_out", "triangle_in", "square", "pyramid"};
+    vector<RegressionScene> scenes;
+    for (int i = 0; i < kPrimitiveSize; ++i)
+    {
+        get_primitive(static_cast<PrimitiveType>(i), &primitives[i]);
+        RegressionScene scene;
+        scene.name = kPrimitiveNames[i];
+        scene.primitive = &primitives[i];
+        scene.world.SetMatrix33(Quat::GetRotationX(-30.0f).GetMatrix33());
+        scene.camera_pos = Vector3(0.0f, 0.3f, -3.0f);
+        scenes.push_back(scene);
+    }
+
+    // ߵΣһųɵĸ߶ͼǷͼɫ
+    IndexedMesh square_mesh;
+    for (int i = 0; i < primitives[kSquare].size; ++i)
+    {
+        square_mesh.positions.push_back(primitives[kSquare].positions[i]);
+        square_mesh.normals.push_back(primitives[kSquare].normals[i]);
+        square_mesh.uvs.push_back(primitives[kSquare].uvs[i]);
+        square_mesh.indices.push_back(i);
+    }
+    square_mesh.ComputeTangents();
+    Primitive bumped_square;
+    square_mesh.ToPrimitive(&bumped_square);
+
+    const int kBumpSize = 64;
+    vector<uint8> heights(kBumpSize * kBumpSize);
+    for (int y = 0; y < kBumpSize; ++y)
+    {
+        for (int x = 0; x < kBumpSize; ++x)
+        {
+            float h = sinf(x * (2.0f * gkPi / 16.0f)) * sinf(y * (2.0f * gkPi / 16.0f));
+            heights[y * kBumpSize + x] = static_cast<uint8>(127.5f + 127.5f * h);
+        }
+    }
+    NormalMap normal_map;
+    normal_map.Build(&heights[0], kBumpSize, kBumpSize, 8.0f);
+
+    RegressionScene bumped_scene;
+    bumped_scene.name = "square_normal_map";
+    bumped_scene.primitive = &bumped_square;
+    bumped_scene.normal_map = &normal_map;
+    bumped_scene.world.SetMatrix33(Quat::GetRotationX(-30.0f).GetMatrix33());
+    bumped_scene.camera_pos = Vector3(0.0f, 0.3f, -1.5f);
+    scenes.push_back(bumped_scene);
+
+    Scene tube;
+    tube.LoadFromXFile(settings.res_dir + "\\x\\tube.X", device);
+    if (!tube.IsLoaded())
+        return 1;
+    RegressionScene tube_scene;
+    tube_scene.name = "tube";
+    tube_scene.scene = &tube;
+    tube_scene.camera_pos = Vector3(0.0f, 0.0f, -3.0f);
+    scenes.push_back(tube_scene);
+
+    Texture2D texture(device);
+    if (!texture.Load(settings.res_dir + "\\x\\tex2.bmp") || !texture.Lock())
+        return 1;
+
+    Light light;
+    light.set_position(0, 0, -1);
+    light.set_ambient(0.2f, 0.2f, 0.2f);
+    light.set_diffuse(0.7f, 0.7f, 0.7f);
+    light.set_specular(0.7f, 0.7f, 0.7f, 0.6f);
+    light.attenuation0 = 0.2f;
+    light.attenuation1 = 0.1f;
+    light.attenuation2 = 0.08f;
+
+    Material material;
+    material.power = 1;
+    material.ambient = Vector4(0.3f, 0.3f, 0.3f, 1.0f);
+    material.diffuse = Vector4(0.6f, 0.8f, 0.6f, 1.0f);
+    material.specular = Vector4(0.6f, 0.8f, 0.6f, 1.0f);
+    for (int i = 0; i < kPrimitiveSize; ++i)
+    {
+        primitives[i].material = &material;
+    }
+    bumped_square.material = &material;
+
+    Camera camera;
+    camera.set_far(100.0f);
+    camera.set_near(0.1f);
+    camera.set_fov(60.0f);
+    camera.set_aspect(static_cast<float>(kWidth) / kHeight);
+
+    Renderer renderer;
+    renderer.InitializeOffscreen(kWidth, kHeight);
+    renderer.set_light(&light);
+    renderer.set_camera(&camera);
+
+    vector<RegressionCase> cases;
+    build_cases(scenes, &cases);
+    vector<RegressionResult> results(cases.size());
+
+    // οͼƬύ֡ʱأֻڱ
+    string timing_file = settings.golden_dir + "\\timings.txt";
+    map<string, double> baseline;
+    if (settings.update)
+        CreateDirectory(settings.golden_dir.c_str(), NULL);
+    else
+        load_timings(timing_file, &baseline);
+
+    int failed = 0;
+    double mode_ms[kShadingModeCount] = {0.0};
+    int max_bad_pixels = static_cast<int>(kWidth * kHeight * settings.max_bad_ratio);
+    for (size_t i = 0; i < cases.size(); ++i)
+    {
+        const RegressionCase &c = cases[i];
+        RegressionResult &result = results[i];
+        result.ms = render_case(&renderer, &camera, &texture, c, settings.frames);
+        mode_ms[c.mode] += result.ms;
+
+        string image_file = settings.golden_dir + "\\" + c.name + ".ppm";
+        if (settings.update)
+        {
+            result.image_ok = write_ppm(image_file, renderer.get_color_buffer(), kWidth, kHeight, renderer.get_pitch());
+            result.time_ok = true;
+            if (!result.image_ok)
+                ++failed;
+            continue;
+        }
+
+        vector<uint32> expected;
+        int width = 0;
+        int height = 0;
+        if (read_ppm(image_file, &expected, &width, &height) && width == kWidth && height == kHeight)
+        {
+            compare_image(renderer.get_color_buffer(), renderer.get_pitch(), expected, settings.tolerance, &result);
+            result.image_ok = result.bad_pixels <= max_bad_pixels;
+        }
+        else
+        {
+            GT_LOG_ERROR("%s: missing reference image %s, run with -u", c.name.c_str(), image_file.c_str());
+        }
+        if (!result.image_ok)
+        {
+            // ʵʽԱ
+            write_ppm(c.name + "_actual.ppm", renderer.get_color_buffer(), kWidth, kHeight, renderer.get_pitch());
+        }
+
+        map<string, double>::const_iterator it = baseline.find(c.name);
+        if (it == baseline.end())
+        {
+            // ûл׼ʱж
+            result.time_ok = true;
+        }
+        else
+        {
+            result.baseline_ms = it->second;
+            result.time_ok = result.ms <= result.baseline_ms * (1.0 + settings.time_threshold)
+                          || result.ms - result.baseline_ms <= settings.time_slack;
+        }
+
+        if (result.image_ok && result.time_ok)
+        {
+            GT_LOG_INFO("%-28s ok    %.3f ms (base %.3f), max diff %d",
+                        c.name.c_str(), result.ms, result.baseline_ms, result.max_diff);
+        }
+        else
+        {
+            ++failed;
+            GT_LOG_ERROR("%-28s FAIL  %.3f ms (base %.3f)%s, max diff %d, %d pixels over tolerance%s",
+                         c.name.c_str(), result.ms, result.baseline_ms, result.time_ok ? "" : " too slow",
+                         result.max_diff, result.bad_pixels, result.image_ok ? "" : ", image mismatch");
+        }
+    }
+
+    if (settings.update && !save_timings(timing_file, cases, results))
+        ++failed;
+
+    static const char *kModeNames[kShadingModeCount] = {"frame", "fill", "flat", "gouraud", "phong"};
+    for (int m = 0; m < kShadingModeCount; ++m)
+    {
+        GT_LOG_INFO("mode %-8s total %.3f ms", kModeNames[m], mode_ms[m]);
+    }
+    GT_LOG_INFO("%d cases, %d failed%s", static_cast<int>(cases.size()), failed,
+                settings.update ? ", references updated" : "");
+
+    renderer.set_texture(nullptr);
+    renderer.Uninitialize();
+    return failed == 0 ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+    RegressionSettings settings;
+    if (!parse_args(argc, argv, &settings))
+    {
+        print_usage();
+        return 1;
+    }
+
+    IDirect3D9 *d3d9 = Direct3DCreate9(D3D_SDK_VERSION);
+    if (!d3d9)
+    {
+        GT_LOG_ERROR("Direct3DCreate9 failed");
+        return 1;
+    }
+    IDirect3DDevice9 *device = create_load_device(d3d9);
+    if (!device)
+    {
+        GT_LOG_ERROR("create load device failed: %d", GetLastError());
+        SafeRelease(&d3d9);
+        return 1;
+    }
+
+    int ret = run_regression(settings, device);
+    Logger::Instance().Flush();
+
+    SafeRelease(&device);
+    SafeRelease(&d3d9);
+    return ret;
+}
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "App.h"
 #include "Logger.h"
 #include "util.h"
+#include "Benchmark.h"
 
 // DemoApp constructor
 App::App()
@@ -69,8 +70,8 @@ HWND App::Initialize(HINSTANCE inst, int width, int height)
     renderer_.Initialize(wnd_, client.right - client.left, client.bottom - client.top);
 
     camera_.set_pos(Vector3(0, 0, -1));
-    camera_.set_far(1.0);
-    camera_.set_near(-1);
+    camera_.set_far(100.0f);
+    camera_.set_near(0.1f);
     camera_.set_fov(60);
     float aspect = static_cast<float>(width) / static_cast<float> (height);
     camera_.set_aspect(aspect);
@@ -118,7 +119,10 @@ HWND App::Initialize(HINSTANCE inst, int width, int height)
     //assert(ret);
     //ret = bumpmap_.Lock();
     //assert(ret);
-    //renderer_.set_bumpmap(&bumpmap_);
+    //ret = normal_map_.Build(&bumpmap_, 4.0f);
+    //assert(ret);
+    //bumpmap_.UnLock();
+    //renderer_.set_normal_map(&normal_map_);
 
     scene_.LoadFromXFile("C:\\src\\git\\soft-renderer\\res\\x\\tube.X", renderer_.get_device());
 
@@ -257,6 +261,130 @@ void App::Update(void)
         texture_.set_filtering(static_cast<FilteringType>(filt));
     }
 
+    renderer_.set_camera(&camera_);
+
+    if (input_mgr_.KeyPressed(DIK_F1))
+    {
+        benchmark_instancing(&renderer_, scene_.get_primitive(), 10000);
+    }
+
+    if (input_mgr_.KeyPressed(DIK_F2))
+    {
+        benchmark_occlusion(&renderer_, 4000);
+    }
+
+    if (input_mgr_.KeyPressed(DIK_F3))
+    {
+        benchmark_msaa(&renderer_, &scene_, 20);
+    }
+
+    if (input_mgr_.KeyPressed(DIK_F4))
+    {
+        benchmark_shadow(&renderer_, &scene_, 20);
+    }
+
+    if (input_mgr_.KeyPressed(DIK_F5))
+    {
+        benchmark_text(&renderer_, 5000, 20);
+    }
+
+    if (input_mgr_.KeyPressed(DIK_F6))
+    {
+        benchmark_wireframe(&renderer_, &scene_, 20);
+    }
+
+    if (input_mgr_.KeyPressed(DIK_F7))
+    {
+        benchmark_clipping(&renderer_, 20);
+    }
+
+    if (input_mgr_.KeyPressed(DIK_F8))
+    {
+        benchmark_depth_prepass(&renderer_, &scene_, 20);
+    }
+
+    if (input_mgr_.KeyPressed(DIK_F9))
+    {
+        benchmark_draw_sorting(&renderer_, 200, 20);
+    }
+
+    if (input_mgr_.KeyPressed(DIK_F10))
+    {
+        benchmark_shading_rate(&renderer_, &scene_, 20);
+    }
+
+    // Ӱأƹ⿴ԭ
+    if (input_mgr_.KeyPressed(DIK_H))
+    {
+        if (renderer_.get_shadow())
+            renderer_.DisableShadow();
+        else
+            renderer_.EnableShadow(1024, Vector3(0, 0, 0), 90.0f, 0.1f, 100.0f);
+    }
+
+    if (input_mgr_.KeyPressed(DIK_J))
+    {
+        renderer_.set_shadow_pcf(renderer_.get_shadow_pcf() % 3 + 1);
+    }
+
+    if (input_mgr_.KeyPressed(DIK_F))
+    {
+        PostProcessSettings settings = renderer_.get_post_process();
+        settings.fxaa = !settings.fxaa;
+        renderer_.set_post_process(settings);
+    }
+
+    // ɫӳgammaУ
+    if (input_mgr_.KeyPressed(DIK_G))
+    {
+        PostProcessSettings settings = renderer_.get_post_process();
+        settings.tone_mapping = !settings.tone_mapping;
+        settings.exposure = settings.tone_mapping ? 1.5f : 1.0f;
+        settings.gamma = settings.tone_mapping ? 2.2f : 1.0f;
+        renderer_.set_post_process(settings);
+    }
+
+    if (input_mgr_.KeyPressed(DIK_Z))
+    {
+        renderer_.set_depth_prepass(!renderer_.get_depth_prepass());
+    }
+
+    // PhongյļƵʣΪ1x12x24x4Ӧ
+    if (input_mgr_.KeyPressed(DIK_V))
+    {
+        int rate = (renderer_.get_shading_rate() + 1) % kShadingRateCount;
+        renderer_.set_shading_rate(static_cast<ShadingRate>(rate));
+    }
+
+    if (input_mgr_.KeyPressed(DIK_X))
+    {
+        renderer_.set_draw_sorting(!renderer_.get_draw_sorting());
+    }
+
+    // ֱ̬ʣդԤԼΪ60֡һ
+    if (input_mgr_.KeyPressed(DIK_C))
+    {
+        renderer_.set_dynamic_resolution(!renderer_.get_dynamic_resolution(), 8.0f, 0.5f);
+    }
+
+    if (input_mgr_.KeyPressed(DIK_M))
+    {
+        int samples = renderer_.get_msaa();
+        renderer_.set_msaa(samples == 1 ? kMsaa4 : (samples == kMsaa4 ? kMsaa8 : 1));
+    }
+
+    // ĻϷʽΪ͸alphaӡԤalpha
+    if (input_mgr_.KeyPressed(DIK_N))
+    {
+        int blend = (renderer_.get_blend_mode() + 1) % kBlendModeCount;
+        renderer_.set_blend_mode(static_cast<BlendMode>(blend));
+    }
+
+    if (input_mgr_.KeyPressed(DIK_T))
+    {
+        renderer_.set_pipelined(!renderer_.get_pipelined());
+    }
+
     renderer_.BeginFrame();
 
     static int p = 0;
@@ -268,8 +396,6 @@ void App::Update(void)
         p %= kPrimitiveSize;
     } 
 
-    renderer_.set_camera(&camera_);
-
     //int w = texture_.get_width();
     //int h = texture_.get_height();
     //for (int x = 0; x < min_t(w, width_); ++x)
@@ -294,6 +420,8 @@ void App::Update(void)
 //    renderer_.DrawPrimitive(&primitive);
 
     scene_.Update(&renderer_);
+    sprintf(buf, "LOD %d", scene_.get_lod_level());
+    renderer_.DrawScreenText(5, 25, buf);
     
     renderer_.DisplayStatus();
 //    renderer_.DisplayTriangle();
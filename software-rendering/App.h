@@ -60,5 +60,6 @@ private:
     Primitive primitive_;
     Texture2D texture_;
     Texture2D bumpmap_;
+    NormalMap normal_map_;
     Scene scene_;
 };
\ No newline at end of file
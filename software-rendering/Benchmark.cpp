@@ -0,0 +1,590 @@
+#include "Benchmark.h"
+#include <vector>
+#include <math.h>
+#include "util.h"
+#include "Logger.h"
+#include "Renderer.h"
+#include "Primitive.h"
+#include "Camera.h"
+#include "Scene.h"
+#include "Light.h"
+#include "TextRenderer.h"
+
+using std::vector;
+
+// ÿƵʵλ
+static const int kInstanceBatch = 500;
+
+// ԻĶȾ״̬ʱָ
+// ʱرˮߺͻ򣺼ʱҪEndFrameɹդֻBeginFrameĲҲҪִл
+class BenchmarkState
+{
+public:
+    explicit BenchmarkState(Renderer *renderer)
+        :renderer_(renderer)
+        ,camera_(renderer->get_camera())
+        ,pipelined_(renderer->get_pipelined())
+        ,sorting_(renderer->get_draw_sorting())
+        ,prepass_(renderer->get_depth_prepass())
+        ,culling_(renderer->get_occlusion_culling())
+        ,mode_(renderer->get_shading_mode())
+        ,samples_(renderer->get_msaa())
+    {
+        renderer_->set_pipelined(false);
+        renderer_->set_draw_sorting(false);
+    }
+
+    ~BenchmarkState(void)
+    {
+        renderer_->set_msaa(samples_);
+        renderer_->set_shading_mode(mode_);
+        renderer_->set_occlusion_culling(culling_);
+        renderer_->set_depth_prepass(prepass_);
+        renderer_->set_draw_sorting(sorting_);
+        renderer_->set_pipelined(pipelined_);
+        renderer_->set_camera(camera_);
+    }
+
+private:
+    BenchmarkState(const BenchmarkState&);
+    BenchmarkState& operator=(const BenchmarkState&);
+
+    Renderer *renderer_;
+    Camera *camera_;
+    bool pipelined_;
+    bool sorting_;
+    bool prepass_;
+    bool culling_;
+    ShadingMode mode_;
+    int samples_;
+};
+
+static void make_grid_transforms(int count, float spacing, vector<Matrix44> *transforms)
+{
+    int side = static_cast<int>(sqrtf(static_cast<float>(count))) + 1;
+    transforms->resize(count);
+    for (int i = 0; i < count; ++i)
+    {
+        Matrix44 &m = (*transforms)[i];
+        m = Matrix44::CreateIdentity();
+        m.SetTranslation((i % side - side / 2) * spacing,
+                         0.0f,
+                         (i / side) * spacing);
+    }
+}
+
+void benchmark_instancing(Renderer *renderer, Primitive *primitive, int count)
+{
+    if (!renderer || !primitive || count <= 0)
+        return;
+
+    vector<Matrix44> transforms;
+    make_grid_transforms(count, 40.0f, &transforms);
+
+    // ֻƼδEndFrame
+    BenchmarkState state(renderer);
+
+    // 
+    double loop_ms = 0.0;
+    for (int first = 0; first < count; first += kInstanceBatch)
+    {
+        int n = min_t(kInstanceBatch, count - first);
+        renderer->BeginFrame();
+        double start = get_time_ms();
+        for (int i = 0; i < n; ++i)
+        {
+            renderer->DrawPrimitive(primitive, transforms[first + i]);
+        }
+        loop_ms += get_time_ms() - start;
+    }
+
+    // ʵ
+    double instanced_ms = 0.0;
+    for (int first = 0; first < count; first += kInstanceBatch)
+    {
+        int n = min_t(kInstanceBatch, count - first);
+        renderer->BeginFrame();
+        double start = get_time_ms();
+        renderer->DrawPrimitiveInstanced(primitive, &transforms[first], n);
+        instanced_ms += get_time_ms() - start;
+    }
+    renderer->BeginFrame();
+
+    GT_LOG_INFO("instancing %d x %d vertexs: loop %.2f ms, instanced %.2f ms, speedup %.2f",
+                count, primitive->size, loop_ms, instanced_ms,
+                instanced_ms > 0.0 ? loop_ms / instanced_ms : 0.0);
+}
+
+// 볤壬36
+static void make_box(const Vector3 &min_p, const Vector3 &max_p, Primitive *primitive)
+{
+    // ÿɷڵͷȷĸʱ
+    static const int kFaceAxis[6] = {0, 0, 1, 1, 2, 2};
+    static const float kFaceSign[6] = {1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f};
+    static const int kQuad[6] = {0, 1, 2, 0, 2, 3};
+    static const float kCornerU[4] = {0.0f, 1.0f, 1.0f, 0.0f};
+    static const float kCornerV[4] = {0.0f, 0.0f, 1.0f, 1.0f};
+
+    Primitive box(36, nullptr, nullptr);
+    int n = 0;
+    for (int f = 0; f < 6; ++f)
+    {
+        int axis = kFaceAxis[f];
+        int u_axis = (axis + 1) % 3;
+        int v_axis = (axis + 2) % 3;
+        float sign = kFaceSign[f];
+        Vector3 normal(0, 0, 0);
+        normal.m[axis] = sign;
+        for (int k = 0; k < 6; ++k)
+        {
+            int c = kQuad[k];
+            // 淴ת
+            if (sign < 0)
+                c = kQuad[5 - k];
+            Vector3 p;
+            p.m[axis] = sign > 0 ? max_p.m[axis] : min_p.m[axis];
+            p.m[u_axis] = kCornerU[c] > 0 ? max_p.m[u_axis] : min_p.m[u_axis];
+            p.m[v_axis] = kCornerV[c] > 0 ? max_p.m[v_axis] : min_p.m[v_axis];
+            box.positions[n] = p;
+            box.normals[n] = normal;
+            box.uvs[n] = Vector2(kCornerU[c], kCornerV[c]);
+            box.colors[n] = Vector4(1.0f, 1.0f, 1.0f, 1.0f);
+            ++n;
+        }
+    }
+    box.ComputeBound();
+    *primitive = std::move(box);
+}
+
+static double draw_city(Renderer *renderer, Primitive *wall, const vector<Matrix44> &walls,
+                        Primitive *house, const vector<Matrix44> &houses)
+{
+    renderer->BeginFrame();
+    double start = get_time_ms();
+    for (size_t i = 0; i < walls.size(); ++i)
+    {
+        renderer->DrawOccluder(wall, walls[i]);
+    }
+    for (size_t i = 0; i < walls.size(); ++i)
+    {
+        renderer->DrawPrimitive(wall, walls[i]);
+    }
+    for (size_t i = 0; i < houses.size(); ++i)
+    {
+        renderer->DrawPrimitive(house, houses[i]);
+    }
+    return get_time_ms() - start;
+}
+
+void benchmark_occlusion(Renderer *renderer, int count)
+{
+    if (!renderer || !renderer->get_camera() || count <= 0)
+        return;
+
+    // λڽֵ㳯+z򣬽һŸ¥¥խ
+    BenchmarkState state(renderer);
+    Camera camera = *renderer->get_camera();
+    camera.set_pos(Vector3(0, 1.5f, 0));
+    camera.set_ori(Quat::GetIdentity());
+    renderer->set_camera(&camera);
+
+    Primitive wall;
+    make_box(Vector3(-4.5f, 0, 0), Vector3(4.5f, 30, 2), &wall);
+    vector<Matrix44> walls;
+    for (int i = -6; i <= 6; ++i)
+    {
+        Matrix44 m = Matrix44::CreateIdentity();
+        m.SetTranslation(i * 10.0f, 0, 20.0f);
+        walls.push_back(m);
+    }
+
+    Primitive house;
+    make_box(Vector3(-1, 0, -1), Vector3(1, 3, 1), &house);
+    vector<Matrix44> houses;
+    make_grid_transforms(count, 4.0f, &houses);
+    for (int i = 0; i < count; ++i)
+    {
+        Matrix44 &m = houses[i];
+        m.SetTranslation(m.m30, 0, m.m32 + 30.0f);
+    }
+
+    renderer->set_occlusion_culling(false);
+    double off_ms = draw_city(renderer, &wall, walls, &house, houses);
+    renderer->set_occlusion_culling(true);
+    double on_ms = draw_city(renderer, &wall, walls, &house, houses);
+    RenderStats stats = renderer->get_stats();
+    renderer->BeginFrame();
+
+    int tested = max_t(stats.occlusion_tested, 1);
+    GT_LOG_INFO("occlusion %d objects: culled %d (%.1f%%), occluder+test %.2f ms, "
+                "off %.2f ms, on %.2f ms, saved %.2f ms (estimated %.2f ms)",
+                stats.occlusion_tested, stats.occlusion_culled,
+                100.0 * stats.occlusion_culled / tested, stats.occlusion_ms,
+                off_ms, on_ms, off_ms - on_ms, stats.GetOcclusionSavedMs());
+}
+
+void benchmark_msaa(Renderer *renderer, Scene *scene, int frames)
+{
+    if (!renderer || !scene || !scene->IsLoaded() || frames <= 0)
+        return;
+
+    BenchmarkState state(renderer);
+
+    static const int kSamples[3] = {1, kMsaa4, kMsaa8};
+    double ms[3] = {0.0};
+    for (int i = 0; i < 3; ++i)
+    {
+        renderer->set_msaa(kSamples[i]);
+        double start = get_time_ms();
+        for (int f = 0; f < frames; ++f)
+        {
+            renderer->BeginFrame();
+            scene->Draw(renderer);
+            renderer->EndFrame();
+        }
+        ms[i] = (get_time_ms() - start) / frames;
+    }
+
+    GT_LOG_INFO("msaa %d frames: 1x %.2f ms, 4x %.2f ms (%.2f), 8x %.2f ms (%.2f)",
+                frames, ms[0], ms[1], ms[1] / max_t(ms[0], 0.001),
+                ms[2], ms[2] / max_t(ms[0], 0.001));
+}
+
+void benchmark_shadow(Renderer *renderer, Scene *scene, int frames)
+{
+    if (!renderer || !scene || !scene->IsLoaded() || !renderer->get_camera() || frames <= 0)
+        return;
+
+    // Ⱦƹԭ㣬ͼĻͬ鸲ǵӽ
+    // 鶼ڹդ׶μʱδPresent
+    int width = renderer->get_width();
+    int height = renderer->get_height();
+    Camera *camera = renderer->get_camera();
+    Light light = renderer->get_light() ? *renderer->get_light() : Light();
+    light.position = camera->get_pos();
+    Renderer offscreen;
+    offscreen.InitializeOffscreen(width, height);
+    offscreen.set_camera(camera);
+    offscreen.set_light(&light);
+    offscreen.set_shading_mode(kPhong);
+    int size = static_cast<int>(sqrtf(static_cast<float>(width * height)));
+    offscreen.EnableShadow(size, Vector3(0, 0, 0), camera->get_fov(), 0.1f, 100.0f);
+
+    double depth_ms = 0.0;
+    double color_ms = 0.0;
+    int depth_pixels = 0;
+    int color_pixels = 0;
+    for (int f = 0; f < frames; ++f)
+    {
+        offscreen.BeginFrame();
+        scene->Draw(&offscreen);
+        offscreen.EndFrame();
+        const RasterStats &stats = offscreen.get_raster_stats();
+        depth_ms += stats.shadow_ms;
+        color_ms += stats.shading_ms;
+        depth_pixels += stats.shadow_pixels;
+        color_pixels += stats.shaded_pixels;
+    }
+    offscreen.Uninitialize();
+
+    // ͼĺʱպResolve
+    double depth_per_pixel = depth_pixels > 0 ? depth_ms / depth_pixels : 0.0;
+    double color_per_pixel = color_pixels > 0 ? color_ms / color_pixels : 0.0;
+    GT_LOG_INFO("shadow depth %dx%d: depth only %.2f ms (%d pixels), Phong color %.2f ms (%d pixels), per pixel speedup %.2f",
+                size, size, depth_ms / frames, depth_pixels / frames, color_ms / frames, color_pixels / frames,
+                depth_per_pixel > 0.0 ? color_per_pixel / depth_per_pixel : 0.0);
+}
+
+void benchmark_text(Renderer *renderer, int labels, int frames)
+{
+    if (!renderer || labels <= 0 || frames <= 0)
+        return;
+
+    int width = renderer->get_width();
+    int height = renderer->get_height();
+    vector<uint32> buffer(width * height, 0);
+    vector<GlyphQuad> quads;
+    TextRenderer text;
+    char buf[32] = {0};
+
+    double layout_ms = 0.0;
+    double blit_ms = 0.0;
+    for (int f = 0; f < frames; ++f)
+    {
+        double start = get_time_ms();
+        quads.clear();
+        for (int i = 0; i < labels; ++i)
+        {
+            sprintf(buf, "obj %d", i);
+            int x = (i * 73) % width;
+            int y = (i * 37) % height;
+            text.Layout(x, y, buf, 0xc0ffff00, &quads);
+        }
+        double mid = get_time_ms();
+        text.Blit(quads, &buffer[0], width, height, width * sizeof(uint32));
+        layout_ms += mid - start;
+        blit_ms += get_time_ms() - mid;
+    }
+
+    GT_LOG_INFO("text %d labels, %d glyphs: layout %.3f ms, blit %.3f ms",
+                labels, static_cast<int>(quads.size()), layout_ms / frames, blit_ms / frames);
+}
+
+void benchmark_wireframe(Renderer *renderer, Scene *scene, int frames)
+{
+    if (!renderer || !scene || !scene->IsLoaded() || frames <= 0)
+        return;
+
+    BenchmarkState state(renderer);
+    renderer->set_shading_mode(kFrame);
+
+    double start = get_time_ms();
+    for (int f = 0; f < frames; ++f)
+    {
+        renderer->BeginFrame();
+        scene->Draw(renderer);
+        renderer->EndFrame();
+    }
+    double ms = (get_time_ms() - start) / frames;
+
+    int edges = renderer->get_wireframe_edges();
+    GT_LOG_INFO("wireframe %d frames: %d edges (%d triangle edges), %.2f ms, %.0f edges/s",
+                frames, edges, renderer->get_wireframe_triangle_edges(), ms,
+                edges * 1000.0 / max_t(ms, 0.001));
+}
+
+// ڵķշ䣬ÿгdivisions x divisionsС
+static void make_room(float half, int divisions, Primitive *primitive)
+{
+    static const int kQuad[6] = {0, 2, 1, 0, 3, 2};
+    static const float kCornerU[4] = {0.0f, 1.0f, 1.0f, 0.0f};
+    static const float kCornerV[4] = {0.0f, 0.0f, 1.0f, 1.0f};
+
+    Primitive room(6 * divisions * divisions * 6, nullptr, nullptr);
+    float step = 2.0f * half / divisions;
+    int n = 0;
+    for (int f = 0; f < 6; ++f)
+    {
+        int axis = f / 2;
+        int u_axis = (axis + 1) % 3;
+        int v_axis = (axis + 2) % 3;
+        float sign = (f % 2) ? -1.0f : 1.0f;
+        Vector3 normal(0, 0, 0);
+        normal.m[axis] = -sign;
+        for (int i = 0; i < divisions * divisions; ++i)
+        {
+            int cu = i % divisions;
+            int cv = i / divisions;
+            for (int k = 0; k < 6; ++k)
+            {
+                int c = sign > 0 ? kQuad[k] : kQuad[5 - k];
+                Vector3 p;
+                p.m[axis] = sign * half;
+                p.m[u_axis] = -half + (cu + kCornerU[c]) * step;
+                p.m[v_axis] = -half + (cv + kCornerV[c]) * step;
+                room.positions[n] = p;
+                room.normals[n] = normal;
+                room.uvs[n] = Vector2((cu + kCornerU[c]) / divisions, (cv + kCornerV[c]) / divisions);
+                room.colors[n] = Vector4(1.0f, 1.0f, 1.0f, 1.0f);
+                ++n;
+            }
+        }
+    }
+    room.ComputeBound();
+    *primitive = std::move(room);
+}
+
+void benchmark_clipping(Renderer *renderer, int frames)
+{
+    if (!renderer || !renderer->get_camera() || frames <= 0)
+        return;
+
+    BenchmarkState state(renderer);
+    Camera camera = *renderer->get_camera();
+    camera.set_pos(Vector3(0, 0, 0));
+    renderer->set_camera(&camera);
+    renderer->set_occlusion_culling(false);
+
+    // ֱ󲿷ֿƽ桢ֻĸ桢Զƽ
+    float z_near = camera.get_near();
+    float z_far = camera.get_far();
+    const float kHalf[3] = {z_near * 1.2f, (z_near + z_far) * 0.25f, z_far * 0.8f};
+    const char *kName[3] = {"near", "sides", "far"};
+    Primitive room;
+    for (int s = 0; s < 3; ++s)
+    {
+        make_room(kHalf[s], 64, &room);
+        double ms = 0.0;
+        int clipped = 0;
+        int output = 0;
+        double clip_ms = 0.0;
+        for (int f = 0; f < frames; ++f)
+        {
+            // ÿ֡һòͬ׶ƽ
+            camera.set_ori(Quat::GetRotationY(f * 360.0f / frames) * Quat::GetRotationX(f * 17.0f));
+            renderer->BeginFrame();
+            double start = get_time_ms();
+            renderer->DrawPrimitive(&room);
+            ms += get_time_ms() - start;
+            const RenderStats &stats = renderer->get_stats();
+            clipped += stats.clip_triangles;
+            output += stats.clip_output;
+            clip_ms += stats.clip_ms;
+        }
+        GT_LOG_INFO("clipping %s %d triangles x %d frames: clipped %d -> %d, clipper %.2f ms (%.0f triangles/s), geometry %.2f ms",
+                    kName[s], room.size / 3, frames, clipped, output, clip_ms,
+                    clipped * 1000.0 / max_t(clip_ms, 0.001), ms);
+    }
+
+    renderer->BeginFrame();
+}
+
+void benchmark_depth_prepass(Renderer *renderer, Scene *scene, int frames)
+{
+    if (!renderer || !scene || !scene->IsLoaded() || frames <= 0)
+        return;
+
+    // ԤȾֻڲزģʽ
+    BenchmarkState state(renderer);
+    renderer->set_shading_mode(kPhong);
+    renderer->set_msaa(1);
+
+    double ms[2] = {0.0};
+    RasterStats stats[2];
+    for (int i = 0; i < 2; ++i)
+    {
+        renderer->set_depth_prepass(i == 1);
+        double start = get_time_ms();
+        for (int f = 0; f < frames; ++f)
+        {
+            renderer->BeginFrame();
+            scene->Draw(renderer);
+            renderer->EndFrame();
+        }
+        ms[i] = (get_time_ms() - start) / frames;
+        stats[i] = renderer->get_raster_stats();
+    }
+
+    int shaded = stats[0].shaded_pixels;
+    GT_LOG_INFO("depth prepass %d frames: off %.2f ms (%d shaded), on %.2f ms (%d shaded, %.1f%% fewer), "
+                "prepass %.2f ms, shading %.2f -> %.2f ms",
+                frames, ms[0], shaded, ms[1], stats[1].shaded_pixels,
+                shaded > 0 ? 100.0 * (shaded - stats[1].shaded_pixels) / shaded : 0.0,
+                stats[1].prepass_ms, stats[0].shading_ms, stats[1].shading_ms);
+}
+
+void benchmark_draw_sorting(Renderer *renderer, int count, int frames)
+{
+    if (!renderer || !renderer->get_camera() || count <= 0 || frames <= 0)
+        return;
+
+    BenchmarkState state(renderer);
+    Camera camera = *renderer->get_camera();
+    camera.set_pos(Vector3(0, 0, 0));
+    camera.set_ori(Quat::GetIdentity());
+    renderer->set_camera(&camera);
+
+    // ſĳ壬Ҵڵһ
+    Material mat;
+    mat.power = 8.0f;
+    mat.ambient = Vector4(0.3f, 0.3f, 0.3f, 1.0f);
+    mat.diffuse = Vector4(0.6f, 0.8f, 0.6f, 1.0f);
+    mat.specular = Vector4(0.6f, 0.8f, 0.6f, 1.0f);
+    Primitive box;
+    make_box(Vector3(-1, -1, -1), Vector3(1, 1, 1), &box);
+    box.material = &mat;
+    vector<Matrix44> transforms(count);
+    for (int i = 0; i < count; ++i)
+    {
+        // ύԶ
+        Matrix44 &m = transforms[i];
+        m = Matrix44::CreateIdentity();
+        m.SetTranslation(((i * 7) % 5 - 2) * 0.8f, ((i * 3) % 4 - 1.5f) * 0.6f, 6.0f + (count - i) * 1.5f);
+    }
+
+    renderer->set_depth_prepass(false);
+    renderer->set_shading_mode(kPhong);
+
+    double ms[2] = {0.0};
+    double sort_ms = 0.0;
+    int shaded[2] = {0};
+    for (int i = 0; i < 2; ++i)
+    {
+        renderer->set_draw_sorting(i == 1);
+        double start = get_time_ms();
+        for (int f = 0; f < frames; ++f)
+        {
+            renderer->BeginFrame();
+            for (int k = 0; k < count; ++k)
+            {
+                renderer->DrawPrimitive(&box, transforms[k]);
+            }
+            renderer->EndFrame();
+            if (i == 1)
+                sort_ms += renderer->get_stats().sort_ms;
+        }
+        ms[i] = (get_time_ms() - start) / frames;
+        shaded[i] = renderer->get_raster_stats().shaded_pixels;
+    }
+
+    GT_LOG_INFO("draw sorting %d objects, %d frames: off %.2f ms (%d shaded), on %.2f ms (%d shaded), sort %.3f ms",
+                count, frames, ms[0], shaded[0], ms[1], shaded[1], sort_ms / frames);
+}
+
+void benchmark_shading_rate(Renderer *renderer, Scene *scene, int frames)
+{
+    if (!renderer || !scene || !scene->IsLoaded() || !renderer->get_camera() || !renderer->get_light() || frames <= 0)
+        return;
+
+    // ȾܶؽزƵ޹أ
+    int width = renderer->get_width();
+    int height = renderer->get_height();
+    Renderer offscreen;
+    offscreen.InitializeOffscreen(width, height);
+    offscreen.set_camera(renderer->get_camera());
+    offscreen.set_light(renderer->get_light());
+    offscreen.set_shading_mode(kPhong);
+
+    static const char *kName[kShadingRateCount] = {"1x1", "2x2", "4x4", "adaptive"};
+    int pitch = offscreen.get_pitch() / 4;
+    vector<uint32> reference(width * height);
+    for (int rate = 0; rate < kShadingRateCount; ++rate)
+    {
+        offscreen.set_shading_rate(static_cast<ShadingRate>(rate));
+        double start = get_time_ms();
+        for (int f = 0; f < frames; ++f)
+        {
+            offscreen.BeginFrame();
+            scene->Draw(&offscreen);
+            offscreen.EndFrame();
+        }
+        double ms = (get_time_ms() - start) / frames;
+
+        const uint32 *color = offscreen.get_color_buffer();
+        double error = 0.0;
+        int max_error = 0;
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                uint32 c = color[y * pitch + x];
+                uint32 &r = reference[y * width + x];
+                if (rate == kShadingRate1x1)
+                    r = c;
+                for (int shift = 0; shift < 24; shift += 8)
+                {
+                    int d = abs(static_cast<int>((c >> shift) & 0xff) - static_cast<int>((r >> shift) & 0xff));
+                    error += d * d;
+                    max_error = max_t(max_error, d);
+                }
+            }
+        }
+        double mse = error / (width * height * 3);
+        double psnr = mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : 99.0;
+        const RasterStats &stats = offscreen.get_raster_stats();
+        GT_LOG_INFO("shading rate %s: %.2f ms, lighting %d / %d pixels, triangles 1x1 %d 2x2 %d 4x4 %d, psnr %.1f dB, max error %d",
+                    kName[rate], ms, stats.lighting_samples, stats.shaded_pixels,
+                    stats.rate_triangles[0], stats.rate_triangles[1], stats.rate_triangles[2], psnr, max_error);
+    }
+    offscreen.Uninitialize();
+}
\ No newline at end of file
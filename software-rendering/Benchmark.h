@@ -0,0 +1,38 @@
+#pragma once
+
+class Renderer;
+class Primitive;
+class Scene;
+
+// ʵDrawPrimitiveļν׶κʱԱȣ־
+void benchmark_instancing(Renderer *renderer, Primitive *primitive, int count);
+
+// ڵ޳һŸ¥סcountСĳгԱȿڵ޳ļν׶κʱ
+void benchmark_occlusion(Renderer *renderer, int count);
+
+
+// زͬһֱ1x4x8xȾframes֡Ա֡ʱ
+void benchmark_msaa(Renderer *renderer, Scene *scene, int frames);
+
+// ӰͼͬһͼPhongɫդĺʱÿغʱԱȣͼĻͬ
+void benchmark_shadow(Renderer *renderer, Scene *scene, int frames);
+
+// ֣ÿ֡Ű沢labelsǩĻСĻ棬ŰͻϷֱʱ
+void benchmark_text(Renderer *renderer, int labels, int frames);
+
+// ߿򣺳߿ģʽȾframes֡ȥǰıÿ뻭ı
+void benchmark_wireframe(Renderer *renderer, Scene *scene, int frames);
+
+// üλϸֵķշڣСֱʹҪƽ桢桢Զƽ棬ü
+void benchmark_clipping(Renderer *renderer, int frames);
+
+// ԤȾPhongɫֱرաԤȾȾframes֡֡ʱɫԤȾĺʱ
+void benchmark_depth_prepass(Renderer *renderer, Scene *scene, int frames);
+
+// countǰصĳ尴Զ˳ύPhongɫֱرաȾframes֡
+// ֡ʱʱɫ
+void benchmark_draw_sorting(Renderer *renderer, int count, int frames);
+
+// ɫƵʣrendererͬƹͷֱȾֱ1x12x24x4ӦƵPhongɫ
+// ÿ֡ʱռԼ1x1ȵPSNR
+void benchmark_shading_rate(Renderer *renderer, Scene *scene, int frames);
\ No newline at end of file
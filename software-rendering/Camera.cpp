@@ -8,30 +8,68 @@ void Camera::Rotate(float heading, float pitch)
     rotate = Quat::GetIdentity();
     rotate.SetRotationY(pitch);
     ori_ = rotate * ori_;
+    view_dirty_ = true;
 }
 
 void Camera::Move(const Vector3 &v)
 {
     pos_ += v;
+    view_dirty_ = true;
+}
+
+void Camera::UpdateMatrices(void)
+{
+    if (!view_dirty_ && !projection_dirty_)
+        return;
+
+    if (view_dirty_)
+    {
+        // תƽ-pos
+        Matrix33 rotate = ori_.GetMatrix33();
+        view_ = Matrix44::CreateIdentity();
+        view_.SetMatrix33(rotate);
+        view_.SetTranslation(-pos_.x, -pos_.y, -pos_.z);
+
+        // 任Ϊƽposתת
+        rotate.SetTranspose();
+        Vector3 t = pos_ * rotate;
+        inverse_view_ = Matrix44::CreateIdentity();
+        inverse_view_.SetMatrix33(rotate);
+        inverse_view_.SetTranslation(t.x, t.y, t.z);
+    }
+    if (projection_dirty_)
+    {
+        projection_ = Matrix44();
+        projection_.SetPerspectiveMatrixLH(far_, near_, angle2radian(fov_), aspect_);
+    }
+    view_projection_ = view_;
+    view_projection_ = view_projection_ * projection_;
+    view_dirty_ = false;
+    projection_dirty_ = false;
 }
 
 // ȡ͸Ӿ
-Matrix44 Camera::GetPerpectivMatrix(void)
+const Matrix44 &Camera::GetPerpectivMatrix(void)
 {
-    float rad_fov = angle2radian(fov_);
-    Matrix44 m;
-    m.SetPerspectiveMatrixLH(far_, near_, rad_fov, aspect_);
-    return m;
+    UpdateMatrices();
+    return projection_;
 }
 
 // ȡתƽƾ
-Matrix44 Camera::GetModelViewMatrix(void)
+const Matrix44 &Camera::GetModelViewMatrix(void)
 {
-    Matrix33 rotate = ori_.GetMatrix33();
-    Matrix44 m = Matrix44::CreateIdentity();
-    m.SetMatrix33(rotate);
-    m.SetTranslation(-pos_.x, -pos_.y, -pos_.z);
-    return m;
+    UpdateMatrices();
+    return view_;
 }
 
+const Matrix44 &Camera::GetInverseModelViewMatrix(void)
+{
+    UpdateMatrices();
+    return inverse_view_;
+}
 
+const Matrix44 &Camera::GetViewProjectionMatrix(void)
+{
+    UpdateMatrices();
+    return view_projection_;
+}
\ No newline at end of file
@@ -11,14 +11,18 @@ public:
         ,far_(0)
         ,near_(0)
         ,fov_(0)
-        ,aspect_(0) {}
+        ,aspect_(0)
+        ,view_dirty_(true)
+        ,projection_dirty_(true) {}
     Camera(const Vector3 &pos, const Quat &ori, float z_far, float z_near, float fov, float aspect)
         :pos_(pos)
         ,ori_(ori)
         ,far_(z_far)
         ,near_(z_near)
         ,fov_(fov)
-        ,aspect_(aspect){}
+        ,aspect_(aspect)
+        ,view_dirty_(true)
+        ,projection_dirty_(true) {}
 // TODO
 //    Camera(const Vector3 &pos, const Vector3 &look_at, float far, float near, float fov, float aspect)
 //    {}
@@ -27,6 +31,7 @@ public:
     void set_pos(const Vector3 &pos)
     {
         pos_ = pos;
+        view_dirty_ = true;
     }
 
     Vector3 get_pos(void)
@@ -37,11 +42,13 @@ public:
     void set_ori(const Quat &ori)
     {
         ori_ = ori;
+        view_dirty_ = true;
     }
 
     void set_far(float f)
     {
         far_ = f;
+        projection_dirty_ = true;
     }
 
     float get_far(void)
@@ -52,6 +59,7 @@ public:
     void set_near(float n)
     {
         near_ = n;
+        projection_dirty_ = true;
     }
 
     float get_near(void)
@@ -62,18 +70,30 @@ public:
     void set_fov(float fov)
     {
         fov_ = fov;
+        projection_dirty_ = true;
+    }
+
+    float get_fov(void)
+    {
+        return fov_;
     }
 
     void set_aspect(float aspect)
     {
         aspect_ = aspect;
+        projection_dirty_ = true;
     }
     
     void Rotate(float heading, float pitch);
     void Move(const Vector3 &v);
 
-    Matrix44 GetPerpectivMatrix(void);
-    Matrix44 GetModelViewMatrix(void);
+    // ڲ仯һλȡʱ¼㣬ֱ֮ӷػ
+    const Matrix44 &GetPerpectivMatrix(void);
+    const Matrix44 &GetModelViewMatrix(void);
+    // ռ䵽ռ
+    const Matrix44 &GetInverseModelViewMatrix(void);
+    // GetModelViewMatrix() * GetPerpectivMatrix()ռ䵽üռ
+    const Matrix44 &GetViewProjectionMatrix(void);
 
 private:
     Vector3 pos_;
@@ -84,5 +104,15 @@ private:
     // yz ƽfov, Ƕȱʾ
     float fov_;
     float aspect_;
+
+    void UpdateMatrices(void);
+
+    // pos_ori_ıview_inverse_view_ʧЧıprojection_ʧЧ
+    bool view_dirty_;
+    bool projection_dirty_;
+    Matrix44 view_;
+    Matrix44 inverse_view_;
+    Matrix44 projection_;
+    Matrix44 view_projection_;
 };
 
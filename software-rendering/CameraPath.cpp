@@ -0,0 +1,89 @@
+#include "CameraPath.h"
+#include <stdio.h>
+#include <assert.h>
+#include "Logger.h"
+
+using std::string;
+
+bool CameraPath::Load(const string &file)
+{
+    FILE *fp = nullptr;
+    if (fopen_s(&fp, file.c_str(), "r") != 0 || !fp)
+    {
+        GT_LOG_ERROR("open camera path failed: %s", file.c_str());
+        return false;
+    }
+
+    keys_.clear();
+    char line[256] = {0};
+    int line_no = 0;
+    bool ok = true;
+    while (fgets(line, sizeof(line), fp))
+    {
+        ++line_no;
+        const char *p = line;
+        while (*p == ' ' || *p == '\t')
+            ++p;
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0')
+            continue;
+
+        CameraKey key;
+        int n = sscanf_s(p, "%f %f %f %f %f %f %f %f",
+                         &key.time,
+                         &key.pos.x, &key.pos.y, &key.pos.z,
+                         &key.ori.w, &key.ori.x, &key.ori.y, &key.ori.z);
+        if (n != 8 || (!keys_.empty() && key.time <= keys_.back().time))
+        {
+            GT_LOG_ERROR("bad camera key at %s:%d", file.c_str(), line_no);
+            ok = false;
+            break;
+        }
+        key.ori.Normalize();
+        keys_.push_back(key);
+    }
+    fclose(fp);
+
+    if (ok && keys_.empty())
+    {
+        GT_LOG_ERROR("camera path has no key: %s", file.c_str());
+        ok = false;
+    }
+    if (!ok)
+        keys_.clear();
+    return ok;
+}
+
+void CameraPath::AddKey(const CameraKey &key)
+{
+    assert(keys_.empty() || key.time > keys_.back().time);
+    keys_.push_back(key);
+}
+
+void CameraPath::Sample(float time, Vector3 *pos, Quat *ori) const
+{
+    assert(!keys_.empty());
+    assert(pos && ori);
+
+    if (time <= keys_.front().time)
+    {
+        *pos = keys_.front().pos;
+        *ori = keys_.front().ori;
+        return;
+    }
+    if (time >= keys_.back().time)
+    {
+        *pos = keys_.back().pos;
+        *ori = keys_.back().ori;
+        return;
+    }
+
+    // ؼ֡࣬˳
+    size_t i = 1;
+    while (keys_[i].time < time)
+        ++i;
+    const CameraKey &k0 = keys_[i - 1];
+    const CameraKey &k1 = keys_[i];
+    float t = (time - k0.time) / (k1.time - k0.time);
+    *pos = lerp(k0.pos, k1.pos, t);
+    *ori = Slerp(k0.ori, k1.ori, t);
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "vector.h"
+#include "quaternion.h"
+
+class CameraKey
+{
+public:
+    float time;
+    Vector3 pos;
+    Quat ori;
+};
+
+// ·ؼ֮֡λԲֵֵ
+// ıʽÿһؼ֡time px py pz qw qx qy qz#ͷΪע
+class CameraPath
+{
+public:
+    CameraPath(void) {}
+    ~CameraPath(void) {}
+
+    bool Load(const std::string &file);
+
+    // ؼ֡谴ʱ
+    void AddKey(const CameraKey &key);
+
+    int get_key_count(void) const
+    {
+        return static_cast<int>(keys_.size());
+    }
+
+    float get_start_time(void) const
+    {
+        return keys_.empty() ? 0.0f : keys_.front().time;
+    }
+
+    float get_end_time(void) const
+    {
+        return keys_.empty() ? 0.0f : keys_.back().time;
+    }
+
+    // timeΧʱȡβؼ֡
+    void Sample(float time, Vector3 *pos, Quat *ori) const;
+
+private:
+    std::vector<CameraKey> keys_;
+};
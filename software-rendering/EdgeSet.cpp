@@ -0,0 +1,71 @@
+#include "EdgeSet.h"
+#include <string.h>
+
+void EdgeSet::Reset(int expected)
+{
+    // װʲһ
+    uint32 capacity = 64;
+    while (capacity < static_cast<uint32>(expected) * 2)
+    {
+        capacity <<= 1;
+    }
+    if (entries_.size() < capacity)
+    {
+        entries_.assign(capacity, Entry());
+        stamp_ = 0;
+    }
+    ++stamp_;
+    // stamp_ʱɵıǿ±Ч
+    if (stamp_ == 0)
+    {
+        entries_.assign(entries_.size(), Entry());
+        stamp_ = 1;
+    }
+    size_ = 0;
+}
+
+bool EdgeSet::Insert(const Vector4 &a, const Vector4 &b)
+{
+    uint32 pa[3];
+    uint32 pb[3];
+    float fa[3] = {a.x, a.y, a.w};
+    float fb[3] = {b.x, b.y, b.w};
+    memcpy(pa, fa, sizeof(pa));
+    memcpy(pb, fb, sizeof(pb));
+
+    // ˵㰴λģʽͬһõͬһ
+    uint32 key[6];
+    if (memcmp(pa, pb, sizeof(pa)) <= 0)
+    {
+        memcpy(key, pa, sizeof(pa));
+        memcpy(key + 3, pb, sizeof(pb));
+    }
+    else
+    {
+        memcpy(key, pb, sizeof(pb));
+        memcpy(key + 3, pa, sizeof(pa));
+    }
+
+    uint32 hash = 2166136261u;
+    for (int i = 0; i < 6; ++i)
+    {
+        hash = (hash ^ key[i]) * 16777619u;
+    }
+    hash ^= hash >> 15;
+
+    // ̽
+    uint32 mask = static_cast<uint32>(entries_.size()) - 1;
+    for (uint32 i = hash & mask; ; i = (i + 1) & mask)
+    {
+        Entry &entry = entries_[i];
+        if (entry.stamp != stamp_)
+        {
+            memcpy(entry.key, key, sizeof(key));
+            entry.stamp = stamp_;
+            ++size_;
+            return true;
+        }
+        if (memcmp(entry.key, key, sizeof(key)) == 0)
+            return false;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+#include <vector>
+#include "typedef.h"
+#include "vector.h"
+
+// ߿ģʽµıȥ
+// ûεĹ㾭ͬı任Ļλȫͬ
+// ˵(x, y, w)Ϊߵļ˵˳޹
+class EdgeSet
+{
+public:
+    EdgeSet(void)
+        :stamp_(0)
+        ,size_(0) {}
+
+    ~EdgeSet(void) {}
+
+    // գҪıԤռ
+    void Reset(int expected);
+
+    // ߵһγʱtrue
+    bool Insert(const Vector4 &a, const Vector4 &b);
+
+    int get_size(void) const
+    {
+        return size_;
+    }
+
+private:
+    EdgeSet(const EdgeSet&);
+    EdgeSet& operator=(const EdgeSet&);
+
+    class Entry
+    {
+    public:
+        Entry(void)
+            :stamp(0) {}
+
+        uint32 key[6];
+        // stamp_ʱЧʱֻҪstamp_
+        uint32 stamp;
+    };
+
+    std::vector<Entry> entries_;
+    uint32 stamp_;
+    int size_;
+};
\ No newline at end of file
@@ -0,0 +1,196 @@
+#include "ImageWriter.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <assert.h>
+#include "Logger.h"
+
+using std::string;
+using std::vector;
+
+static const uint32 *get_row(const uint32 *pixels, int pitch, int y)
+{
+    return reinterpret_cast<const uint32 *>(reinterpret_cast<const uint8 *>(pixels) + y * pitch);
+}
+
+static void argb_to_rgb(const uint32 *row, int width, uint8 *out)
+{
+    for (int x = 0; x < width; ++x)
+    {
+        uint32 c = row[x];
+        out[x * 3 + 0] = static_cast<uint8>(c >> 16);
+        out[x * 3 + 1] = static_cast<uint8>(c >> 8);
+        out[x * 3 + 2] = static_cast<uint8>(c);
+    }
+}
+
+static bool write_file(const string &file, const vector<uint8> &data)
+{
+    FILE *fp = nullptr;
+    if (fopen_s(&fp, file.c_str(), "wb") != 0 || !fp)
+    {
+        GT_LOG_ERROR("open image file failed: %s", file.c_str());
+        return false;
+    }
+    size_t written = fwrite(&data[0], 1, data.size(), fp);
+    fclose(fp);
+    if (written != data.size())
+    {
+        GT_LOG_ERROR("write image file failed: %s", file.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool write_ppm(const string &file, const uint32 *pixels, int width, int height, int pitch)
+{
+    assert(pixels && width > 0 && height > 0);
+
+    char header[64] = {0};
+    int header_size = sprintf_s(header, "P6\n%d %d\n255\n", width, height);
+    vector<uint8> data(header_size + width * height * 3);
+    memcpy(&data[0], header, header_size);
+    for (int y = 0; y < height; ++y)
+    {
+        argb_to_rgb(get_row(pixels, pitch, y), width, &data[header_size + y * width * 3]);
+    }
+    return write_file(file, data);
+}
+
+bool read_ppm(const string &file, vector<uint32> *pixels, int *width, int *height)
+{
+    assert(pixels && width && height);
+
+    FILE *fp = nullptr;
+    if (fopen_s(&fp, file.c_str(), "rb") != 0 || !fp)
+        return false;
+    int w = 0;
+    int h = 0;
+    int max_value = 0;
+    // ͷ֮ǡһհַ
+    bool ret = fscanf_s(fp, "P6 %d %d %d", &w, &h, &max_value) == 3
+            && max_value == 255 && w > 0 && h > 0 && fgetc(fp) != EOF;
+    vector<uint8> data;
+    if (ret)
+    {
+        data.resize(w * h * 3);
+        ret = fread(&data[0], 1, data.size(), fp) == data.size();
+    }
+    fclose(fp);
+    if (!ret)
+    {
+        GT_LOG_ERROR("read image file failed: %s", file.c_str());
+        return false;
+    }
+
+    pixels->resize(w * h);
+    for (int i = 0; i < w * h; ++i)
+    {
+        (*pixels)[i] = 0xff000000 | (data[i * 3] << 16) | (data[i * 3 + 1] << 8) | data[i * 3 + 2];
+    }
+    *width = w;
+    *height = h;
+    return true;
+}
+
+// CRCھ̬ʼʱɣ߳ͬʱдͼƬʱ
+class CrcTable
+{
+public:
+    CrcTable(void)
+    {
+        for (uint32 i = 0; i < 256; ++i)
+        {
+            uint32 c = i;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+            table[i] = c;
+        }
+    }
+
+    uint32 table[256];
+};
+
+static const CrcTable kCrcTable;
+
+static uint32 crc32(const uint8 *data, size_t size)
+{
+    uint32 crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < size; ++i)
+        crc = kCrcTable.table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void put_uint32_be(vector<uint8> *out, uint32 v)
+{
+    out->push_back(static_cast<uint8>(v >> 24));
+    out->push_back(static_cast<uint8>(v >> 16));
+    out->push_back(static_cast<uint8>(v >> 8));
+    out->push_back(static_cast<uint8>(v));
+}
+
+static void put_chunk(vector<uint8> *out, const char *type, const vector<uint8> &data)
+{
+    put_uint32_be(out, static_cast<uint32>(data.size()));
+    size_t start = out->size();
+    out->insert(out->end(), type, type + 4);
+    out->insert(out->end(), data.begin(), data.end());
+    put_uint32_be(out, crc32(&(*out)[start], out->size() - start));
+}
+
+bool write_png(const string &file, const uint32 *pixels, int width, int height, int pitch)
+{
+    assert(pixels && width > 0 && height > 0);
+
+    // ÿǰһֽڵĹͣ0ʾ
+    size_t row_size = width * 3 + 1;
+    vector<uint8> raw(row_size * height);
+    for (int y = 0; y < height; ++y)
+    {
+        raw[y * row_size] = 0;
+        argb_to_rgb(get_row(pixels, pitch, y), width, &raw[y * row_size + 1]);
+    }
+
+    // zlibͷstored顢adler32
+    static const size_t kMaxStoredBlock = 65535;
+    vector<uint8> zlib;
+    zlib.reserve(raw.size() + raw.size() / kMaxStoredBlock * 5 + 16);
+    zlib.push_back(0x78);
+    zlib.push_back(0x01);
+    uint32 a = 1;
+    uint32 b = 0;
+    for (size_t pos = 0; pos < raw.size(); pos += kMaxStoredBlock)
+    {
+        size_t len = min_t(kMaxStoredBlock, raw.size() - pos);
+        bool last = (pos + len == raw.size());
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(static_cast<uint8>(len));
+        zlib.push_back(static_cast<uint8>(len >> 8));
+        zlib.push_back(static_cast<uint8>(~len));
+        zlib.push_back(static_cast<uint8>(~len >> 8));
+        zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + len);
+        for (size_t i = pos; i < pos + len; ++i)
+        {
+            a = (a + raw[i]) % 65521;
+            b = (b + a) % 65521;
+        }
+    }
+    put_uint32_be(&zlib, (b << 16) | a);
+
+    static const uint8 kSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    vector<uint8> png(kSignature, kSignature + 8);
+
+    vector<uint8> ihdr;
+    put_uint32_be(&ihdr, width);
+    put_uint32_be(&ihdr, height);
+    ihdr.push_back(8);  // λ
+    ihdr.push_back(2);  // RGB
+    ihdr.push_back(0);  // ѹʽ
+    ihdr.push_back(0);  // ˷ʽ
+    ihdr.push_back(0);  // 
+    put_chunk(&png, "IHDR", ihdr);
+    put_chunk(&png, "IDAT", zlib);
+    put_chunk(&png, "IEND", vector<uint8>());
+
+    return write_file(file, png);
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "typedef.h"
+
+// ARGB32дͼƬļpitchΪÿֽalphaͨ
+bool write_ppm(const std::string &file, const uint32 *pixels, int width, int height, int pitch);
+// ȡwrite_ppmдĶPPMΪ͸ARGB32ÿwidth
+bool read_ppm(const std::string &file, std::vector<uint32> *pixels, int *width, int *height);
+// ѹPNGdeflateֻʹstored飬zlib
+bool write_png(const std::string &file, const uint32 *pixels, int width, int height, int pitch);
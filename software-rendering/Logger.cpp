@@ -4,86 +4,519 @@ using std::string;
 
 const int LOG_FILE_SZIE = 1024 * 50;
 
+// ̨߳û־ʱĵȴ
+static const DWORD kLogPollInterval = 10;
+
 #pragma warning(push)
 // unsafe functionľ
 #pragma warning(disable:4996)
 
+// Ĵŷʽ
+enum LogArgType
+{
+    kLogArgNone = 0,
+    kLogArgInt,
+    kLogArgInt64,
+    kLogArgDouble,
+    kLogArgString,
+    kLogArgPointer
+};
+
+// ʽеһת˵
+class LogSpec
+{
+public:
+    // ȡ*ĸ
+    int stars;
+    LogArgType type;
+    // %ڵԭʼı
+    const char *begin;
+    int length;
+};
+
+// pָ%֮󣬷ת˵֮λ
+static const char *parse_spec(const char *p, LogSpec *spec)
+{
+    spec->begin = p - 1;
+    spec->stars = 0;
+    spec->type = kLogArgNone;
+    while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0')
+        ++p;
+    if (*p == '*')
+    {
+        ++spec->stars;
+        ++p;
+    }
+    while (*p >= '0' && *p <= '9')
+        ++p;
+    if (*p == '.')
+    {
+        ++p;
+        if (*p == '*')
+        {
+            ++spec->stars;
+            ++p;
+        }
+        while (*p >= '0' && *p <= '9')
+            ++p;
+    }
+
+    bool wide = false;
+    if (p[0] == 'I' && p[1] == '6' && p[2] == '4')
+    {
+        wide = true;
+        p += 3;
+    }
+    else if (p[0] == 'I' && p[1] == '3' && p[2] == '2')
+    {
+        p += 3;
+    }
+    else if (p[0] == 'l' && p[1] == 'l')
+    {
+        wide = true;
+        p += 2;
+    }
+    else if (*p == 'I' || *p == 'z')
+    {
+        wide = sizeof(size_t) == 8;
+        ++p;
+    }
+    else if (*p == 'h' || *p == 'l' || *p == 'L')
+    {
+        ++p;
+    }
+
+    switch (*p)
+    {
+    case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c':
+        spec->type = wide ? kLogArgInt64 : kLogArgInt;
+        break;
+    case 'f': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+        spec->type = kLogArgDouble;
+        break;
+    case 's':
+        spec->type = kLogArgString;
+        break;
+    case 'p':
+        spec->type = kLogArgPointer;
+        break;
+    }
+    if (*p != '\0')
+        ++p;
+    spec->length = static_cast<int>(p - spec->begin);
+    return p;
+}
+
+// Pushȡ˳ͣĲת˵
+static void parse_layout(const char *format, LogLayout *layout)
+{
+    int count = 0;
+    for (const char *p = format; *p != '\0'; )
+    {
+        if (*p++ != '%')
+            continue;
+        if (*p == '%')
+        {
+            ++p;
+            continue;
+        }
+        LogSpec spec;
+        p = parse_spec(p, &spec);
+        if (count + spec.stars + 1 > LogRecord::kMaxArgs)
+            break;
+        for (int i = 0; i < spec.stars; ++i)
+        {
+            layout->types[count++] = kLogArgInt;
+        }
+        if (spec.type != kLogArgNone)
+        {
+            layout->types[count++] = static_cast<uint8>(spec.type);
+        }
+    }
+    layout->format = format;
+    layout->arg_count = static_cast<uint8>(count);
+}
+
 Logger::Logger(void)
     // 1mb
     :data_(new char[LOG_FILE_SZIE])
     ,size_(0)
+    ,records_(new LogRecord[kRingSize])
+    ,layouts_(new LogLayout[kLayoutCacheSize])
+    ,enqueue_pos_(0)
+    ,dequeue_pos_(0)
+    ,written_(0)
+    ,dropped_(0)
+    ,worker_(NULL)
+    ,wake_(NULL)
+    ,exit_(false)
 {
 	AllocConsole();
 
 	(void)freopen("CONOUT$","w+t",stdout);  
 	(void)freopen("CONIN$","r+t",stdin);
+
+    for (int i = 0; i < kRingSize; ++i)
+    {
+        records_[i].sequence = i;
+    }
+    for (int i = 0; i < kLayoutCacheSize; ++i)
+    {
+        layouts_[i].state = 0;
+    }
+    wake_ = CreateEvent(NULL, FALSE, FALSE, NULL);
+    worker_ = CreateThread(NULL, 0, WorkerProc, this, 0, NULL);
 }
 
 Logger::~Logger(void)
 {
+    if (worker_)
+    {
+        exit_ = true;
+        SetEvent(wake_);
+        WaitForSingleObject(worker_, INFINITE);
+        CloseHandle(worker_);
+        worker_ = NULL;
+    }
+    else
+    {
+        Drain();
+    }
+    CloseHandle(wake_);
+
 	FlushToFile();
 
     if (data_)
         delete[] data_;
+    delete[] records_;
+    delete[] layouts_;
 	fclose(stdout);
 	fclose(stdin);
 	FreeConsole();
 }
 
-void Logger::Log( const char* line )
+const LogLayout *Logger::GetLayout(const char *format, LogLayout *local)
 {
-	size_t length = strlen(line);
+    // ʽַַ䣬ַɢ
+    size_t key = reinterpret_cast<size_t>(format);
+    size_t hash = (key >> 2) ^ (key >> 11);
+    for (int i = 0; i < kLayoutProbes; ++i)
+    {
+        LogLayout &layout = layouts_[(hash + i) & (kLayoutCacheSize - 1)];
+        LONG state = layout.state;
+        if (state == 2)
+        {
+            if (layout.format == format)
+                return &layout;
+            continue;
+        }
+        if (state == 0 && InterlockedCompareExchange(&layout.state, 1, 0) == 0)
+        {
+            parse_layout(format, &layout);
+            // дٷ߳
+            InterlockedExchange(&layout.state, 2);
+            return &layout;
+        }
+        // ߳дλܾͬһʽȴ
+        break;
+    }
+    parse_layout(format, local);
+    return local;
+}
+
+void Logger::Push(LogLevel level, const char *format, va_list args)
+{
+    LogRecord *record = nullptr;
+    LONG pos = enqueue_pos_;
+    for (;;)
+    {
+        record = &records_[pos & (kRingSize - 1)];
+        LONG diff = record->sequence - pos;
+        if (diff == 0)
+        {
+            LONG prev = InterlockedCompareExchange(&enqueue_pos_, pos + 1, pos);
+            if (prev == pos)
+                break;
+            pos = prev;
+        }
+        else if (diff < 0)
+        {
+            // ̨̻߳ûȡһȦ־
+            InterlockedIncrement(&dropped_);
+            return;
+        }
+        else
+        {
+            pos = enqueue_pos_;
+        }
+    }
+
+    FILETIME time;
+    GetSystemTimeAsFileTime(&time);
+    record->time = (static_cast<unsigned long long>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    record->level = static_cast<uint8>(level);
+    record->format = format;
+
+    LogLayout local;
+    const LogLayout *layout = GetLayout(format, &local);
+    int count = layout->arg_count;
+    int string_size = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        switch (layout->types[i])
+        {
+        case kLogArgInt:
+            record->args[i] = va_arg(args, int);
+            break;
+        case kLogArgInt64:
+            record->args[i] = va_arg(args, long long);
+            break;
+        case kLogArgDouble:
+        {
+            double value = va_arg(args, double);
+            memcpy(&record->args[i], &value, sizeof(value));
+            break;
+        }
+        case kLogArgString:
+        {
+            const char *str = va_arg(args, const char *);
+            if (str == nullptr)
+                str = "(null)";
+            int length = 0;
+            while (str[length] != '\0' && string_size + length < LogRecord::kStringSize - 1)
+            {
+                record->strings[string_size + length] = str[length];
+                ++length;
+            }
+            record->strings[string_size + length] = '\0';
+            record->args[i] = string_size;
+            string_size += length + 1;
+            // ַ֮Ϊ
+            if (string_size >= LogRecord::kStringSize)
+                string_size = LogRecord::kStringSize - 1;
+            break;
+        }
+        case kLogArgPointer:
+            record->args[i] = reinterpret_cast<long long>(va_arg(args, void *));
+            break;
+        default:
+            break;
+        }
+    }
+    record->arg_count = static_cast<uint8>(count);
+    record->string_size = static_cast<uint16>(string_size);
+
+    // дٷ̨߳
+    InterlockedExchange(&record->sequence, pos + 1);
+    // ÿднһκ̨̣߳ƽʱѯ
+    if ((pos & (kRingSize / 2 - 1)) == 0)
+    {
+        SetEvent(wake_);
+    }
+}
+
+void Logger::Format(const LogRecord &record, char *line, int size)
+{
+    int length = 0;
+    int arg = 0;
+    char spec_text[32];
+    for (const char *p = record.format; *p != '\0' && length < size - 1; )
+    {
+        if (*p != '%')
+        {
+            line[length++] = *p++;
+            continue;
+        }
+        ++p;
+        if (*p == '%')
+        {
+            line[length++] = *p++;
+            continue;
+        }
+
+        LogSpec spec;
+        p = parse_spec(p, &spec);
+        if (spec.type == kLogArgNone || arg + spec.stars + 1 > record.arg_count
+            || spec.length >= static_cast<int>(sizeof(spec_text)))
+        {
+            // ֵ֧תԭ
+            int n = min_t(spec.length, size - 1 - length);
+            memcpy(line + length, spec.begin, n);
+            length += n;
+            continue;
+        }
+        memcpy(spec_text, spec.begin, spec.length);
+        spec_text[spec.length] = '\0';
+
+        int star[2] = {0, 0};
+        for (int i = 0; i < spec.stars; ++i)
+        {
+            star[i] = static_cast<int>(record.args[arg++]);
+        }
+        long long value = record.args[arg++];
+        char *dst = line + length;
+        int room = size - 1 - length;
+        int n = 0;
+        switch (spec.type)
+        {
+        case kLogArgInt:
+        {
+            int v = static_cast<int>(value);
+            n = spec.stars == 0 ? _snprintf(dst, room, spec_text, v)
+              : spec.stars == 1 ? _snprintf(dst, room, spec_text, star[0], v)
+              : _snprintf(dst, room, spec_text, star[0], star[1], v);
+            break;
+        }
+        case kLogArgInt64:
+            n = spec.stars == 0 ? _snprintf(dst, room, spec_text, value)
+              : spec.stars == 1 ? _snprintf(dst, room, spec_text, star[0], value)
+              : _snprintf(dst, room, spec_text, star[0], star[1], value);
+            break;
+        case kLogArgDouble:
+        {
+            double v;
+            memcpy(&v, &value, sizeof(v));
+            n = spec.stars == 0 ? _snprintf(dst, room, spec_text, v)
+              : spec.stars == 1 ? _snprintf(dst, room, spec_text, star[0], v)
+              : _snprintf(dst, room, spec_text, star[0], star[1], v);
+            break;
+        }
+        case kLogArgString:
+        {
+            const char *v = record.strings + value;
+            n = spec.stars == 0 ? _snprintf(dst, room, spec_text, v)
+              : spec.stars == 1 ? _snprintf(dst, room, spec_text, star[0], v)
+              : _snprintf(dst, room, spec_text, star[0], star[1], v);
+            break;
+        }
+        case kLogArgPointer:
+        {
+            void *v = reinterpret_cast<void *>(value);
+            n = spec.stars == 0 ? _snprintf(dst, room, spec_text, v)
+              : spec.stars == 1 ? _snprintf(dst, room, spec_text, star[0], v)
+              : _snprintf(dst, room, spec_text, star[0], star[1], v);
+            break;
+        }
+        default:
+            break;
+        }
+        // _snprintfڽضʱظ
+        length += (n < 0 || n > room) ? room : n;
+    }
+    line[length] = '\0';
+}
+
+void Logger::Write(int level, const SYSTEMTIME &time, const char *text)
+{
+	size_t length = strlen(text);
 	
 	// װˣдļ
-	if (size_ + length + 2 > LOG_FILE_SZIE)
+	if (size_ + length + 100 > LOG_FILE_SZIE)
 	{
 		FlushToFile();
 	}
 	
 	// װ뻺
 	{
-		SYSTEMTIME time;
-		GetSystemTime(&time);
-
-		char* buffer = new char[length + 100];
-
 		static HANDLE consolehwnd;
 		consolehwnd = GetStdHandle(STD_OUTPUT_HANDLE);
 
-		switch(line[1])
+		switch(level)
 		{
-		case '0':
+		case kLogDebug:
 			SetConsoleTextAttribute(consolehwnd, FOREGROUND_GREEN | FOREGROUND_RED | FOREGROUND_BLUE );
 			break;
-		case '1':
+		case kLogInfo:
 			SetConsoleTextAttribute(consolehwnd, FOREGROUND_BLUE | FOREGROUND_GREEN );
 			break;
-		case '2':
+		case kLogWarning:
 			SetConsoleTextAttribute(consolehwnd, FOREGROUND_GREEN | FOREGROUND_RED | FOREGROUND_INTENSITY );
 			break;
-		case '3':
+		case kLogError:
 			SetConsoleTextAttribute(consolehwnd, FOREGROUND_RED | FOREGROUND_INTENSITY );
 			break;
 		}
 
-		sprintf(buffer, "[%d/%d/%d %d:%d(+8)] %s \r\n", time.wYear, time.wMonth, time.wDay, (time.wHour + 8) % 24, time.wMinute, line + 2);
-
-		memcpy(data_ + size_, buffer, strlen(buffer));
-		size_ += strlen(buffer);
+		char *buffer = data_ + size_;
+		int n = sprintf(buffer, "[%d/%d/%d %d:%d(+8)] %s \r\n", time.wYear, time.wMonth, time.wDay, (time.wHour + 8) % 24, time.wMinute, text);
+		size_ += n;
 
 		printf("%s", buffer);
-
-		delete[] buffer;
 	}
 	
 }
 
-void Logger::Log( const char* format, va_list args )
+int Logger::Drain(void)
+{
+    char line[1024];
+    int count = 0;
+    for (;;)
+    {
+        LogRecord &record = records_[dequeue_pos_ & (kRingSize - 1)];
+        if (record.sequence != dequeue_pos_ + 1)
+            break;
+
+        Format(record, line, sizeof(line));
+        FILETIME file_time;
+        file_time.dwLowDateTime = static_cast<DWORD>(record.time);
+        file_time.dwHighDateTime = static_cast<DWORD>(record.time >> 32);
+        SYSTEMTIME time;
+        FileTimeToSystemTime(&file_time, &time);
+        int level = record.level;
+
+        // Ƚλд
+        InterlockedExchange(&record.sequence, dequeue_pos_ + kRingSize);
+        ++dequeue_pos_;
+        ++count;
+        Write(level, time, line);
+    }
+
+    LONG dropped = InterlockedExchange(&dropped_, 0);
+    if (dropped > 0)
+    {
+        SYSTEMTIME time;
+        GetSystemTime(&time);
+        sprintf(line, "־%d", dropped);
+        Write(kLogWarning, time, line);
+    }
+    if (count > 0)
+    {
+        InterlockedExchangeAdd(&written_, count);
+    }
+    return count;
+}
+
+DWORD WINAPI Logger::WorkerProc(LPVOID param)
 {
-	char buffer[512];
-	vsprintf(buffer, format, args);
+    Logger *logger = static_cast<Logger *>(param);
+    for (;;)
+    {
+        // ȶ˳־ȡ־˳ǰһȡ־
+        bool exit = logger->exit_;
+        int count = logger->Drain();
+        if (exit)
+            break;
+        if (count == 0)
+        {
+            WaitForSingleObject(logger->wake_, kLogPollInterval);
+        }
+    }
+    return 0;
+}
 
-	Log(buffer);
+void Logger::Flush(void)
+{
+    LONG target = enqueue_pos_;
+    if (worker_ == NULL)
+    {
+        Drain();
+        return;
+    }
+    SetEvent(wake_);
+    while (written_ - target < 0)
+    {
+        Sleep(1);
+    }
 }
 
 void Logger::set_log_file(string file)
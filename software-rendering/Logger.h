@@ -1,15 +1,98 @@
 #pragma once
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <string>
 #include <Windows.h>
+#include "typedef.h"
 
-#define LOCAL_BUF_SIZE 1024
+enum LogLevel
+{
+    kLogDebug = 0,
+    kLogInfo = 1,
+    kLogWarning = 2,
+    kLogError = 3
+};
+
+// ־ڱھͱȥĬȫ
+#ifndef GT_LOG_LEVEL
+#define GT_LOG_LEVEL 0
+#endif
+
+// ־ͳһ⼸꣬ȥļҲֵ
+#if GT_LOG_LEVEL <= 0
+#define GT_LOG_DEBUG(...) Logger::GtLog(__VA_ARGS__)
+#else
+#define GT_LOG_DEBUG(...) ((void)0)
+#endif
+
+#if GT_LOG_LEVEL <= 1
+#define GT_LOG_INFO(...) Logger::GtLogInfo(__VA_ARGS__)
+#else
+#define GT_LOG_INFO(...) ((void)0)
+#endif
+
+#if GT_LOG_LEVEL <= 2
+#define GT_LOG_WARNING(...) Logger::GtLogWarning(__VA_ARGS__)
+#else
+#define GT_LOG_WARNING(...) ((void)0)
+#endif
+
+#if GT_LOG_LEVEL <= 3
+#define GT_LOG_ERROR(...) Logger::GtLogError(__VA_ARGS__)
+#else
+#define GT_LOG_ERROR(...) ((void)0)
+#endif
+
+// ζеһ־ֻ߳¸ʽʱͲĶֵʽɺ̨߳
+// ʽָ뱣棬ַ%sݻḴƣʱض
+class LogRecord
+{
+public:
+    enum
+    {
+        kMaxArgs = 16,
+        kStringSize = 96
+    };
+
+    // ζеţдλ+1ʱʾд
+    volatile LONG sequence;
+    uint8 level;
+    uint8 arg_count;
+    uint16 string_size;
+    const char *format;
+    // FILETIME
+    unsigned long long time;
+    // ָ밴8ֽڴţַstringsеƫƺͳ
+    long long args[kMaxArgs];
+    char strings[kStringSize];
+};
+
+// һʽҪȡĲͣʽָ뻺棬Pushÿɨʽ
+class LogLayout
+{
+public:
+    // 0գ1д룬2
+    volatile LONG state;
+    const char *format;
+    uint8 arg_count;
+    // LogArgTypeȡе*int
+    uint8 types[LogRecord::kMaxArgs];
+};
 
 class Logger
 {
 public:
-	~Logger(void);
+    enum
+    {
+        // 2
+        kRingSize = 4096,
+        // 2ݣװµĸʽÿֳ
+        kLayoutCacheSize = 256,
+        kLayoutProbes = 8
+    };
+
+    ~Logger(void);
     
     static inline Logger& Instance(void)
     {
@@ -19,56 +102,39 @@ public:
 
     void set_log_file(std::string file);
 
+    // ȴ̨߳д֮ǰ־
+    void Flush(void);
+
+    // ˣĺǷ
     static inline void GtLog(const char* format, ...)
     {
-        Logger &logger = Logger::Instance();
-
         va_list args;
-        va_start(args,format);
-        char buffer[LOCAL_BUF_SIZE];
-        strcpy_s(buffer, LOCAL_BUF_SIZE, "#0");
-        strcat_s(buffer, LOCAL_BUF_SIZE, format);
-        logger.Log( buffer, args );
+        va_start(args, format);
+        Logger::Instance().Push(kLogDebug, format, args);
         va_end(args);
-
     }
 
     static inline void GtLogInfo(const char* format, ...)
     {
-        Logger &logger = Logger::Instance();
-
         va_list args;
-        va_start(args,format);
-        char buffer[LOCAL_BUF_SIZE];
-        strcpy_s(buffer, LOCAL_BUF_SIZE, "#1");
-        strcat_s(buffer, LOCAL_BUF_SIZE, format);
-        logger.Log( buffer, args );
+        va_start(args, format);
+        Logger::Instance().Push(kLogInfo, format, args);
         va_end(args);
     }
 
     static inline void GtLogWarning(const char* format, ...)
     {
-        Logger &logger = Logger::Instance();
-
         va_list args;
-        va_start(args,format);
-        char buffer[LOCAL_BUF_SIZE];
-        strcpy_s(buffer, LOCAL_BUF_SIZE, "#2");
-        strcat_s(buffer, LOCAL_BUF_SIZE, format);
-        logger.Log( buffer, args );
+        va_start(args, format);
+        Logger::Instance().Push(kLogWarning, format, args);
         va_end(args);
     }
 
     static inline void GtLogError(const char* format, ...)
     {
-        Logger &logger = Logger::Instance();
-
         va_list args;
-        va_start(args,format);
-        char buffer[LOCAL_BUF_SIZE];
-        strcpy_s(buffer, LOCAL_BUF_SIZE, "#3");
-        strcat_s(buffer, LOCAL_BUF_SIZE, format);
-        logger.Log( buffer, args );
+        va_start(args, format);
+        Logger::Instance().Push(kLogError, format, args);
         va_end(args);
     }
 private:
@@ -76,13 +142,31 @@ private:
     Logger(const Logger&);
     Logger& operator=(const Logger&);
 
-    void Log(const char* line);
-    void Log(const char* format, va_list args);
+    // ̣߳ռһλд󷢲ʱ
+    void Push(LogLevel level, const char *format, va_list args);
+    // һʽĲͣصָLoggerǰЧ߾local
+    const LogLayout *GetLayout(const char *format, LogLayout *local);
+    // ̨̣߳ʽдѷ־ش
+    int Drain(void);
+    void Format(const LogRecord &record, char *line, int size);
+    void Write(int level, const SYSTEMTIME &time, const char *text);
+    static DWORD WINAPI WorkerProc(LPVOID param);
 
-	void FlushToFile();
-	char *data_;
-	size_t size_;
+    void FlushToFile();
+    char *data_;
+    size_t size_;
     std::string log_file_;
-};
 
-#undef LOCAL_BUF_SIZE
+    LogRecord *records_;
+    LogLayout *layouts_;
+    volatile LONG enqueue_pos_;
+    // ֻɺ̨߳޸
+    LONG dequeue_pos_;
+    // ѾдFlush
+    volatile LONG written_;
+    volatile LONG dropped_;
+
+    HANDLE worker_;
+    HANDLE wake_;
+    volatile bool exit_;
+};
\ No newline at end of file
@@ -0,0 +1,537 @@
+#include "MeshLod.h"
+#include <queue>
+#include <algorithm>
+#include <utility>
+#include <math.h>
+#include "mathdef.h"
+#include "Camera.h"
+
+using std::vector;
+
+void IndexedMesh::ToPrimitive(Primitive *primitive) const
+{
+    int size = static_cast<int>(indices.size());
+    Primitive ret(size, nullptr, nullptr);
+    for (int i = 0; i < size; ++i)
+    {
+        uint32 idx = indices[i];
+        ret.positions[i] = positions[idx];
+        ret.normals[i] = normals[idx];
+        ret.uvs[i] = uvs[idx];
+        ret.colors[i] = Vector4(1.0f, 1.0f, 1.0f, 1.0f);
+    }
+    if (tangents.size() == positions.size())
+    {
+        ret.tangents = new Vector4[size];
+        for (int i = 0; i < size; ++i)
+        {
+            ret.tangents[i] = tangents[indices[i]];
+        }
+    }
+    ret.ComputeBound();
+    *primitive = std::move(ret);
+}
+
+void IndexedMesh::ComputeTangents(void)
+{
+    size_t count = positions.size();
+    vector<Vector3> tan(count);
+    vector<Vector3> bitan(count);
+    // ÿεdP/dudP/dvۼӵ
+    for (size_t f = 0; f + 2 < indices.size(); f += 3)
+    {
+        uint32 i0 = indices[f];
+        uint32 i1 = indices[f + 1];
+        uint32 i2 = indices[f + 2];
+        Vector3 q1 = positions[i1] - positions[i0];
+        Vector3 q2 = positions[i2] - positions[i0];
+        float s1 = uvs[i1].u - uvs[i0].u;
+        float s2 = uvs[i2].u - uvs[i0].u;
+        float t1 = uvs[i1].v - uvs[i0].v;
+        float t2 = uvs[i2].v - uvs[i0].v;
+        float div = s1 * t2 - s2 * t1;
+        if (absf(div) < 1e-12f)
+            continue;
+        float r = 1.0f / div;
+        Vector3 t = (q1 * t2 - q2 * t1) * r;
+        Vector3 b = (q2 * s1 - q1 * s2) * r;
+        tan[i0] += t;
+        tan[i1] += t;
+        tan[i2] += t;
+        bitan[i0] += b;
+        bitan[i1] += b;
+        bitan[i2] += b;
+    }
+
+    tangents.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const Vector3 &n = normals[i];
+        Vector3 t = tan[i] - n * DotProduct(n, tan[i]);
+        float len = t.Magnitude();
+        if (len < 1e-12f)
+        {
+            // uv˻ȡһ뷨ߴֱķ
+            t = absf(n.x) < 0.9f ? CrossProduct(n, Vector3(1.0f, 0.0f, 0.0f)) : CrossProduct(n, Vector3(0.0f, 1.0f, 0.0f));
+            t.SetNormalize();
+        }
+        else
+        {
+            t = t * (1.0f / len);
+        }
+        float w = DotProduct(CrossProduct(n, t), bitan[i]) < 0.0f ? -1.0f : 1.0f;
+        tangents[i] = Vector4(t.x, t.y, t.z, w);
+    }
+}
+
+// Գ4x4ֻ
+class Quadric
+{
+public:
+    Quadric(void)
+        :a2(0), ab(0), ac(0), ad(0)
+        ,b2(0), bc(0), bd(0)
+        ,c2(0), cd(0)
+        ,d2(0) {}
+
+    // ƽ ax + by + cz + d = 0
+    Quadric(double a, double b, double c, double d)
+        :a2(a * a), ab(a * b), ac(a * c), ad(a * d)
+        ,b2(b * b), bc(b * c), bd(b * d)
+        ,c2(c * c), cd(c * d)
+        ,d2(d * d) {}
+
+    Quadric &operator+=(const Quadric &q)
+    {
+        a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+        b2 += q.b2; bc += q.bc; bd += q.bd;
+        c2 += q.c2; cd += q.cd;
+        d2 += q.d2;
+        return *this;
+    }
+
+    Quadric operator+(const Quadric &q) const
+    {
+        Quadric ret = *this;
+        ret += q;
+        return ret;
+    }
+
+    // 㵽ƽƽ
+    double Evaluate(const Vector3 &v) const
+    {
+        double x = v.x;
+        double y = v.y;
+        double z = v.z;
+        return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+             + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+             + c2 * z * z + 2 * cd * z
+             + d2;
+    }
+
+    double a2, ab, ac, ad;
+    double b2, bc, bd;
+    double c2, cd;
+    double d2;
+};
+
+// ѡ۵from۵to
+class EdgeCollapse
+{
+public:
+    double cost;
+    int from;
+    int to;
+    int from_version;
+    int to_version;
+
+    // priority_queueΪС۵
+    bool operator<(const EdgeCollapse &rhs) const
+    {
+        return cost > rhs.cost;
+    }
+};
+
+class Simplifier
+{
+public:
+    explicit Simplifier(const IndexedMesh &mesh);
+    float Run(int target_triangles);
+    void Output(IndexedMesh *dst) const;
+
+private:
+    Simplifier(const Simplifier&);
+    Simplifier& operator=(const Simplifier&);
+
+    void LockBorders(void);
+    void PushEdge(int a, int b);
+    bool IsFlipped(int from, int to) const;
+    void Collapse(int from, int to);
+
+    const IndexedMesh &mesh_;
+    vector<uint32> faces_;
+    vector<bool> face_removed_;
+    vector<vector<int> > vertex_faces_;
+    vector<Quadric> quadrics_;
+    vector<int> version_;
+    vector<bool> locked_;
+    vector<bool> removed_;
+    std::priority_queue<EdgeCollapse> heap_;
+    int live_faces_;
+};
+
+Simplifier::Simplifier(const IndexedMesh &mesh)
+    :mesh_(mesh)
+    ,faces_(mesh.indices)
+    ,face_removed_(mesh.indices.size() / 3, false)
+    ,vertex_faces_(mesh.positions.size())
+    ,quadrics_(mesh.positions.size())
+    ,version_(mesh.positions.size(), 0)
+    ,locked_(mesh.positions.size(), false)
+    ,removed_(mesh.positions.size(), false)
+    ,live_faces_(mesh.GetTriangleCount())
+{
+    for (int f = 0; f < live_faces_; ++f)
+    {
+        uint32 *idx = &faces_[f * 3];
+        const Vector3 &p0 = mesh_.positions[idx[0]];
+        const Vector3 &p1 = mesh_.positions[idx[1]];
+        const Vector3 &p2 = mesh_.positions[idx[2]];
+        Vector3 n = CrossProduct(p1 - p0, p2 - p0);
+        float len = n.Magnitude();
+        for (int j = 0; j < 3; ++j)
+        {
+            vertex_faces_[idx[j]].push_back(f);
+        }
+        if (len <= 0.0f)
+            continue;
+        n /= len;
+        Quadric q(n.x, n.y, n.z, -DotProduct(n, p0));
+        for (int j = 0; j < 3; ++j)
+        {
+            quadrics_[idx[j]] += q;
+        }
+    }
+    LockBorders();
+
+    for (int f = 0; f < live_faces_; ++f)
+    {
+        const uint32 *idx = &faces_[f * 3];
+        for (int j = 0; j < 3; ++j)
+        {
+            int a = idx[j];
+            int b = idx[(j + 1) % 3];
+            // ÿڲ߱ιãֻһѹ
+            if (a < b)
+                PushEdge(a, b);
+        }
+    }
+}
+
+// ű߽uvӷϵĶ㣬򻯺ѷ
+void Simplifier::LockBorders(void)
+{
+    vector<std::pair<uint32, uint32> > edges;
+    edges.reserve(faces_.size());
+    for (size_t i = 0; i < faces_.size(); i += 3)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            uint32 a = faces_[i + j];
+            uint32 b = faces_[i + (j + 1) % 3];
+            edges.push_back(std::make_pair(min_t(a, b), max_t(a, b)));
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    for (size_t i = 0; i < edges.size(); )
+    {
+        size_t j = i + 1;
+        while (j < edges.size() && edges[j] == edges[i])
+            ++j;
+        if (j - i == 1)
+        {
+            locked_[edges[i].first] = true;
+            locked_[edges[i].second] = true;
+        }
+        i = j;
+    }
+
+    // λͬͬĶλڽӷ
+    vector<std::pair<std::pair<float, float>, std::pair<float, int> > > sorted;
+    sorted.reserve(mesh_.positions.size());
+    for (size_t i = 0; i < mesh_.positions.size(); ++i)
+    {
+        const Vector3 &p = mesh_.positions[i];
+        sorted.push_back(std::make_pair(std::make_pair(p.x, p.y), std::make_pair(p.z, static_cast<int>(i))));
+    }
+    std::sort(sorted.begin(), sorted.end());
+    for (size_t i = 1; i < sorted.size(); ++i)
+    {
+        if (sorted[i].first == sorted[i - 1].first
+            && sorted[i].second.first == sorted[i - 1].second.first)
+        {
+            locked_[sorted[i].second.second] = true;
+            locked_[sorted[i - 1].second.second] = true;
+        }
+    }
+}
+
+void Simplifier::PushEdge(int a, int b)
+{
+    if (locked_[a] && locked_[b])
+        return;
+
+    Quadric q = quadrics_[a] + quadrics_[b];
+    EdgeCollapse c;
+    c.from_version = version_[a];
+    c.to_version = version_[b];
+    // ֻ۵ߵһ˵ϣ²ֵ
+    double cost_ab = locked_[a] ? DBL_MAX : q.Evaluate(mesh_.positions[b]);
+    double cost_ba = locked_[b] ? DBL_MAX : q.Evaluate(mesh_.positions[a]);
+    if (cost_ab <= cost_ba)
+    {
+        c.cost = cost_ab;
+        c.from = a;
+        c.to = b;
+    }
+    else
+    {
+        c.cost = cost_ba;
+        c.from = b;
+        c.to = a;
+        swap(c.from_version, c.to_version);
+    }
+    heap_.push(c);
+}
+
+bool Simplifier::IsFlipped(int from, int to) const
+{
+    const Vector3 &target = mesh_.positions[to];
+    const vector<int> &faces = vertex_faces_[from];
+    for (size_t i = 0; i < faces.size(); ++i)
+    {
+        int f = faces[i];
+        if (face_removed_[f])
+            continue;
+        const uint32 *idx = &faces_[f * 3];
+        if (idx[0] == to || idx[1] == to || idx[2] == to)
+            continue;
+
+        Vector3 p[3];
+        Vector3 q[3];
+        for (int j = 0; j < 3; ++j)
+        {
+            p[j] = mesh_.positions[idx[j]];
+            q[j] = (static_cast<int>(idx[j]) == from) ? target : p[j];
+        }
+        Vector3 n0 = CrossProduct(p[1] - p[0], p[2] - p[0]);
+        Vector3 n1 = CrossProduct(q[1] - q[0], q[2] - q[0]);
+        n0.SetNormalize();
+        n1.SetNormalize();
+        if (DotProduct(n0, n1) < 0.2f)
+            return true;
+    }
+    return false;
+}
+
+void Simplifier::Collapse(int from, int to)
+{
+    vector<int> &faces = vertex_faces_[from];
+    for (size_t i = 0; i < faces.size(); ++i)
+    {
+        int f = faces[i];
+        if (face_removed_[f])
+            continue;
+        uint32 *idx = &faces_[f * 3];
+        if (idx[0] == to || idx[1] == to || idx[2] == to)
+        {
+            face_removed_[f] = true;
+            --live_faces_;
+            continue;
+        }
+        for (int j = 0; j < 3; ++j)
+        {
+            if (static_cast<int>(idx[j]) == from)
+                idx[j] = to;
+        }
+        vertex_faces_[to].push_back(f);
+    }
+    faces.clear();
+
+    quadrics_[to] += quadrics_[from];
+    removed_[from] = true;
+    ++version_[to];
+
+    // ¼toΧĺѡ
+    const vector<int> &around = vertex_faces_[to];
+    for (size_t i = 0; i < around.size(); ++i)
+    {
+        int f = around[i];
+        if (face_removed_[f])
+            continue;
+        const uint32 *idx = &faces_[f * 3];
+        for (int j = 0; j < 3; ++j)
+        {
+            if (static_cast<int>(idx[j]) != to)
+                PushEdge(to, idx[j]);
+        }
+    }
+}
+
+float Simplifier::Run(int target_triangles)
+{
+    double max_cost = 0.0;
+    while (live_faces_ > target_triangles && !heap_.empty())
+    {
+        EdgeCollapse c = heap_.top();
+        heap_.pop();
+
+        if (c.cost == DBL_MAX)
+            break;
+        if (removed_[c.from] || removed_[c.to])
+            continue;
+        if (version_[c.from] != c.from_version || version_[c.to] != c.to_version)
+            continue;
+        if (IsFlipped(c.from, c.to))
+            continue;
+
+        Collapse(c.from, c.to);
+        max_cost = max_t(max_cost, c.cost);
+    }
+    return static_cast<float>(sqrt(max_cost));
+}
+
+void Simplifier::Output(IndexedMesh *dst) const
+{
+    vector<int> remap(mesh_.positions.size(), -1);
+    dst->positions.clear();
+    dst->normals.clear();
+    dst->uvs.clear();
+    dst->tangents.clear();
+    dst->indices.clear();
+    bool has_tangents = mesh_.tangents.size() == mesh_.positions.size();
+
+    for (size_t f = 0; f < face_removed_.size(); ++f)
+    {
+        if (face_removed_[f])
+            continue;
+        const uint32 *idx = &faces_[f * 3];
+        if (idx[0] == idx[1] || idx[1] == idx[2] || idx[0] == idx[2])
+            continue;
+        for (int j = 0; j < 3; ++j)
+        {
+            int v = idx[j];
+            if (remap[v] < 0)
+            {
+                remap[v] = static_cast<int>(dst->positions.size());
+                dst->positions.push_back(mesh_.positions[v]);
+                dst->normals.push_back(mesh_.normals[v]);
+                dst->uvs.push_back(mesh_.uvs[v]);
+                if (has_tangents)
+                    dst->tangents.push_back(mesh_.tangents[v]);
+            }
+            dst->indices.push_back(remap[v]);
+        }
+    }
+}
+
+float simplify_mesh(const IndexedMesh &src, int target_triangles, IndexedMesh *dst)
+{
+    Simplifier simplifier(src);
+    float error = simplifier.Run(target_triangles);
+    simplifier.Output(dst);
+    return error;
+}
+
+MeshLod::MeshLod(void)
+    :level_count_(0)
+    ,radius_(0.0f)
+{
+    for (int i = 0; i < kMaxLevel; ++i)
+    {
+        errors_[i] = 0.0f;
+    }
+}
+
+void MeshLod::Clear(void)
+{
+    for (int i = 0; i < level_count_; ++i)
+    {
+        levels_[i].Clear();
+        errors_[i] = 0.0f;
+    }
+    level_count_ = 0;
+    center_.SetZero();
+    radius_ = 0.0f;
+}
+
+void MeshLod::Build(const IndexedMesh &mesh, Material *material, Texture2D *texture)
+{
+    Clear();
+    if (mesh.positions.empty() || mesh.indices.empty())
+        return;
+
+    Vector3 min_p = mesh.positions[0];
+    Vector3 max_p = mesh.positions[0];
+    for (size_t i = 1; i < mesh.positions.size(); ++i)
+    {
+        const Vector3 &p = mesh.positions[i];
+        min_p = Vector3(min_t(min_p.x, p.x), min_t(min_p.y, p.y), min_t(min_p.z, p.z));
+        max_p = Vector3(max_t(max_p.x, p.x), max_t(max_p.y, p.y), max_t(max_p.z, p.z));
+    }
+    center_ = (min_p + max_p) * 0.5f;
+    for (size_t i = 0; i < mesh.positions.size(); ++i)
+    {
+        radius_ = max_t(radius_, (mesh.positions[i] - center_).Magnitude());
+    }
+
+    IndexedMesh current = mesh;
+    float error = 0.0f;
+    while (level_count_ < kMaxLevel)
+    {
+        Primitive &level = levels_[level_count_];
+        current.ToPrimitive(&level);
+        level.material = material;
+        level.texture = texture;
+        errors_[level_count_] = error;
+        ++level_count_;
+
+        int target = current.GetTriangleCount() / 2;
+        if (target < kMinTriangles)
+            break;
+        IndexedMesh next;
+        // ÿһһ򻯵õۼΪϽ
+        error += simplify_mesh(current, target, &next);
+        if (next.GetTriangleCount() >= current.GetTriangleCount())
+            break;
+        current = next;
+    }
+}
+
+int MeshLod::SelectLevel(Camera *camera, const Matrix44 &world, int viewport_height, float error_pixels) const
+{
+    if (level_count_ <= 1 || !camera)
+        return 0;
+
+    // ȡΪ
+    float scale = max_t(Vector3(world.m00, world.m01, world.m02).Magnitude(),
+                        max_t(Vector3(world.m10, world.m11, world.m12).Magnitude(),
+                              Vector3(world.m20, world.m21, world.m22).Magnitude()));
+    Vector3 center = center_ * world;
+    float dist = (center - camera->get_pos()).Magnitude() - radius_ * scale;
+    if (dist <= 0.0f)
+        return 0;
+
+    // distһλͶӰĻϵ
+    float rad_fov = angle2radian(camera->get_fov());
+    float pixels_per_unit = viewport_height * 0.5f / (dist * tanf(rad_fov * 0.5f));
+
+    int level = 0;
+    for (int i = 1; i < level_count_; ++i)
+    {
+        if (errors_[i] * scale * pixels_per_unit > error_pixels)
+            break;
+        level = i;
+    }
+    return level;
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <vector>
+#include <assert.h>
+#include "typedef.h"
+#include "vector.h"
+#include "matrix.h"
+#include "Primitive.h"
+
+class Camera;
+
+// ڴ˸ʽϽ
+class IndexedMesh
+{
+public:
+    std::vector<Vector3> positions;
+    std::vector<Vector3> normals;
+    std::vector<Vector2> uvs;
+    // ѡwΪ߷(1)
+    std::vector<Vector4> tangents;
+    std::vector<uint32> indices;
+
+    int GetTriangleCount(void) const
+    {
+        return static_cast<int>(indices.size() / 3);
+    }
+
+    // λúuv𶥵ߣԷ
+    void ComputeTangents(void);
+
+    // չΪб
+    void ToPrimitive(Primitive *primitive) const;
+};
+
+// ڶ(QEM)ı۵򻯣򻯵target_triangles
+// ۵󼸺ռ룩
+float simplify_mesh(const IndexedMesh &src, int target_triangles, IndexedMesh *dst);
+
+class MeshLod
+{
+public:
+    enum
+    {
+        kMaxLevel = 6,
+        // ڴֵʱһ
+        kMinTriangles = 32
+    };
+
+    MeshLod(void);
+    ~MeshLod(void) {}
+
+    // ʱȫLODÿһ
+    void Build(const IndexedMesh &mesh, Material *material, Texture2D *texture);
+    void Clear(void);
+
+    // ͶӰĻϵļѡֲڵļerror_pixels
+    int SelectLevel(Camera *camera, const Matrix44 &world, int viewport_height, float error_pixels) const;
+
+    int get_level_count(void) const
+    {
+        return level_count_;
+    }
+
+    Primitive *get_level(int level)
+    {
+        assert(level >= 0 && level < level_count_);
+        return &levels_[level];
+    }
+
+    float get_level_error(int level) const
+    {
+        return errors_[level];
+    }
+
+private:
+    MeshLod(const MeshLod&);
+    MeshLod& operator=(const MeshLod&);
+
+    Primitive levels_[kMaxLevel];
+    // ÿһȫϽ
+    float errors_[kMaxLevel];
+    int level_count_;
+    // ռΧ
+    Vector3 center_;
+    float radius_;
+};
@@ -0,0 +1,83 @@
+#include "NormalMap.h"
+#include <math.h>
+#include "Texture2D.h"
+#include "Logger.h"
+
+NormalMap::NormalMap(void)
+    :width_(0)
+    ,height_(0)
+{
+}
+
+void NormalMap::Clear(void)
+{
+    width_ = 0;
+    height_ = 0;
+    texels_.clear();
+}
+
+static uint32 pack_snorm8(float v)
+{
+    int i = static_cast<int>(floorf(clamp(v, -1.0f, 1.0f) * 127.0f + 0.5f));
+    return static_cast<uint32>(i) & 0xFF;
+}
+
+bool NormalMap::Build(Texture2D *bumpmap, float strength)
+{
+    Clear();
+    if (!bumpmap || !bumpmap->IsLocked())
+    {
+        GT_LOG_ERROR("bump map must be loaded and locked before building normal map");
+        return false;
+    }
+    int width = bumpmap->get_width();
+    int height = bumpmap->get_height();
+    if (width <= 0 || height <= 0)
+        return false;
+
+    // ȰѸ߶ȶÿtexelֻһ
+    std::vector<uint8> heights(width * height);
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            heights[y * width + x] = bumpmap->GetDumpData(x, y);
+        }
+    }
+    return Build(&heights[0], width, height, strength);
+}
+
+bool NormalMap::Build(const uint8 *heights, int width, int height, float strength)
+{
+    Clear();
+    if (!heights || width <= 0 || height <= 0)
+        return false;
+
+    std::vector<float> values(width * height);
+    for (int i = 0; i < width * height; ++i)
+    {
+        values[i] = heights[i] * (1.0f / 255.0f);
+    }
+
+    width_ = width;
+    height_ = height;
+    texels_.resize(width * height);
+    // Ĳ߶ݶȣԵضϣn = (-dh/du, -dh/dv, 1)
+    for (int y = 0; y < height; ++y)
+    {
+        const float *row = &values[y * width];
+        const float *up = &values[max_t(y - 1, 0) * width];
+        const float *down = &values[min_t(y + 1, height - 1) * width];
+        for (int x = 0; x < width; ++x)
+        {
+            int left = max_t(x - 1, 0);
+            int right = min_t(x + 1, width - 1);
+            Vector3 n(-(row[right] - row[left]) * 0.5f * strength,
+                      -(down[x] - up[x]) * 0.5f * strength,
+                      1.0f);
+            n.SetNormalize();
+            texels_[y * width + x] = pack_snorm8(n.x) | (pack_snorm8(n.y) << 8) | (pack_snorm8(n.z) << 16);
+        }
+    }
+    return true;
+}
\ No newline at end of file
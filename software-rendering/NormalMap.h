@@ -0,0 +1,56 @@
+#pragma once
+#include <vector>
+#include "typedef.h"
+#include "vector.h"
+
+class Texture2D;
+
+// L8߶ͼԤɵ߿ռ䷨ͼֻڼʱתһ
+// ÿtexelxyzзֽڣɫʱÿֻȡһ
+class NormalMap
+{
+public:
+    NormalMap(void);
+    ~NormalMap(void) {}
+
+    // ߶ͼLockstrengthΪ߶ȲķŴ
+    bool Build(Texture2D *bumpmap, float strength);
+    // ֱɸ߶ɣдţ0~255
+    bool Build(const uint8 *heights, int width, int height, float strength);
+    void Clear(void);
+
+    bool IsEmpty(void) const
+    {
+        return texels_.empty();
+    }
+
+    int get_width(void) const
+    {
+        return width_;
+    }
+
+    int get_height(void) const
+    {
+        return height_;
+    }
+
+    // uv[0,1]ʱضϣɫһ
+    Vector3 Sample(float u, float v) const
+    {
+        int x = static_cast<int>(clamp(u, 0.0f, 1.0f) * (width_ - 1) + 0.5f);
+        int y = static_cast<int>(clamp(v, 0.0f, 1.0f) * (height_ - 1) + 0.5f);
+        uint32 t = texels_[y * width_ + x];
+        const float k = 1.0f / 127.0f;
+        return Vector3(static_cast<signed char>(t & 0xFF) * k,
+                       static_cast<signed char>((t >> 8) & 0xFF) * k,
+                       static_cast<signed char>((t >> 16) & 0xFF) * k);
+    }
+
+private:
+    NormalMap(const NormalMap&);
+    NormalMap& operator=(const NormalMap&);
+
+    int width_;
+    int height_;
+    std::vector<uint32> texels_;
+};
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include "Occlusion.h"
+#include <assert.h>
+#include <algorithm>
+#include "Primitive.h"
+
+// wСڴֵĶΪڽƽ֮
+static const float kMinW = 1e-4f;
+
+OcclusionBuffer::OcclusionBuffer(void)
+    :depth_(kWidth * kHeight, 0.0f)
+    ,occluder_triangles_(0)
+{
+}
+
+void OcclusionBuffer::Clear(void)
+{
+    std::fill(depth_.begin(), depth_.end(), 0.0f);
+    occluder_triangles_ = 0;
+}
+
+static inline void to_screen(const Vector4 &p, float *x, float *y, float *inv_w)
+{
+    *inv_w = 1.0f / p.w;
+    *x = (p.x * *inv_w * 0.5f + 0.5f) * OcclusionBuffer::kWidth;
+    *y = (-p.y * *inv_w * 0.5f + 0.5f) * OcclusionBuffer::kHeight;
+}
+
+void OcclusionBuffer::DrawOccluder(const Primitive *primitive, const Matrix44 &world_view_proj)
+{
+    assert(primitive);
+    for (int i = 0; i + 2 < primitive->size; i += 3)
+    {
+        Vector4 p[3];
+        bool valid = true;
+        for (int j = 0; j < 3; ++j)
+        {
+            const Vector3 &v = primitive->positions[i + j];
+            p[j] = Vector4(v.x, v.y, v.z, 1.0f) * world_view_proj;
+            if (p[j].w < kMinW)
+                valid = false;
+        }
+        // ԽƽֱӶֻڵ
+        if (!valid)
+            continue;
+        RasterizeTriangle(p[0], p[1], p[2]);
+    }
+}
+
+void OcclusionBuffer::RasterizeTriangle(const Vector4 &p0, const Vector4 &p1, const Vector4 &p2)
+{
+    float x[3], y[3], inv_w[3];
+    to_screen(p0, &x[0], &y[0], &inv_w[0]);
+    to_screen(p1, &x[1], &y[1], &inv_w[1]);
+    to_screen(p2, &x[2], &y[2], &inv_w[2]);
+
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (absf(area) < 1.0f)
+        return;
+    // ڵﲻ棬ͳһΪ
+    if (area < 0)
+    {
+        swap(x[1], x[2]);
+        swap(y[1], y[2]);
+    }
+    float depth = min_t(min_t(inv_w[0], inv_w[1]), inv_w[2]);
+
+    int min_x = max_t(0, static_cast<int>(floorf(min_t(min_t(x[0], x[1]), x[2]))));
+    int max_x = min_t(kWidth - 1, static_cast<int>(floorf(max_t(max_t(x[0], x[1]), x[2]))));
+    int min_y = max_t(0, static_cast<int>(floorf(min_t(min_t(y[0], y[1]), y[2]))));
+    int max_y = min_t(kHeight - 1, static_cast<int>(floorf(max_t(max_t(y[0], y[1]), y[2]))));
+    if (min_x > max_x || min_y > max_y)
+        return;
+    // 4ض룬ڲѭ̶4·޷֧ڱ
+    min_x &= ~3;
+    max_x |= 3;
+
+    // ߺ e = a * x + b * y + cڲΪ
+    // ֻдȫǵأĸeСֵΪĵֵ0.5 * (|a| + |b|)
+    // cȥĲָǵزдεĹϻ
+    // һؿķ죬ֻڵ
+    float a[3], b[3], c[3];
+    for (int k = 0; k < 3; ++k)
+    {
+        int n = (k + 1) % 3;
+        a[k] = y[k] - y[n];
+        b[k] = x[n] - x[k];
+        c[k] = x[k] * y[n] - y[k] * x[n] - 0.5f * (absf(a[k]) + absf(b[k]));
+    }
+
+    ++occluder_triangles_;
+    for (int py = min_y; py <= max_y; ++py)
+    {
+        float cy = py + 0.5f;
+        float *row = &depth_[py * kWidth];
+        for (int px = min_x; px <= max_x; px += 4)
+        {
+            for (int lane = 0; lane < 4; ++lane)
+            {
+                float cx = px + lane + 0.5f;
+                float e0 = a[0] * cx + b[0] * cy + c[0];
+                float e1 = a[1] * cx + b[1] * cy + c[1];
+                float e2 = a[2] * cx + b[2] * cy + c[2];
+                float d = (e0 >= 0 && e1 >= 0 && e2 >= 0) ? depth : 0.0f;
+                row[px + lane] = max_t(row[px + lane], d);
+            }
+        }
+    }
+}
+
+bool OcclusionBuffer::IsOccluded(const Vector3 &bound_min, const Vector3 &bound_max, const Matrix44 &world_view_proj) const
+{
+    float min_x = FLT_MAX;
+    float max_x = -FLT_MAX;
+    float min_y = FLT_MAX;
+    float max_y = -FLT_MAX;
+    float nearest = 0.0f;
+    for (int i = 0; i < 8; ++i)
+    {
+        Vector4 corner((i & 1) ? bound_max.x : bound_min.x,
+                       (i & 2) ? bound_max.y : bound_min.y,
+                       (i & 4) ? bound_max.z : bound_min.z,
+                       1.0f);
+        Vector4 p = corner * world_view_proj;
+        // ΧпԽƽ棬޷ж
+        if (p.w < kMinW)
+            return false;
+        float x, y, inv_w;
+        to_screen(p, &x, &y, &inv_w);
+        min_x = min_t(min_x, x);
+        max_x = max_t(max_x, x);
+        min_y = min_t(min_y, y);
+        max_y = max_t(max_y, y);
+        nearest = max_t(nearest, inv_w);
+    }
+
+    int x0 = max_t(0, static_cast<int>(floorf(min_x)));
+    int x1 = min_t(kWidth - 1, static_cast<int>(floorf(max_x)));
+    int y0 = max_t(0, static_cast<int>(floorf(min_y)));
+    int y1 = min_t(kHeight - 1, static_cast<int>(floorf(max_y)));
+    // ȫĻ彻Ĳü
+    if (x0 > x1 || y0 > y1)
+        return false;
+
+    for (int py = y0; py <= y1; ++py)
+    {
+        const float *row = &depth_[py * kWidth];
+        for (int px = x0; px <= x1; ++px)
+        {
+            if (row[px] <= nearest)
+                return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <vector>
+#include "typedef.h"
+#include "vector.h"
+#include "matrix.h"
+
+class Primitive;
+
+// ͷֱڵȻ
+// 1/wֵԽԽ0ʾûڵ
+class OcclusionBuffer
+{
+public:
+    enum
+    {
+        kWidth = 256,
+        kHeight = 128
+    };
+
+    OcclusionBuffer(void);
+    ~OcclusionBuffer(void) {}
+
+    void Clear(void);
+
+    // ڵդ棬world_view_projռ任üռ
+    // ֻдȫǵأȡԶ㣬֤дڵʵڵࡢ
+    void DrawOccluder(const Primitive *primitive, const Matrix44 &world_view_proj);
+
+    // ΧĻϸǵضиڵʱtrue
+    bool IsOccluded(const Vector3 &bound_min, const Vector3 &bound_max, const Matrix44 &world_view_proj) const;
+
+    int get_occluder_triangles(void) const
+    {
+        return occluder_triangles_;
+    }
+
+private:
+    OcclusionBuffer(const OcclusionBuffer&);
+    OcclusionBuffer& operator=(const OcclusionBuffer&);
+
+    void RasterizeTriangle(const Vector4 &p0, const Vector4 &p1, const Vector4 &p2);
+
+    std::vector<float> depth_;
+    int occluder_triangles_;
+};
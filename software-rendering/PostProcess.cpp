@@ -0,0 +1,387 @@
+#include "PostProcess.h"
+#include <assert.h>
+#include <string.h>
+#include <math.h>
+#include <emmintrin.h>
+#include "Logger.h"
+
+// FXAAԵֵȲСmax( * kEdgeThreshold, kEdgeThresholdMin)ز
+static const float kEdgeThreshold = 0.125f;
+static const float kEdgeThresholdMin = 0.0312f;
+// ÿٵ̫ʱֵ÷߳
+static const int kMinBandRows = 16;
+
+void PostProcessSettings::set_lut(const uint8 *lut_r, const uint8 *lut_g, const uint8 *lut_b)
+{
+    memcpy(lut[0], lut_r, 256);
+    memcpy(lut[1], lut_g, 256);
+    memcpy(lut[2], lut_b, 256);
+    use_lut = true;
+}
+
+static bool same_table_settings(const PostProcessSettings &a, const PostProcessSettings &b)
+{
+    if (a.exposure != b.exposure || a.tone_mapping != b.tone_mapping
+        || a.gamma != b.gamma || a.use_lut != b.use_lut)
+        return false;
+    return !a.use_lut || memcmp(a.lut, b.lut, sizeof(a.lut)) == 0;
+}
+
+static inline float luma_of(uint32 c)
+{
+    uint32 r = (c >> 16) & 0xff;
+    uint32 g = (c >> 8) & 0xff;
+    uint32 b = c & 0xff;
+    return (r * 77 + g * 150 + b * 29) * (1.0f / (255.0f * 256.0f));
+}
+
+// wȡ0~256
+static inline uint32 lerp_argb(uint32 a, uint32 b, uint32 w)
+{
+    uint32 rb = ((a & 0x00ff00ff) * (256 - w) + (b & 0x00ff00ff) * w) >> 8;
+    uint32 ag = ((a >> 8) & 0x00ff00ff) * (256 - w) + ((b >> 8) & 0x00ff00ff) * w;
+    return (rb & 0x00ff00ff) | (ag & 0xff00ff00);
+}
+
+PostProcess::PostProcess(void)
+    :thread_count_(1)
+    ,worker_count_(0)
+    ,exit_(false)
+    ,band_count_(0)
+    ,buffer_(nullptr)
+    ,width_(0)
+    ,height_(0)
+    ,pitch_(0)
+    ,fxaa_(false)
+    ,table_valid_(false)
+    ,table_identity_(true)
+{
+    for (int i = 0; i < kMaxThreads; ++i)
+    {
+        workers_[i] = NULL;
+        start_events_[i] = NULL;
+        done_events_[i] = NULL;
+        bands_[i].owner = this;
+    }
+
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    thread_count_ = clamp(static_cast<int>(info.dwNumberOfProcessors), 1, static_cast<int>(kMaxThreads));
+}
+
+PostProcess::~PostProcess(void)
+{
+    Uninitialize();
+}
+
+void PostProcess::Uninitialize(void)
+{
+    if (worker_count_ == 0)
+        return;
+
+    exit_ = true;
+    for (int i = 0; i < worker_count_; ++i)
+    {
+        SetEvent(start_events_[i]);
+    }
+    WaitForMultipleObjects(worker_count_, workers_, TRUE, INFINITE);
+    for (int i = 0; i < worker_count_; ++i)
+    {
+        CloseHandle(workers_[i]);
+        CloseHandle(start_events_[i]);
+        CloseHandle(done_events_[i]);
+        workers_[i] = NULL;
+        start_events_[i] = NULL;
+        done_events_[i] = NULL;
+    }
+    worker_count_ = 0;
+    exit_ = false;
+}
+
+void PostProcess::set_thread_count(int count)
+{
+    count = clamp(count, 1, static_cast<int>(kMaxThreads));
+    if (count == thread_count_)
+        return;
+    // ߳һApplyʱµ
+    Uninitialize();
+    thread_count_ = count;
+}
+
+void PostProcess::StartThreads(void)
+{
+    for (int i = 0; i < thread_count_ - 1; ++i)
+    {
+        start_events_[i] = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+        done_events_[i] = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+        // 0ɵ̴߳
+        workers_[i] = CreateThread(nullptr, 0, WorkerProc, &bands_[i + 1], 0, nullptr);
+        if (!workers_[i])
+        {
+            GT_LOG_ERROR("create post process thread failed: %d", GetLastError());
+            CloseHandle(start_events_[i]);
+            CloseHandle(done_events_[i]);
+            start_events_[i] = NULL;
+            done_events_[i] = NULL;
+            break;
+        }
+        ++worker_count_;
+    }
+}
+
+DWORD WINAPI PostProcess::WorkerProc(LPVOID param)
+{
+    PostProcessBand *band = static_cast<PostProcessBand *>(param);
+    PostProcess *self = band->owner;
+    int index = static_cast<int>(band - self->bands_) - 1;
+    for (;;)
+    {
+        WaitForSingleObject(self->start_events_[index], INFINITE);
+        if (self->exit_)
+            break;
+        self->ProcessBand(band);
+        SetEvent(self->done_events_[index]);
+    }
+    return 0;
+}
+
+bool PostProcess::BuildTable(const PostProcessSettings &settings)
+{
+    if (table_valid_ && same_table_settings(settings, table_settings_))
+        return !table_identity_;
+
+    float exposure = max_t(settings.exposure, 0.0f);
+    float white = max_t(exposure, 1e-4f);
+    float inv_gamma = 1.0f / max_t(settings.gamma, 1e-4f);
+    table_identity_ = true;
+    for (int c = 0; c < 3; ++c)
+    {
+        for (int i = 0; i < 256; ++i)
+        {
+            float v = i / 255.0f * exposure;
+            if (settings.tone_mapping)
+            {
+                v = v * (1.0f + v / (white * white)) / (1.0f + v);
+            }
+            v = powf(clamp(v, 0.0f, 1.0f), inv_gamma);
+            int out = static_cast<int>(v * 255.0f + 0.5f);
+            if (settings.use_lut)
+            {
+                out = settings.lut[c][out];
+            }
+            table_[c][i] = static_cast<uint8>(out);
+            if (out != i)
+                table_identity_ = false;
+        }
+    }
+    table_settings_ = settings;
+    table_valid_ = true;
+    return !table_identity_;
+}
+
+void PostProcess::Apply(const PostProcessSettings &settings, uint32 *buffer, int width, int height, int pitch)
+{
+    bool grading = BuildTable(settings);
+    if (!settings.fxaa && !grading)
+        return;
+    assert(buffer && width > 0 && height > 0);
+
+    buffer_ = buffer;
+    width_ = width;
+    height_ = height;
+    pitch_ = pitch;
+    fxaa_ = settings.fxaa;
+
+    if (thread_count_ > 1 && worker_count_ == 0)
+    {
+        StartThreads();
+    }
+    band_count_ = clamp(height / kMinBandRows, 1, worker_count_ + 1);
+
+    // ֶΣκ߳д֮ǰڵ
+    for (int i = 0; i < kMaxThreads; ++i)
+    {
+        PostProcessBand &band = bands_[i];
+        band.y_begin = i < band_count_ ? height * i / band_count_ : 0;
+        band.y_end = i < band_count_ ? height * (i + 1) / band_count_ : 0;
+        if (i >= band_count_ || !fxaa_)
+            continue;
+        if (band.y_begin > 0)
+        {
+            const uint32 *src = buffer_ + (band.y_begin - 1) * (pitch_ / 4);
+            band.halo_top.assign(src, src + width_);
+        }
+        if (band.y_end < height_)
+        {
+            const uint32 *src = buffer_ + band.y_end * (pitch_ / 4);
+            band.halo_bottom.assign(src, src + width_);
+        }
+    }
+
+    for (int i = 0; i < worker_count_; ++i)
+    {
+        SetEvent(start_events_[i]);
+    }
+    ProcessBand(&bands_[0]);
+    if (worker_count_ > 0)
+    {
+        WaitForMultipleObjects(worker_count_, done_events_, TRUE, INFINITE);
+    }
+}
+
+void PostProcess::ProcessBand(PostProcessBand *band)
+{
+    if (band->y_begin >= band->y_end)
+        return;
+
+    // ûFXAAʱز
+    if (!fxaa_)
+    {
+        for (int y = band->y_begin; y < band->y_end; ++y)
+        {
+            uint32 *row = buffer_ + y * (pitch_ / 4);
+            for (int x = 0; x < width_; ++x)
+            {
+                uint32 c = row[x];
+                row[x] = (c & 0xff000000)
+                       | (table_[0][(c >> 16) & 0xff] << 16)
+                       | (table_[1][(c >> 8) & 0xff] << 8)
+                       | table_[2][c & 0xff];
+            }
+        }
+        return;
+    }
+
+    for (int i = 0; i < 3; ++i)
+    {
+        band->colors[i].resize(width_ + 2);
+        band->lumas[i].resize(width_ + 2);
+    }
+
+    // еֻʹãͼ߽紦ظԵ
+    int up = 0;
+    int mid = 1;
+    int down = 2;
+    uint32 *first = buffer_ + band->y_begin * (pitch_ / 4);
+    LoadRow(band, mid, first);
+    LoadRow(band, up, band->y_begin > 0 ? &band->halo_top[0] : first);
+    for (int y = band->y_begin; y < band->y_end; ++y)
+    {
+        uint32 *row = buffer_ + y * (pitch_ / 4);
+        if (y + 1 < band->y_end)
+            LoadRow(band, down, row + pitch_ / 4);
+        else if (y + 1 < height_)
+            LoadRow(band, down, &band->halo_bottom[0]);
+        else
+            LoadRow(band, down, row);
+
+        FxaaRow(band, up, mid, down, row);
+
+        int t = up;
+        up = mid;
+        mid = down;
+        down = t;
+    }
+}
+
+void PostProcess::LoadRow(PostProcessBand *band, int slot, const uint32 *src)
+{
+    uint32 *colors = &band->colors[slot][0];
+    float *lumas = &band->lumas[slot][0];
+    for (int x = 0; x < width_; ++x)
+    {
+        uint32 c = src[x];
+        c = (c & 0xff000000)
+          | (table_[0][(c >> 16) & 0xff] << 16)
+          | (table_[1][(c >> 8) & 0xff] << 8)
+          | table_[2][c & 0xff];
+        colors[x + 1] = c;
+        lumas[x + 1] = luma_of(c);
+    }
+    colors[0] = colors[1];
+    lumas[0] = lumas[1];
+    colors[width_ + 1] = colors[width_];
+    lumas[width_ + 1] = lumas[width_];
+}
+
+// 򻯵FXAAԵ˵㣬ֲֻȶԱȶرԵ߷һ
+void PostProcess::FxaaRow(PostProcessBand *band, int up, int mid, int down, uint32 *dst)
+{
+    const uint32 *cu = &band->colors[up][1];
+    const uint32 *cm = &band->colors[mid][1];
+    const uint32 *cd = &band->colors[down][1];
+    const float *lu = &band->lumas[up][1];
+    const float *lm = &band->lumas[mid][1];
+    const float *ld = &band->lumas[down][1];
+
+    const __m128 threshold = _mm_set1_ps(kEdgeThreshold);
+    const __m128 threshold_min = _mm_set1_ps(kEdgeThresholdMin);
+    int x = 0;
+    while (x < width_)
+    {
+        // ĸһжǷбԵ󲿷ؿֱд
+        int mask = 0xf;
+        if (x + 4 <= width_)
+        {
+            __m128 m = _mm_loadu_ps(lm + x);
+            __m128 n = _mm_loadu_ps(lu + x);
+            __m128 s = _mm_loadu_ps(ld + x);
+            __m128 w = _mm_loadu_ps(lm + x - 1);
+            __m128 e = _mm_loadu_ps(lm + x + 1);
+            __m128 lmax = _mm_max_ps(_mm_max_ps(_mm_max_ps(n, s), _mm_max_ps(w, e)), m);
+            __m128 lmin = _mm_min_ps(_mm_min_ps(_mm_min_ps(n, s), _mm_min_ps(w, e)), m);
+            __m128 range = _mm_sub_ps(lmax, lmin);
+            __m128 limit = _mm_max_ps(threshold_min, _mm_mul_ps(lmax, threshold));
+            mask = _mm_movemask_ps(_mm_cmpge_ps(range, limit));
+            if (!mask)
+            {
+                memcpy(dst + x, cm + x, 4 * sizeof(uint32));
+                x += 4;
+                continue;
+            }
+        }
+
+        int count = min_t(4, width_ - x);
+        for (int i = 0; i < count; ++i, ++x)
+        {
+            float m = lm[x];
+            float n = lu[x];
+            float s = ld[x];
+            float w = lm[x - 1];
+            float e = lm[x + 1];
+            float lmax = max_t(max_t(max_t(n, s), max_t(w, e)), m);
+            float lmin = min_t(min_t(min_t(n, s), min_t(w, e)), m);
+            float range = lmax - lmin;
+            if (!(mask & (1 << i)) || range < max_t(kEdgeThresholdMin, lmax * kEdgeThreshold))
+            {
+                dst[x] = cm[x];
+                continue;
+            }
+
+            float nw = lu[x - 1];
+            float ne = lu[x + 1];
+            float sw = ld[x - 1];
+            float se = ld[x + 1];
+            float edge_vert = absf(0.25f * nw - 0.5f * n + 0.25f * ne)
+                            + absf(0.5f * w - m + 0.5f * e)
+                            + absf(0.25f * sw - 0.5f * s + 0.25f * se);
+            float edge_horz = absf(0.25f * nw - 0.5f * w + 0.25f * sw)
+                            + absf(0.5f * n - m + 0.5f * s)
+                            + absf(0.25f * ne - 0.5f * e + 0.25f * se);
+
+            // ˮƽԵػϣֱԵػϣȡݶȴһ
+            uint32 other;
+            if (edge_horz >= edge_vert)
+                other = absf(n - m) >= absf(s - m) ? cu[x] : cd[x];
+            else
+                other = absf(w - m) >= absf(e - m) ? cm[x - 1] : cm[x + 1];
+
+            // ػ
+            float average = (2.0f * (n + s + w + e) + nw + ne + sw + se) * (1.0f / 12.0f);
+            float blend = clamp(absf(average - m) / range, 0.0f, 1.0f);
+            blend = (3.0f - 2.0f * blend) * blend * blend;
+            blend = blend * blend * 0.75f;
+            dst[x] = lerp_argb(cm[x], other, static_cast<uint32>(blend * 256.0f));
+        }
+    }
+}
\ No newline at end of file
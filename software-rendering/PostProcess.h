@@ -0,0 +1,119 @@
+#pragma once
+#include <vector>
+#include <Windows.h>
+#include "typedef.h"
+
+// Ⱦʱ֡״̬һȡ
+class PostProcessSettings
+{
+public:
+    PostProcessSettings(void)
+        :fxaa(false)
+        ,exposure(1.0f)
+        ,tone_mapping(false)
+        ,gamma(1.0f)
+        ,use_lut(false)
+    {
+        for (int i = 0; i < 256; ++i)
+        {
+            lut[0][i] = lut[1][i] = lut[2][i] = static_cast<uint8>(i);
+        }
+    }
+
+    // ÿͨ256ĵɫߣΪrgb
+    void set_lut(const uint8 *lut_r, const uint8 *lut_g, const uint8 *lut_b);
+
+    bool fxaa;
+    // عⱶ1.0Ϊ
+    float exposure;
+    // չReinhard׵ȡعֵ1.0ӳ䵽1.0
+    bool tone_mapping;
+    // 1/gammaݣ1.0Ϊ
+    float gamma;
+    bool use_lut;
+    uint8 lut[3][256];
+};
+
+class PostProcess;
+
+// ÿ̴߳
+class PostProcessBand
+{
+public:
+    PostProcessBand(void)
+        :owner(nullptr)
+        ,y_begin(0)
+        ,y_end(0) {}
+
+    PostProcess *owner;
+    int y_begin;
+    int y_end;
+    // ʼǰԭʼݣ߳̿Ѿд
+    std::vector<uint32> halo_top;
+    std::vector<uint32> halo_bottom;
+    // FXAAڣϡСеɫɫȣҸһ
+    std::vector<uint32> colors[3];
+    std::vector<float> lumas[3];
+};
+
+// ֡ϵĺԭ޸ARGB32
+// ع⡢ɫӳ䡢gammaɫߺϲΪÿͨһŲұFXAAһζд
+// FXAAֻҪеĻڣͼзֶν߳
+class PostProcess
+{
+public:
+    enum
+    {
+        kMaxThreads = 8
+    };
+
+    PostProcess(void);
+    ~PostProcess(void);
+
+    // ֹͣ߳
+    void Uninitialize(void);
+
+    // 1ʾֻڵ߳ϴĬȡCPU
+    void set_thread_count(int count);
+
+    int get_thread_count(void)
+    {
+        return thread_count_;
+    }
+
+    void Apply(const PostProcessSettings &settings, uint32 *buffer, int width, int height, int pitch);
+
+private:
+    PostProcess(const PostProcess&);
+    PostProcess& operator=(const PostProcess&);
+
+    // 仯ʱؽұfalseʾұǺӳ
+    bool BuildTable(const PostProcessSettings &settings);
+    void StartThreads(void);
+    void ProcessBand(PostProcessBand *band);
+    void LoadRow(PostProcessBand *band, int slot, const uint32 *src);
+    void FxaaRow(PostProcessBand *band, int up, int mid, int down, uint32 *dst);
+    static DWORD WINAPI WorkerProc(LPVOID param);
+
+    int thread_count_;
+    int worker_count_;
+    HANDLE workers_[kMaxThreads];
+    HANDLE start_events_[kMaxThreads];
+    HANDLE done_events_[kMaxThreads];
+    volatile bool exit_;
+
+    PostProcessBand bands_[kMaxThreads];
+    int band_count_;
+
+    // ǰ֡
+    uint32 *buffer_;
+    int width_;
+    int height_;
+    int pitch_;
+    bool fxaa_;
+
+    PostProcessSettings table_settings_;
+    bool table_valid_;
+    bool table_identity_;
+    uint8 table_[3][256];
+};
\ No newline at end of file
@@ -9,13 +9,15 @@ class Primitive
 {
 public:
     Primitive(void)
-        :size(size)
+        :size(0)
         ,positions(nullptr)
         ,normals(nullptr)
         ,colors(nullptr)
         ,uvs(nullptr)
+        ,tangents(nullptr)
         ,material(nullptr)
-        ,texture(nullptr) {}
+        ,texture(nullptr)
+        ,has_bound(false) {}
 
     Primitive(int size, Material *material, Texture2D *texture)
         :size(size)
@@ -23,8 +25,10 @@ public:
         ,normals(new Vector3[size])
         ,colors(new Vector4[size])
         ,uvs(new Vector2[size])
+        ,tangents(nullptr)
         ,material(material)
-        ,texture(texture){}
+        ,texture(texture)
+        ,has_bound(false) {}
 
     ~Primitive(void) 
     {
@@ -37,16 +41,22 @@ public:
         ,normals(r.normals)
         ,colors(r.colors)
         ,uvs(r.uvs)
+        ,tangents(r.tangents)
         ,material(r.material)
         ,texture(r.texture)
+        ,bound_min(r.bound_min)
+        ,bound_max(r.bound_max)
+        ,has_bound(r.has_bound)
     {
         r.size = 0;
         r.positions = nullptr;
         r.normals = nullptr;
         r.colors = nullptr;
         r.uvs = nullptr;
+        r.tangents = nullptr;
         r.material = nullptr;
         r.texture = nullptr;
+        r.has_bound = false;
     }
 
     Primitive &operator=(Primitive &&rhs)
@@ -57,16 +67,22 @@ public:
         normals = rhs.normals;
         colors = rhs.colors;
         uvs = rhs.uvs;
+        tangents = rhs.tangents;
         material = rhs.material;
         texture = rhs.texture;
+        bound_min = rhs.bound_min;
+        bound_max = rhs.bound_max;
+        has_bound = rhs.has_bound;
 
         rhs.size = 0;
         rhs.positions = nullptr;
         rhs.normals = nullptr;
         rhs.colors = nullptr;
         rhs.uvs = nullptr;
+        rhs.tangents = nullptr;
         rhs.material = nullptr;
         rhs.texture = nullptr;
+        rhs.has_bound = false;
 
         return *this;
     }
@@ -88,10 +104,41 @@ public:
             delete[] colors;
             colors = nullptr;
         }
+        if (uvs)
+        {
+            delete[] uvs;
+            uvs = nullptr;
+        }
+        if (tangents)
+        {
+            delete[] tangents;
+            tangents = nullptr;
+        }
 
         material = nullptr;
         texture = nullptr;
         size = 0;
+        has_bound = false;
+    }
+
+    // ռΧУڵ޳ʹ
+    void ComputeBound(void)
+    {
+        has_bound = (size > 0);
+        if (!has_bound)
+            return;
+        bound_min = positions[0];
+        bound_max = positions[0];
+        for (int i = 1; i < size; ++i)
+        {
+            const Vector3 &p = positions[i];
+            bound_min.x = min_t(bound_min.x, p.x);
+            bound_min.y = min_t(bound_min.y, p.y);
+            bound_min.z = min_t(bound_min.z, p.z);
+            bound_max.x = max_t(bound_max.x, p.x);
+            bound_max.y = max_t(bound_max.y, p.y);
+            bound_max.z = max_t(bound_max.z, p.z);
+        }
     }
 public:
     int size;
@@ -99,8 +146,13 @@ public:
     Vector3 *normals;
     Vector4 *colors;
     Vector2 *uvs;
+    // ߣwΪ߷(1)ûʱΪnullptr
+    Vector4 *tangents;
     Material *material;
     Texture2D *texture;
+    Vector3 bound_min;
+    Vector3 bound_max;
+    bool has_bound;
 
 //    Light *light;
 private:
@@ -115,6 +167,8 @@ public:
     Vector4 color;
     Vector2 uv;
     Vector3 global_pos;
+    // ռߣwΪ߷Ϊ0ʾû
+    Vector4 tangent;
 };
 
 class RendPrimitive
@@ -170,13 +224,25 @@ private:
 };
 
 
+// PhongյļƵʣȺأزͰ͸
+enum ShadingRate
+{
+    kShadingRate1x1 = 0,
+    kShadingRate2x2 = 1,
+    kShadingRate4x4 = 2,
+    // Ļϵķ߱仯ѡ
+    kShadingRateAdaptive = 3,
+    kShadingRateCount = 4
+};
+
+// üֻ¼ڱ任󶥵е±
 class Triangle
 {
 public:
-    Triangle(void) {}
-    Triangle(const RendVertex &v0,
-             const RendVertex &v1,
-             const RendVertex &v2)
+    Triangle(void)
+        :shading_rate(kShadingRate1x1) {}
+    Triangle(uint32 v0, uint32 v1, uint32 v2)
+        :shading_rate(kShadingRate1x1)
     {
         v[0] = v0;
         v[1] = v1;
@@ -184,9 +250,9 @@ public:
     }
     ~Triangle(void) {}
 
-    RendVertex v[3];
-
-//    Vector2 uv[3][2];
+    uint32 v[3];
+    // ռƵʣȡShadingRate
+    uint32 shading_rate;
 };
 
 class Material
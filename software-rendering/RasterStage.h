@@ -0,0 +1,1076 @@
+#pragma once
+#include <emmintrin.h>
+#include "Renderer.h"
+#include "util.h"
+
+// Rendererаɫʵģ壺ν׶εĶɫ͹դ׶εɨ
+// ͷļԼɫRenderer::DrawPrimitiveʱҲʵ
+
+// d > 0
+static inline long long floor_div(long long n, long long d)
+{
+    long long q = n / d;
+    if (n % d != 0 && n < 0)
+        --q;
+    return q;
+}
+
+// դʼʱѱ֡״̬ɫһɫҪ
+template <class PixelShader>
+inline void bind_frame_state(const FrameState &frame, int width, int height, PixelShader *shader)
+{
+}
+
+// Phongɫդ׶β֪֡Ӱ͹դķֱ
+template <bool kTextured, bool kNormalMapped>
+inline void bind_frame_state(const FrameState &frame, int width, int height, PhongPixelShader<kTextured, kNormalMapped> *shader)
+{
+    if (frame.shadow)
+    {
+        shader->set_shadow(frame.shadow, frame.camera_to_light, frame.view_scale_x, frame.view_scale_y, width, height);
+    }
+}
+
+template <class VertexShader, class PixelShader>
+void Renderer::ExecuteDraw(Primitive *primitive, const Matrix44 *transforms, int count,
+                           const VertexShader &vs, const PixelShader &ps)
+{
+    assert(primitive);
+    assert(transforms || count == 0);
+    if (count <= 0 || primitive->size <= 0)
+        return;
+
+    // ɫգɫҪֵռʱҪռĶ
+    bool lit = VertexShader::kLit || (PixelShader::kVaryings & (kVaryingNormal | kVaryingPos | kVaryingTangent)) != 0;
+    int visible = PrepareInstances(primitive, transforms, count, lit);
+    if (visible == 0)
+        return;
+
+    // ʵ޹صĹÿλֻһΣȡuvɫɫ
+    double start = get_time_ms();
+    FetchVertices(primitive);
+    int first = static_cast<int>(triangles_.size());
+    int translucent = static_cast<int>(translucent_.size());
+    ProcessInstances(primitive, vs, lit, static_cast<int>(bindings_.size()));
+    // ȫ޳õʱɫ
+    if (static_cast<int>(triangles_.size()) > first || static_cast<int>(translucent_.size()) > translucent)
+    {
+        PixelShaderBinding binding;
+        binding.shader = new PixelShader(ps);
+        binding.destroy = DestroyShader<PixelShader>;
+        binding.bind = BindShader<PixelShader>;
+        binding.rasterize = RasterizeBinding<PixelShader>;
+        binding.blend = BlendBinding<PixelShader>;
+        binding.first = first;
+        binding.last = static_cast<int>(triangles_.size());
+        bindings_.push_back(binding);
+    }
+    stats_.geometry_instances += visible;
+    stats_.geometry_ms += get_time_ms() - start;
+}
+
+template <class PixelShader>
+void Renderer::DestroyShader(void *shader)
+{
+    delete static_cast<PixelShader *>(shader);
+}
+
+template <class PixelShader>
+void Renderer::BindShader(Renderer *renderer, void *shader)
+{
+    bind_frame_state(renderer->frame_, renderer->render_width_, renderer->render_height_, static_cast<PixelShader *>(shader));
+}
+
+template <class PixelShader>
+void Renderer::RasterizeBinding(Renderer *renderer, const PixelShaderBinding &binding, DepthPass depth, bool msaa)
+{
+    const PixelShader &shader = *static_cast<const PixelShader *>(binding.shader);
+    if (msaa)
+    {
+        for (int i = binding.first; i < binding.last; ++i)
+        {
+            renderer->DiffTriangleMsaa(renderer->frame_.triangles[i], shader);
+        }
+    }
+    else if (depth == kDepthPassEqual)
+    {
+        renderer->DiffTriangles<kDepthPassEqual>(shader, binding.first, binding.last);
+    }
+    else
+    {
+        renderer->DiffTriangles<kDepthPassShade>(shader, binding.first, binding.last);
+    }
+}
+
+template <class PixelShader>
+void Renderer::BlendBinding(Renderer *renderer, const PixelShaderBinding &binding, const TranslucentTriangle &translucent,
+                            int min_x, int min_y, int max_x, int max_y)
+{
+    const PixelShader &shader = *static_cast<const PixelShader *>(binding.shader);
+    renderer->DiffTriangleBlend(translucent, min_x, min_y, max_x, max_y, shader);
+}
+
+template <class VertexShader>
+void Renderer::ProcessInstances(const Primitive *primitive, const VertexShader &shader, bool lit, int binding)
+{
+    int visible = static_cast<int>(instance_matrices_.size());
+    for (int i = 0; i < visible; ++i)
+    {
+        int first = static_cast<int>(triangles_.size());
+        TransformVertices(primitive, instance_matrices_[i], lit);
+        ShadeVertices(shader);
+        Clipping();
+        if (blend_mode_ != kBlendOpaque)
+        {
+            QueueTranslucent(first, lit, binding);
+        }
+        else if (shading_rate_ != kShadingRate1x1)
+        {
+            for (int j = first; j < triangles_.size(); ++j)
+            {
+                triangles_[j].shading_rate = shading_rate_;
+            }
+        }
+    }
+}
+
+template <class VertexShader>
+void Renderer::ShadeVertices(const VertexShader &shader)
+{
+    for (int i = 0; i + 2 < rend_primitive_.size; i += 3)
+    {
+        shader(rend_primitive_.vertexs + i);
+    }
+}
+
+// kVaryingsΪҪֵԣkPerspectiveе԰attr/wԲֵɫǰٳ1/zԭ
+// ǱڳûõԲɴ
+template <uint32 kVaryings, uint32 kPerspective>
+class VaryingOps
+{
+public:
+    static void Load(const RendVertex &vertex, Varyings *out)
+    {
+        float w = vertex.position.w;
+        if (kVaryings & kVaryingColor)
+            out->color = (kPerspective & kVaryingColor) ? vertex.color / w : vertex.color;
+        if (kVaryings & kVaryingUv)
+            out->uv = (kPerspective & kVaryingUv) ? vertex.uv / w : vertex.uv;
+        if (kVaryings & kVaryingNormal)
+            out->normal = (kPerspective & kVaryingNormal) ? vertex.normal / w : vertex.normal;
+        if (kVaryings & kVaryingPos)
+            out->pos = (kPerspective & kVaryingPos) ? vertex.global_pos / w : vertex.global_pos;
+        if (kVaryings & kVaryingTangent)
+            out->tangent = (kPerspective & kVaryingTangent) ? vertex.tangent / w : vertex.tangent;
+    }
+
+    // out = (a - b) / d
+    static void Delta(const Varyings &a, const Varyings &b, float d, Varyings *out)
+    {
+        if (kVaryings & kVaryingColor)
+            out->color = (a.color - b.color) / d;
+        if (kVaryings & kVaryingUv)
+            out->uv = (a.uv - b.uv) / d;
+        if (kVaryings & kVaryingNormal)
+            out->normal = (a.normal - b.normal) / d;
+        if (kVaryings & kVaryingPos)
+            out->pos = (a.pos - b.pos) / d;
+        if (kVaryings & kVaryingTangent)
+            out->tangent = (a.tangent - b.tangent) / d;
+    }
+
+    // out += delta
+    static void Step(const Varyings &delta, Varyings *out)
+    {
+        if (kVaryings & kVaryingColor)
+            out->color += delta.color;
+        if (kVaryings & kVaryingUv)
+            out->uv += delta.uv;
+        if (kVaryings & kVaryingNormal)
+            out->normal += delta.normal;
+        if (kVaryings & kVaryingPos)
+            out->pos += delta.pos;
+        if (kVaryings & kVaryingTangent)
+            out->tangent += delta.tangent;
+    }
+
+    // out += delta * t
+    static void Step(const Varyings &delta, float t, Varyings *out)
+    {
+        if (kVaryings & kVaryingColor)
+            out->color += delta.color * t;
+        if (kVaryings & kVaryingUv)
+            out->uv += delta.uv * t;
+        if (kVaryings & kVaryingNormal)
+            out->normal += delta.normal * t;
+        if (kVaryings & kVaryingPos)
+            out->pos += delta.pos * t;
+        if (kVaryings & kVaryingTangent)
+            out->tangent += delta.tangent * t;
+    }
+
+    // õɫõֵ͸УԹһγ
+    static void Resolve(const Varyings &v, float one_over_z, Varyings *out)
+    {
+        float z = kPerspective ? 1.0f / one_over_z : 1.0f;
+        if (kVaryings & kVaryingColor)
+            out->color = (kPerspective & kVaryingColor) ? v.color * z : v.color;
+        if (kVaryings & kVaryingUv)
+            out->uv = (kPerspective & kVaryingUv) ? v.uv * z : v.uv;
+        if (kVaryings & kVaryingNormal)
+            out->normal = (kPerspective & kVaryingNormal) ? v.normal * z : v.normal;
+        if (kVaryings & kVaryingPos)
+            out->pos = (kPerspective & kVaryingPos) ? v.pos * z : v.pos;
+        if (kVaryings & kVaryingTangent)
+            out->tangent = (kPerspective & kVaryingTangent) ? v.tangent * z : v.tangent;
+    }
+};
+
+template <DepthPass kDepth, class Shader>
+void Renderer::DiffTriangles(const Shader &shader, int first, int last)
+{
+    // Զ͸Уʱеһ
+    if (frame_.diff_perspective)
+    {
+        for (int i = first; i < last; ++i)
+            DiffTriangleRate<Shader, Shader::kVaryings, kDepth>(frame_.triangles[i], shader);
+    }
+    else
+    {
+        for (int i = first; i < last; ++i)
+            DiffTriangleRate<Shader, 0, kDepth>(frame_.triangles[i], shader);
+    }
+}
+
+// ɫʱֿùպϣֻShader::kCoarseShadingɫҪṩLightingCombine
+template <class Shader, bool kCoarse = Shader::kCoarseShading>
+class CoarseShading
+{
+public:
+    static Vector4 Lighting(const Shader &shader, float x, float y, float one_over_z, const Varyings &v)
+    {
+        return shader.Lighting(x, y, one_over_z, v);
+    }
+
+    static uint32 Combine(const Shader &shader, const Vector4 &lighting, const Varyings &v)
+    {
+        return shader.Combine(lighting, v);
+    }
+};
+
+// ɫɫֻʵkRateShiftΪ0ɨߣᱻ
+template <class Shader>
+class CoarseShading<Shader, false>
+{
+public:
+    static Vector4 Lighting(const Shader &shader, float x, float y, float one_over_z, const Varyings &v)
+    {
+        assert(0);
+        return Vector4();
+    }
+
+    static uint32 Combine(const Shader &shader, const Vector4 &lighting, const Varyings &v)
+    {
+        assert(0);
+        return 0;
+    }
+};
+
+// ӦɫƵʣһɫڷתĽǶȲֵȣ
+static const float kAdaptiveNormalStep = 0.03f;
+
+// 㷨߼ļнǳεı߳ΪÿطתĽǶȣٻɿĴС
+static inline int adaptive_rate_shift(const RendVertex &v0, const RendVertex &v1, const RendVertex &v2)
+{
+    Vector3 n0 = v0.normal;
+    Vector3 n1 = v1.normal;
+    Vector3 n2 = v2.normal;
+    n0.SetNormalize();
+    n1.SetNormalize();
+    n2.SetNormalize();
+    float min_dot = min_t(DotProduct(n0, n1), min_t(DotProduct(n1, n2), DotProduct(n2, n0)));
+    // СǶʱacos(d)ԼΪsqrt(2(1 - d))
+    float angle = sqrtf(max_t(2.0f * (1.0f - min_dot), 0.0f));
+    const Vector4 &p0 = v0.position;
+    const Vector4 &p1 = v1.position;
+    const Vector4 &p2 = v2.position;
+    float area2 = absf((p1.x - p0.x) * (p2.y - p0.y) - (p2.x - p0.x) * (p1.y - p0.y));
+    float step = angle / max_t(sqrtf(area2), 1.0f);
+    if (step * 4.0f <= kAdaptiveNormalStep)
+        return kShadingRate4x4;
+    if (step * 2.0f <= kAdaptiveNormalStep)
+        return kShadingRate2x2;
+    return kShadingRate1x1;
+}
+
+template <class Shader, uint32 kPerspective, DepthPass kDepth>
+void Renderer::DiffTriangleRate(const Triangle &tri, const Shader &shader)
+{
+    // ɫְ֧ɫʱʵصͬɴ
+    static const int kShift2x2 = Shader::kCoarseShading ? kShadingRate2x2 : 0;
+    static const int kShift4x4 = Shader::kCoarseShading ? kShadingRate4x4 : 0;
+    if (!Shader::kCoarseShading)
+    {
+        DiffTriangle<Shader, kPerspective, kDepth, 0>(tri, shader);
+        return;
+    }
+
+    int shift = tri.shading_rate;
+    if (shift == kShadingRateAdaptive)
+    {
+        const RendVertex *vtx = &frame_.vertices[0];
+        shift = adaptive_rate_shift(vtx[tri.v[0]], vtx[tri.v[1]], vtx[tri.v[2]]);
+    }
+    ++raster_stats_.rate_triangles[shift];
+    if (shift == kShadingRate4x4)
+        DiffTriangle<Shader, kPerspective, kDepth, kShift4x4>(tri, shader);
+    else if (shift == kShadingRate2x2)
+        DiffTriangle<Shader, kPerspective, kDepth, kShift2x2>(tri, shader);
+    else
+        DiffTriangle<Shader, kPerspective, kDepth, 0>(tri, shader);
+}
+
+template <class Shader, uint32 kPerspective, DepthPass kDepth, int kRateShift>
+void Renderer::DiffTriangle(const Triangle &tri, const Shader &shader)
+{
+    const RendVertex *vtx = &frame_.vertices[0];
+    uint32 i0 = tri.v[0];
+    uint32 i1 = tri.v[1];
+    uint32 i2 = tri.v[2];
+
+    if (((int)vtx[i0].position.x == (int)vtx[i1].position.x) && ((int)vtx[i1].position.x == (int)vtx[i2].position.x))
+        return;
+    if (((int)vtx[i0].position.y == (int)vtx[i1].position.y) && ((int)vtx[i1].position.y == (int)vtx[i2].position.y))
+        return;
+
+    // TODO ӦÿùεʽŻd
+    // Ļ꣬yᳯ£ֻ±
+    if (vtx[i0].position.y > vtx[i1].position.y)
+    {
+        swap(i0, i1);
+    }
+    if (vtx[i0].position.y > vtx[i2].position.y)
+    {
+        swap(i0, i2);
+    }
+    if (vtx[i1].position.y > vtx[i2].position.y)
+    {
+        swap(i1, i2);
+    }
+    const RendVertex &v0 = vtx[i0];
+    const Vector4 &p0 = v0.position;
+    const RendVertex &v1 = vtx[i1];
+    const Vector4 &p1 = v1.position;
+    const RendVertex &v2 = vtx[i2];
+    const Vector4 &p2 = v2.position;
+    
+    // ƽ
+    /*       v0             v1
+             _____________
+             \           /
+              \         /
+               \       /
+                \     /
+                 \   /
+                  \ /  
+                  v2
+    */
+    if ((int)p0.y == (int)p1.y)
+    {
+        if (p0.x > p1.x)
+            swap(i0, i1);
+        if (frame_.tri_up_down == 0 || frame_.tri_up_down == 2) DiffTriangleDown<Shader, kPerspective, kDepth, kRateShift>(vtx[i0], vtx[i1], vtx[i2], shader);
+    }
+    // ƽ
+    /*              v0
+                    /\
+                   /  \
+                  /    \
+                 /      \
+                /        \
+            v2 ------------ v1
+    */
+    else if ((int)p1.y == (int)p2.y)
+    {
+        if (p2.x > p1.x)
+            swap(i1, i2);
+        if (frame_.tri_up_down == 0 || frame_.tri_up_down == 1) DiffTriangleUp<Shader, kPerspective, kDepth, kRateShift>(vtx[i0], vtx[i1], vtx[i2], shader);
+    }
+    else
+    {
+        // ֵе㣬ֻõ
+        RendVertex m;
+        float k =  (p1.y - p0.y) / (p2.y - p0.y);
+        m.position = lerp(p0, p2, k);
+        if (frame_.diff_perspective)
+        {
+            float div = lerp((1 / v0.position.w), (1 / v2.position.w), k);
+            m.position.w = 1.0f / div;
+            if (Shader::kVaryings & kVaryingColor)
+                m.color = lerp((v0.color / v0.position.w), (v2.color / v2.position.w), k) / div;
+            if (Shader::kVaryings & kVaryingUv)
+                m.uv = lerp((v0.uv / v0.position.w), (v2.uv / v2.position.w), k) / div;
+            if (Shader::kVaryings & kVaryingNormal)
+                m.normal = lerp((v0.normal / v0.position.w), (v2.normal / v2.position.w), k) / div;
+            if (Shader::kVaryings & kVaryingPos)
+                m.global_pos = lerp((v0.global_pos / v0.position.w), (v2.global_pos / v2.position.w), k) / div;
+            if (Shader::kVaryings & kVaryingTangent)
+                m.tangent = lerp((v0.tangent / v0.position.w), (v2.tangent / v2.position.w), k) / div;
+        }
+        else
+        {
+            if (Shader::kVaryings & kVaryingColor)
+                m.color = lerp(v0.color, v2.color, k);
+            if (Shader::kVaryings & kVaryingUv)
+                m.uv = lerp(v0.uv, v2.uv, k);
+            if (Shader::kVaryings & kVaryingNormal)
+                m.normal = lerp(v0.normal, v2.normal, k);
+            if (Shader::kVaryings & kVaryingPos)
+                m.global_pos = lerp(v0.global_pos, v2.global_pos, k);
+            if (Shader::kVaryings & kVaryingTangent)
+                m.tangent = lerp(v0.tangent, v2.tangent, k);
+        }
+
+        // 
+        if (p1.x < m.position.x)
+        {
+            if (frame_.tri_up_down == 0 || frame_.tri_up_down == 1) DiffTriangleUp<Shader, kPerspective, kDepth, kRateShift>(v0, m, v1, shader);
+            if (frame_.tri_up_down == 0 || frame_.tri_up_down == 2) DiffTriangleDown<Shader, kPerspective, kDepth, kRateShift>(v1, m, v2, shader);
+        }
+        // ҵ
+        else
+        {
+            if (frame_.tri_up_down == 0 || frame_.tri_up_down == 1) DiffTriangleUp<Shader, kPerspective, kDepth, kRateShift>(v0, v1, m, shader);
+            if (frame_.tri_up_down == 0 || frame_.tri_up_down == 2) DiffTriangleDown<Shader, kPerspective, kDepth, kRateShift>(m, v1, v2, shader);
+        }
+    }
+}
+
+    /*              v0
+                    /\
+                   /  \
+                  /    \
+                 /      \
+                /        \
+            v2 ------------ v1
+    */
+template <class Shader, uint32 kPerspective, DepthPass kDepth, int kRateShift>
+void Renderer::DiffTriangleUp(const RendVertex &v0, const RendVertex &v1, const RendVertex &v2, const Shader &shader)
+{
+    // v0->v2ұv0->v1
+    DiffTrapezoid<Shader, kPerspective, kDepth, kRateShift>(v0, v2, v0, v1, v1.position.y - v0.position.y, (int)v1.position.y, shader);
+}
+
+    /*       v0             v1
+             _____________
+             \           /
+              \         /
+               \       /
+                \     /
+                 \   /
+                  \ /  
+                  v2
+    */
+template <class Shader, uint32 kPerspective, DepthPass kDepth, int kRateShift>
+void Renderer::DiffTriangleDown(const RendVertex &v0, const RendVertex &v1, const RendVertex &v2, const Shader &shader)
+{
+    // v0->v2ұv1->v2
+    DiffTrapezoid<Shader, kPerspective, kDepth, kRateShift>(v0, v2, v1, v2, v2.position.y - v0.position.y, (int)v2.position.y, shader);
+}
+
+template <class Shader, uint32 kPerspective, DepthPass kDepth, int kRateShift>
+void Renderer::DiffTrapezoid(const RendVertex &left_top, const RendVertex &left_bottom,
+                             const RendVertex &right_top, const RendVertex &right_bottom,
+                             float dy, int y_end, const Shader &shader)
+{
+    typedef VaryingOps<Shader::kVaryings, kPerspective> Ops;
+    typedef CoarseShading<Shader> Coarse;
+
+    float dx_left = (left_bottom.position.x - left_top.position.x) / dy;
+    float dx_right = (right_bottom.position.x - right_top.position.x) / dy;
+
+    float done_over_z_left = (1.0f / left_bottom.position.w - 1.0f / left_top.position.w) / dy;
+    float done_over_z_right = (1.0f / right_bottom.position.w - 1.0f / right_top.position.w) / dy;
+
+    Varyings begin, end, left, right;
+    Ops::Load(left_top, &begin);
+    Ops::Load(right_top, &end);
+    Ops::Load(left_bottom, &left);
+    Ops::Load(right_bottom, &right);
+    Varyings d_left, d_right;
+    Ops::Delta(left, begin, dy, &d_left);
+    Ops::Delta(right, end, dy, &d_right);
+
+    float x_begin = left_top.position.x;
+    float x_end = right_top.position.x;
+    float one_over_z_begin = 1.0f / left_top.position.w;
+    float one_over_z_end = 1.0f / right_top.position.w;
+
+    int y = (int)left_top.position.y;
+    if (y < 0)
+    {
+        float d = -left_top.position.y;
+        x_begin += dx_left * d;
+        x_end += dx_right * d;
+        one_over_z_begin += done_over_z_left * d;
+        one_over_z_end += done_over_z_right * d;
+        Ops::Step(d_left, d, &begin);
+        Ops::Step(d_right, d, &end);
+        y = 0;
+    }
+
+    // ɫʱÿµһпͻһstampĹֻڱΡпڹ
+    if (kRateShift > 0)
+    {
+        int blocks = (render_width_ >> kRateShift) + 1;
+        if (static_cast<int>(coarse_stamps_.size()) < blocks)
+        {
+            coarse_stamps_.resize(blocks, 0);
+            coarse_lighting_.resize(blocks);
+        }
+    }
+    int block_row = -1;
+    int lighting_samples = 0;
+    // ԿϽصƫ
+    const float block_center = ((1 << kRateShift) - 1) * 0.5f;
+
+    Varyings v, dv, fragment;
+    Varyings dv_dy, sample;
+    float done_over_z_dy = 0.0f;
+    int passed = 0;
+    for (; y < min_t(y_end, render_height_); ++y)
+    {
+        if (kRateShift > 0 && (y >> kRateShift) != block_row)
+        {
+            block_row = y >> kRateShift;
+            ++coarse_stamp_;
+        }
+        int x = (int)x_begin;
+        float done_over_z = (one_over_z_begin - one_over_z_end) / (x_begin - x_end);
+        float one_over_z = one_over_z_begin;
+        Ops::Delta(begin, end, x_begin - x_end, &dv);
+        v = begin;
+        if (kRateShift > 0)
+        {
+            // yݶȣһеȥxƶǲ
+            dv_dy = d_left;
+            Ops::Step(dv, -dx_left, &dv_dy);
+            done_over_z_dy = done_over_z_left - done_over_z * dx_left;
+        }
+        if (x_begin < 0)
+        {
+            one_over_z += done_over_z * (-x_begin);
+            Ops::Step(dv, -x_begin, &v);
+            x = 0;
+        }
+
+        // floor x_end
+        for (; x < min_t((int)(x_end), render_width_); ++x, one_over_z += done_over_z, Ops::Step(dv, &v))
+        {
+            // 1/z buffer 
+            int p = tile_index(x, y);
+            if (kDepth == kDepthPassEqual)
+            {
+                if (one_over_z != one_over_z_buffer_[p])
+                    continue;
+            }
+            else
+            {
+                if (one_over_z < one_over_z_buffer_[p])
+                    continue;
+                one_over_z_buffer_[p] = one_over_z;
+            }
+            ++passed;
+            if (kDepth == kDepthPassPrepass)
+                continue;
+
+            Ops::Resolve(v, one_over_z, &fragment);
+            if (kRateShift == 0)
+            {
+                tile_color_[p] = shader(static_cast<float>(x), static_cast<float>(y), one_over_z, fragment);
+                continue;
+            }
+            // ڿļһΣԺ1/zƽӵǰƵģĸȱ޹
+            // ֻ
+            int block = x >> kRateShift;
+            if (coarse_stamps_[block] != coarse_stamp_)
+            {
+                coarse_stamps_[block] = coarse_stamp_;
+                float ox = (block << kRateShift) + block_center - x;
+                float oy = (block_row << kRateShift) + block_center - y;
+                float center_one_over_z = one_over_z + done_over_z * ox + done_over_z_dy * oy;
+                // СεĿ̫Զʱ1/zƵ0£˻صǰ
+                if (center_one_over_z <= 0.0f)
+                {
+                    ox = 0.0f;
+                    oy = 0.0f;
+                    center_one_over_z = one_over_z;
+                }
+                sample = v;
+                Ops::Step(dv, ox, &sample);
+                Ops::Step(dv_dy, oy, &sample);
+                Ops::Resolve(sample, center_one_over_z, &sample);
+                coarse_lighting_[block] = Coarse::Lighting(shader, x + ox, y + oy, center_one_over_z, sample);
+                ++lighting_samples;
+            }
+            tile_color_[p] = Coarse::Combine(shader, coarse_lighting_[block], fragment);
+        }
+        x_begin += dx_left;
+        x_end += dx_right;
+        one_over_z_begin += done_over_z_left;
+        one_over_z_end += done_over_z_right;
+        Ops::Step(d_left, &begin);
+        Ops::Step(d_right, &end);
+    }
+
+    if (kDepth == kDepthPassPrepass)
+    {
+        raster_stats_.prepass_pixels += passed;
+    }
+    else
+    {
+        raster_stats_.shaded_pixels += passed;
+        raster_stats_.lighting_samples += kRateShift > 0 ? lighting_samples : passed;
+    }
+}
+
+// ԣ͸Уʱ밴1/zȨ
+template <uint32 kVaryings>
+static inline void barycentric_varyings(const RendVertex &v0, const RendVertex &v1, const RendVertex &v2,
+                                        float l0, float l1, float l2, Varyings *out)
+{
+    if (kVaryings & kVaryingColor)
+        out->color = v0.color * l0 + v1.color * l1 + v2.color * l2;
+    if (kVaryings & kVaryingUv)
+        out->uv = v0.uv * l0 + v1.uv * l1 + v2.uv * l2;
+    if (kVaryings & kVaryingNormal)
+        out->normal = v0.normal * l0 + v1.normal * l1 + v2.normal * l2;
+    if (kVaryings & kVaryingPos)
+        out->pos = v0.global_pos * l0 + v1.global_pos * l1 + v2.global_pos * l2;
+    if (kVaryings & kVaryingTangent)
+        out->tangent = v0.tangent * l0 + v1.tangent * l1 + v2.tangent * l2;
+}
+
+// Ͻǵλ
+// 4xΪת8xD3D׼ʽͬ
+static const float kMsaa4X[kMsaa4] = {0.375f, 0.875f, 0.125f, 0.625f};
+static const float kMsaa4Y[kMsaa4] = {0.125f, 0.375f, 0.625f, 0.875f};
+static const float kMsaa8X[kMsaa8] = {9 / 16.0f, 7 / 16.0f, 13 / 16.0f, 5 / 16.0f, 3 / 16.0f, 1 / 16.0f, 11 / 16.0f, 15 / 16.0f};
+static const float kMsaa8Y[kMsaa8] = {5 / 16.0f, 11 / 16.0f, 9 / 16.0f, 3 / 16.0f, 13 / 16.0f, 7 / 16.0f, 15 / 16.0f, 1 / 16.0f};
+
+// msaa_state_ȡֵ
+enum MsaaPixelState
+{
+    // ֡ûд룬Ч൱ɫ1/zΪ0
+    kMsaaCleared = 0,
+    // вɫֻͬеһɫЧ1/z
+    kMsaaCompressed = 1,
+    // ɫ
+    kMsaaExpanded = 2
+};
+
+// Σÿ㵥Ǻ1/zԣ
+// вͨʱģĲȡһǵĲ㣩ɫһ
+template <class Shader>
+void Renderer::DiffTriangleMsaa(const Triangle &tri, const Shader &shader)
+{
+    const RendVertex &v0 = frame_.vertices[tri.v[0]];
+    const RendVertex &v1 = frame_.vertices[tri.v[1]];
+    const RendVertex &v2 = frame_.vertices[tri.v[2]];
+    float x0 = v0.position.x, y0 = v0.position.y;
+    float x1 = v1.position.x, y1 = v1.position.y;
+    float x2 = v2.position.x, y2 = v2.position.y;
+
+    float area = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+    if (fabsf(area) < 1e-6f)
+        return;
+    float inv_area = 1.0f / area;
+
+    int min_x = max_t((int)floorf(min_t(x0, min_t(x1, x2))), 0);
+    int max_x = min_t((int)ceilf(max_t(x0, max_t(x1, x2))), render_width_ - 1);
+    int min_y = max_t((int)floorf(min_t(y0, min_t(y1, y2))), 0);
+    int max_y = min_t((int)ceilf(max_t(y0, max_t(y1, y2))), render_height_ - 1);
+    if (min_x > max_x || min_y > max_y)
+        return;
+
+    // l_i = E_i / areaE_iΪv_iԱߵıߺxyԱ仯
+    float dl_dx[3];
+    float dl_dy[3];
+    dl_dx[0] = (y1 - y2) * inv_area;
+    dl_dy[0] = (x2 - x1) * inv_area;
+    dl_dx[1] = (y2 - y0) * inv_area;
+    dl_dy[1] = (x0 - x2) * inv_area;
+    dl_dx[2] = -dl_dx[0] - dl_dx[1];
+    dl_dy[2] = -dl_dy[0] - dl_dy[1];
+    float l0_origin = ((x2 - x1) * (min_y - y1) - (y2 - y1) * (min_x - x1)) * inv_area;
+    float l1_origin = ((x0 - x2) * (min_y - y2) - (y0 - y2) * (min_x - x2)) * inv_area;
+
+    float w0 = 1.0f / v0.position.w;
+    float w1 = 1.0f / v1.position.w;
+    float w2 = 1.0f / v2.position.w;
+    // 1/z = l0 * (w0 - w2) + l1 * (w1 - w2) + w2
+    float dz_dx = dl_dx[0] * (w0 - w2) + dl_dx[1] * (w1 - w2);
+    float dz_dy = dl_dy[0] * (w0 - w2) + dl_dy[1] * (w1 - w2);
+
+    // ϽǵƫƣԼÿһڵСƫ
+    int samples = frame_.msaa_samples;
+    const float *sample_x = samples == kMsaa8 ? kMsaa8X : kMsaa4X;
+    const float *sample_y = samples == kMsaa8 ? kMsaa8Y : kMsaa4Y;
+    uint32 full_mask = (1u << samples) - 1;
+    float off[3][kMsaa8];
+    float off_z[kMsaa8];
+    float off_min[3];
+    float off_max[3];
+    for (int e = 0; e < 3; ++e)
+    {
+        off_min[e] = FLT_MAX;
+        off_max[e] = -FLT_MAX;
+        for (int s = 0; s < samples; ++s)
+        {
+            off[e][s] = dl_dx[e] * sample_x[s] + dl_dy[e] * sample_y[s];
+            off_min[e] = min_t(off_min[e], off[e][s]);
+            off_max[e] = max_t(off_max[e], off[e][s]);
+        }
+    }
+    for (int s = 0; s < samples; ++s)
+    {
+        off_z[s] = dz_dx * sample_x[s] + dz_dy * sample_y[s];
+    }
+
+    Varyings fragment;
+    for (int y = min_y; y <= max_y; ++y)
+    {
+        float l_row[3];
+        l_row[0] = l0_origin + dl_dy[0] * (y - min_y);
+        l_row[1] = l1_origin + dl_dy[1] * (y - min_y);
+        l_row[2] = 1.0f - l_row[0] - l_row[1];
+
+        // пвǵ䣬һص
+        float span_begin = static_cast<float>(min_x);
+        float span_end = static_cast<float>(max_x);
+        for (int e = 0; e < 3; ++e)
+        {
+            float l = l_row[e] + off_max[e];
+            if (dl_dx[e] > 0.0f)
+                span_begin = max_t(span_begin, min_x - l / dl_dx[e] - 1.0f);
+            else if (dl_dx[e] < 0.0f)
+                span_end = min_t(span_end, min_x - l / dl_dx[e] + 1.0f);
+            else if (l < 0.0f)
+                span_end = -1.0f;
+        }
+        if (span_begin > span_end)
+            continue;
+
+        int x_begin = static_cast<int>(span_begin);
+        int x_end = static_cast<int>(span_end);
+        for (int x = x_begin; x <= x_end; ++x)
+        {
+            float l0 = l_row[0] + dl_dx[0] * (x - min_x);
+            float l1 = l_row[1] + dl_dx[1] * (x - min_x);
+            float l2 = 1.0f - l0 - l1;
+            float z = l0 * (w0 - w2) + l1 * (w1 - w2) + w2;
+            int p = y * render_width_ + x;
+            float *depth = &msaa_depth_[p * samples];
+            uint32 *colors = &msaa_color_[p * samples];
+
+            // вʱǲ
+            uint32 cover = 0;
+            if (l0 + off_min[0] >= 0.0f && l1 + off_min[1] >= 0.0f && l2 + off_min[2] >= 0.0f)
+            {
+                cover = full_mask;
+            }
+            else
+            {
+                for (int s = 0; s < samples; ++s)
+                {
+                    if (l0 + off[0][s] >= 0.0f && l1 + off[1][s] >= 0.0f && l2 + off[2][s] >= 0.0f)
+                        cover |= 1u << s;
+                }
+                if (!cover)
+                    continue;
+            }
+
+            if (msaa_state_[p] == kMsaaCleared)
+            {
+                memset(depth, 0, samples * sizeof(float));
+                colors[0] = 0;
+                msaa_state_[p] = kMsaaCompressed;
+            }
+
+            uint32 pass = 0;
+            for (int s = 0; s < samples; ++s)
+            {
+                float one_over_z = z + off_z[s];
+                if (!(cover & (1u << s)) || one_over_z < depth[s])
+                    continue;
+                depth[s] = one_over_z;
+                pass |= 1u << s;
+            }
+            if (!pass)
+                continue;
+
+            // ɫ
+            float shade_x = 0.5f;
+            float shade_y = 0.5f;
+            float a = l0 + (dl_dx[0] + dl_dy[0]) * 0.5f;
+            float b = l1 + (dl_dx[1] + dl_dy[1]) * 0.5f;
+            if (cover != full_mask && (a < 0.0f || b < 0.0f || a + b > 1.0f))
+            {
+                int s = 0;
+                while (!(cover & (1u << s)))
+                    ++s;
+                a = l0 + off[0][s];
+                b = l1 + off[1][s];
+                shade_x = sample_x[s];
+                shade_y = sample_y[s];
+            }
+            float c = 1.0f - a - b;
+            float one_over_z = a * w0 + b * w1 + c * w2;
+            if (frame_.diff_perspective)
+            {
+                float z = 1.0f / one_over_z;
+                barycentric_varyings<Shader::kVaryings>(v0, v1, v2, a * w0 * z, b * w1 * z, c * w2 * z, &fragment);
+            }
+            else
+            {
+                barycentric_varyings<Shader::kVaryings>(v0, v1, v2, a, b, c, &fragment);
+            }
+            uint32 cl = shader(x + shade_x, y + shade_y, one_over_z, fragment);
+
+            if (pass == full_mask)
+            {
+                colors[0] = cl;
+                msaa_state_[p] = kMsaaCompressed;
+                continue;
+            }
+            // ָǣչ
+            if (msaa_state_[p] == kMsaaCompressed)
+            {
+                for (int s = 1; s < samples; ++s)
+                {
+                    colors[s] = colors[0];
+                }
+                msaa_state_[p] = kMsaaExpanded;
+            }
+            for (int s = 0; s < samples; ++s)
+            {
+                if (pass & (1u << s))
+                    colors[s] = cl;
+            }
+        }
+    }
+}
+
+// ͸ηֿĴС
+// ɫķֿͬһ
+static const int kTranslucentTileSize = Renderer::kTileSize;
+
+// x * f / 255룬xf255
+static inline uint32 mul_div255(uint32 x, uint32 f)
+{
+    uint32 t = x * f + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+static inline __m128i mul_div255_epi16(__m128i x, __m128i f)
+{
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(x, f), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+// أÿͨ16λ
+template<BlendMode kMode>
+static inline __m128i blend_pixels(__m128i src, __m128i dst)
+{
+    __m128i alpha = _mm_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3));
+    alpha = _mm_shufflehi_epi16(alpha, _MM_SHUFFLE(3, 3, 3, 3));
+    __m128i inv_alpha = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+    if (kMode == kBlendAlpha)
+        return _mm_add_epi16(mul_div255_epi16(src, alpha), mul_div255_epi16(dst, inv_alpha));
+    if (kMode == kBlendAdditive)
+        return _mm_add_epi16(mul_div255_epi16(src, alpha), dst);
+    return _mm_add_epi16(src, mul_div255_epi16(dst, inv_alpha));
+}
+
+template<BlendMode kMode>
+static inline uint32 blend_pixel(uint32 src, uint32 dst)
+{
+    uint32 alpha = src >> 24;
+    uint32 ret = 0;
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        uint32 s = (src >> shift) & 0xff;
+        uint32 d = (dst >> shift) & 0xff;
+        uint32 c;
+        if (kMode == kBlendAlpha)
+            c = mul_div255(s, alpha) + mul_div255(d, 255 - alpha);
+        else if (kMode == kBlendAdditive)
+            c = mul_div255(s, alpha) + d;
+        else
+            c = s + mul_div255(d, 255 - alpha);
+        ret |= min_t(c, 255u) << shift;
+    }
+    return ret;
+}
+
+// ԴɫΪ0رֲ䣬ÿδ4أΪ0ʱ
+template<BlendMode kMode>
+static inline void blend_span(const uint32 *src, uint32 *dst, int count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(s, zero)) == 0xffff)
+            continue;
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+        __m128i lo = blend_pixels<kMode>(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero));
+        __m128i hi = blend_pixels<kMode>(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(lo, hi));
+    }
+    for (; i < count; ++i)
+    {
+        if (src[i])
+            dst[i] = blend_pixel<kMode>(src[i], dst[i]);
+    }
+}
+
+// Сλ
+static const int kSubPixelBits = 4;
+static const int kSubPixel = 1 << kSubPixelBits;
+// ķΧβ֤ߺ
+static const float kGuardBand = static_cast<float>(1 << 25);
+
+// ߺö㣬Ϲڱϵأ
+// εĹÿǡñһΣ©Ҳ
+template <class Shader>
+void Renderer::DiffTriangleBlend(const TranslucentTriangle &translucent, int min_x, int min_y, int max_x, int max_y, const Shader &shader)
+{
+    const RendVertex *v0 = &frame_.vertices[translucent.tri.v[0]];
+    const RendVertex *v1 = &frame_.vertices[translucent.tri.v[1]];
+    const RendVertex *v2 = &frame_.vertices[translucent.tri.v[2]];
+    for (int j = 0; j < 3; ++j)
+    {
+        const Vector4 &p = frame_.vertices[translucent.tri.v[j]].position;
+        if (!(fabsf(p.x) < kGuardBand && fabsf(p.y) < kGuardBand))
+            return;
+    }
+    long long x0 = static_cast<long long>(floorf(v0->position.x * kSubPixel + 0.5f));
+    long long y0 = static_cast<long long>(floorf(v0->position.y * kSubPixel + 0.5f));
+    long long x1 = static_cast<long long>(floorf(v1->position.x * kSubPixel + 0.5f));
+    long long y1 = static_cast<long long>(floorf(v1->position.y * kSubPixel + 0.5f));
+    long long x2 = static_cast<long long>(floorf(v2->position.x * kSubPixel + 0.5f));
+    long long y2 = static_cast<long long>(floorf(v2->position.y * kSubPixel + 0.5f));
+    long long area = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+    if (area == 0)
+        return;
+    // ͳһ͸ıͬɼ
+    if (area < 0)
+    {
+        swap(v1, v2);
+        swap(x1, x2);
+        swap(y1, y2);
+        area = -area;
+    }
+    float inv_area = 1.0f / static_cast<float>(area);
+
+    min_x = max_t(min_x, static_cast<int>(min_t(x0, min_t(x1, x2)) >> kSubPixelBits));
+    max_x = min_t(max_x, static_cast<int>(max_t(x0, max_t(x1, x2)) >> kSubPixelBits));
+    min_y = max_t(min_y, static_cast<int>(min_t(y0, min_t(y1, y2)) >> kSubPixelBits));
+    max_y = min_t(max_y, static_cast<int>(max_t(y0, max_t(y1, y2)) >> kSubPixelBits));
+    if (min_x > max_x || min_y > max_y)
+        return;
+
+    // e_iΪv_iԱߵıߺڲΪl_i = e_i / area
+    long long a[3] = {y1 - y2, y2 - y0, y0 - y1};
+    long long b[3] = {x2 - x1, x0 - x2, x1 - x0};
+    long long px = min_x * kSubPixel + kSubPixel / 2;
+    long long py = min_y * kSubPixel + kSubPixel / 2;
+    long long e_origin[3];
+    e_origin[0] = (px - x1) * a[0] + (py - y1) * b[0];
+    e_origin[1] = (px - x2) * a[1] + (py - y2) * b[1];
+    e_origin[2] = (px - x0) * a[2] + (py - y0) * b[2];
+    // ߺϱ߰ϵأıҪϸڲ
+    for (int k = 0; k < 3; ++k)
+    {
+        bool top_left = a[k] > 0 || (a[k] == 0 && b[k] > 0);
+        if (!top_left)
+            e_origin[k] -= 1;
+    }
+
+    float w0 = 1.0f / v0->position.w;
+    float w1 = 1.0f / v1->position.w;
+    float w2 = 1.0f / v2->position.w;
+
+    uint32 *blend_row = &blend_row_[0];
+    Varyings fragment;
+    for (int y = min_y; y <= max_y; ++y)
+    {
+        long long e_row[3];
+        for (int k = 0; k < 3; ++k)
+        {
+            e_row[k] = e_origin[k] + b[k] * kSubPixel * (y - min_y);
+        }
+
+        // e(x) = e_row + a * kSubPixel * (x - min_x) >= 0
+        int x_begin = min_x;
+        int x_end = max_x;
+        for (int k = 0; k < 3; ++k)
+        {
+            long long step = a[k] * kSubPixel;
+            if (step > 0)
+                x_begin = max_t(x_begin, static_cast<int>(min_x - floor_div(e_row[k], step)));
+            else if (step < 0)
+                x_end = min_t(x_end, static_cast<int>(min_x + floor_div(e_row[k], -step)));
+            else if (e_row[k] < 0)
+                x_end = min_x - 1;
+        }
+        if (x_begin > x_end)
+            continue;
+
+        float l1 = (e_row[1] + a[1] * kSubPixel * (x_begin - min_x)) * inv_area;
+        float l2 = (e_row[2] + a[2] * kSubPixel * (x_begin - min_x)) * inv_area;
+        float dl1 = a[1] * kSubPixel * inv_area;
+        float dl2 = a[2] * kSubPixel * inv_area;
+        for (int x = x_begin; x <= x_end; ++x, l1 += dl1, l2 += dl2)
+        {
+            float l0 = 1.0f - l1 - l2;
+            float one_over_z = l0 * w0 + l1 * w1 + l2 * w2;
+            // ȲԵд
+            if (one_over_z < get_one_over_z_buffer(x, y))
+            {
+                blend_row[x - x_begin] = 0;
+                continue;
+            }
+            if (frame_.diff_perspective)
+            {
+                float z = 1.0f / one_over_z;
+                barycentric_varyings<Shader::kVaryings>(*v0, *v1, *v2, l0 * w0 * z, l1 * w1 * z, l2 * w2 * z, &fragment);
+            }
+            else
+            {
+                barycentric_varyings<Shader::kVaryings>(*v0, *v1, *v2, l0, l1, l2, &fragment);
+            }
+            blend_row[x - x_begin] = shader(x + 0.5f, y + 0.5f, one_over_z, fragment);
+        }
+
+        uint32 *dst = tile_color_ + tile_index(x_begin, y);
+        int count = x_end - x_begin + 1;
+        switch (translucent.blend)
+        {
+        case kBlendAlpha:
+            blend_span<kBlendAlpha>(blend_row, dst, count);
+            break;
+        case kBlendAdditive:
+            blend_span<kBlendAdditive>(blend_row, dst, count);
+            break;
+        case kBlendPremultiplied:
+            blend_span<kBlendPremultiplied>(blend_row, dst, count);
+            break;
+        default:
+            assert(0);
+            break;
+        }
+    }
+}
\ No newline at end of file
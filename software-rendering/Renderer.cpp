@@ -1,9 +1,11 @@
 #include "Renderer.h"
 #include <assert.h>
+#include <algorithm>
 #include "util.h"
 #include "Camera.h"
 #include "Light.h"
 #include "Texture2D.h"
+#include "Logger.h"
 
 using std::vector;
 using std::string;
@@ -15,9 +17,21 @@ Renderer::Renderer(void)
     ,width_(0)
     ,height_(0)
     ,pitch_(0)
+    ,render_width_(0)
+    ,render_height_(0)
     ,buffer_(nullptr)
+    ,color_buffer_(nullptr)
     ,backface_culling_(false)
     ,one_over_z_buffer_(nullptr)
+    ,tiles_x_(0)
+    ,tiled_size_(0)
+    ,tiled_capacity_(0)
+    ,tile_color_(nullptr)
+    ,dynamic_resolution_(false)
+    ,resolution_budget_ms_(8.0f)
+    ,resolution_min_scale_(0.5f)
+    ,resolution_scale_(1.0f)
+    ,resolution_reset_(false)
     ,light_(nullptr)
     ,flat_(false)
     ,shading_mode_(kFrame)
@@ -26,12 +40,33 @@ Renderer::Renderer(void)
     ,texture_(nullptr)
     ,diff_perspective(false)
     ,tri_up_down_(0)
-    ,bumpmap_(nullptr)
+    ,normal_map_(nullptr)
+    ,occlusion_culling_(false)
+    ,wireframe_edges_(0)
+    ,wireframe_triangle_edges_(0)
+    ,msaa_samples_(1)
+    ,msaa_allocated_(0)
+    ,depth_prepass_(false)
+    ,shading_rate_(kShadingRate1x1)
+    ,coarse_stamp_(0)
+    ,draw_sorting_(false)
+    ,blend_mode_(kBlendOpaque)
+    ,shadow_index_(0)
+    ,shadow_size_(0)
+    ,shadow_fov_(90.0f)
+    ,shadow_near_(0.1f)
+    ,shadow_far_(100.0f)
+    ,raster_thread_(NULL)
+    ,raster_start_(NULL)
+    ,raster_done_(NULL)
+    ,raster_exit_(false)
 {
 }
 
 Renderer::~Renderer(void)
 {
+    ReleaseBindings(&bindings_);
+    ReleaseBindings(&frame_.bindings);
 }
 
 void Renderer::Initialize(HWND hwnd, int width, int height)
@@ -65,12 +100,12 @@ void Renderer::Initialize(HWND hwnd, int width, int height)
     HRESULT hr = d3d9_->CreateDevice(D3DADAPTER_DEFAULT,
                                      D3DDEVTYPE_HAL,
                                      hwnd,
-                                     D3DCREATE_SOFTWARE_VERTEXPROCESSING,
+                                     D3DCREATE_SOFTWARE_VERTEXPROCESSING | D3DCREATE_MULTITHREADED,
                                      &params,
                                      &d3d_device_);
     if (FAILED(hr))
     {
-        Logger::GtLogError("d3d9 CreateDevice failed: %d\n", GetLastError());
+        GT_LOG_ERROR("d3d9 CreateDevice failed: %d\n", GetLastError());
         SafeRelease(&d3d_device_);
         SafeRelease(&d3d9_);
         return;
@@ -79,34 +114,168 @@ void Renderer::Initialize(HWND hwnd, int width, int height)
     hr = d3d_device_->GetBackBuffer(0, 0, D3DBACKBUFFER_TYPE_MONO, &d3d_backbuffer_);
     if (FAILED(hr))
     {
-        Logger::GtLogError("d3d GetBackBuffer failed: %d\n", GetLastError());
+        GT_LOG_ERROR("d3d GetBackBuffer failed: %d\n", GetLastError());
         SafeRelease(&d3d_device_);
         SafeRelease(&d3d9_);
         return;
     }
 
-    one_over_z_buffer_ = new float[width_ * height_];
+    SetRenderSize(width_, height_);
+}
+
+void Renderer::InitializeOffscreen(int width, int height)
+{
+    assert(width > 0 && height > 0);
+    width_ = width;
+    height_ = height;
+    pitch_ = width_ * sizeof(uint32);
+
+    color_buffer_ = new uint32[width_ * height_];
+    buffer_ = color_buffer_;
+    SetRenderSize(width_, height_);
+}
+
+void Renderer::SetRenderSize(int width, int height)
+{
+    assert(width > 0 && height > 0);
+    render_width_ = width;
+    render_height_ = height;
+    // һıԵҲ䣬ڵ±겻жϱ߽
+    tiles_x_ = (width + kTileSize - 1) >> kTileShift;
+    int tiles_y = (height + kTileSize - 1) >> kTileShift;
+    tiled_size_ = (tiles_x_ * tiles_y) << (2 * kTileShift);
+    if (tiled_size_ > tiled_capacity_)
+    {
+        delete[] tile_color_;
+        delete[] one_over_z_buffer_;
+        tile_color_ = new uint32[tiled_size_];
+        one_over_z_buffer_ = new float[tiled_size_];
+        tiled_capacity_ = tiled_size_;
+    }
+}
+
+void Renderer::ResolveTiles(void)
+{
+    if (render_width_ != width_ || render_height_ != height_)
+    {
+        UpscaleTiles();
+        return;
+    }
+
+    int pitch = pitch_ / 4;
+    for (int y0 = 0; y0 < height_; y0 += kTileSize)
+    {
+        int rows = min_t(kTileSize, height_ - y0);
+        for (int x0 = 0; x0 < width_; x0 += kTileSize)
+        {
+            int columns = min_t(kTileSize, width_ - x0);
+            const uint32 *src = tile_color_ + tile_index(x0, y0);
+            uint32 *dst = buffer_ + y0 * pitch + x0;
+            for (int y = 0; y < rows; ++y, src += kTileSize, dst += pitch)
+            {
+                memcpy(dst, src, columns * sizeof(uint32));
+            }
+        }
+    }
+}
+
+// ARGBɫw / 256ֵalphaͨһ
+static inline uint32 lerp_argb(uint32 a, uint32 b, uint32 w)
+{
+    uint32 rb = ((a & 0x00ff00ff) * (256 - w) + (b & 0x00ff00ff) * w) >> 8;
+    uint32 ag = ((a >> 8) & 0x00ff00ff) * (256 - w) + ((b >> 8) & 0x00ff00ff) * w;
+    return (rb & 0x00ff00ff) | (ag & 0xff00ff00);
+}
+
+void Renderer::UpscaleTiles(void)
+{
+    // 󻺳ӳȾֱʣÿеԴغȨ
+    // ƫƿԲСӣеĲÿֻһ
+    float scale_x = static_cast<float>(render_width_) / width_;
+    float scale_y = static_cast<float>(render_height_) / height_;
+    upscale_offsets_.resize(width_ * 2);
+    upscale_weights_.resize(width_);
+    for (int x = 0; x < width_; ++x)
+    {
+        float fx = clamp((x + 0.5f) * scale_x - 0.5f, 0.0f, render_width_ - 1.0f);
+        int x0 = static_cast<int>(fx);
+        int x1 = min_t(x0 + 1, render_width_ - 1);
+        upscale_offsets_[x * 2] = tile_index(x0, 0);
+        upscale_offsets_[x * 2 + 1] = tile_index(x1, 0);
+        upscale_weights_[x] = static_cast<uint32>((fx - x0) * 256.0f);
+    }
+
+    int pitch = pitch_ / 4;
+    const int *offsets = &upscale_offsets_[0];
+    const uint32 *weights = &upscale_weights_[0];
+    for (int y = 0; y < height_; ++y)
+    {
+        float fy = clamp((y + 0.5f) * scale_y - 0.5f, 0.0f, render_height_ - 1.0f);
+        int y0 = static_cast<int>(fy);
+        int y1 = min_t(y0 + 1, render_height_ - 1);
+        uint32 wy = static_cast<uint32>((fy - y0) * 256.0f);
+        const uint32 *top = tile_color_ + tile_index(0, y0);
+        const uint32 *bottom = tile_color_ + tile_index(0, y1);
+        uint32 *dst = buffer_ + y * pitch;
+        for (int x = 0; x < width_; ++x)
+        {
+            int o0 = offsets[x * 2];
+            int o1 = offsets[x * 2 + 1];
+            uint32 c0 = lerp_argb(top[o0], top[o1], weights[x]);
+            uint32 c1 = lerp_argb(bottom[o0], bottom[o1], weights[x]);
+            dst[x] = lerp_argb(c0, c1, wy);
+        }
+    }
+}
 
-    LOGFONT lfont;
-    memset(&lfont, 0, sizeof(lfont));
-    lfont.lfHeight = 14;
-    lfont.lfWeight = 0;
-    lfont.lfClipPrecision = CLIP_LH_ANGLES;
-    lfont.lfQuality = NONANTIALIASED_QUALITY;
-    strcpy_s(lfont.lfFaceName, "verdana");
-    font_ = CreateFontIndirect(&lfont);
-    assert(font_ != NULL);
+void Renderer::set_dynamic_resolution(bool flag, float budget_ms, float min_scale)
+{
+    assert(budget_ms > 0.0f);
+    assert(min_scale > 0.0f && min_scale <= 1.0f);
+    dynamic_resolution_ = flag;
+    resolution_budget_ms_ = budget_ms;
+    resolution_min_scale_ = clamp(min_scale, 0.1f, 1.0f);
+    resolution_reset_ = true;
+}
+
+void Renderer::UpdateResolutionScale(double raster_ms)
+{
+    if (!dynamic_resolution_ || raster_ms <= 0.0)
+        return;
+
+    // դʱȣ߰ʱ֮ȵƽ
+    float target = resolution_scale_ * sqrtf(static_cast<float>(resolution_budget_ms_ / raster_ms));
+    target = clamp(target, resolution_min_scale_, 1.0f);
+    // 𲻵5%ʱÿֻ֡һ룬ֱ
+    if (absf(target - resolution_scale_) < resolution_scale_ * 0.05f)
+        return;
+    resolution_scale_ += (target - resolution_scale_) * 0.5f;
 }
 
 void Renderer::Uninitialize(void)
 {
+    set_pipelined(false);
+    post_process_.Uninitialize();
+
     if (one_over_z_buffer_)
     {
         delete[] one_over_z_buffer_;
         one_over_z_buffer_ = nullptr;
     }
+    if (tile_color_)
+    {
+        delete[] tile_color_;
+        tile_color_ = nullptr;
+    }
+    tiled_capacity_ = 0;
+    if (color_buffer_)
+    {
+        delete[] color_buffer_;
+        color_buffer_ = nullptr;
+        buffer_ = nullptr;
+    }
 
-    DeleteObject(font_);
+    text_renderer_.Uninitialize();
     SafeRelease(&d3d_backbuffer_);
     SafeRelease(&d3d_device_);
     SafeRelease(&d3d9_);
@@ -123,14 +292,16 @@ Texture2D Renderer::CreateTexture2D(void)
     return tex;
 }
 
-// falseʱ߶ȫڲü֮
-static bool clip_line_2d(int min_x, int max_x, int min_y, int max_y, RendVertex &v0, RendVertex &v1)
+// ߶εı˵øüΧڣ֮ļ㶼
+static const float kLineGuardBand = static_cast<float>(1 << 20);
+
+// ֻ߶ڲüڵĲΧ[u_begin, u_end]falseʱ߶ȫڲü֮
+static bool clip_line_2d(float min_x, float max_x, float min_y, float max_y,
+                         float x0, float y0, float x1, float y1, float *u_begin, float *u_end)
 {
     static const int BUF_SIZE = 4;
-    float x0 = v0.position.x;
-    float y0 = v0.position.y;
-    float x_dt = v1.position.x - x0;
-    float y_dt = v1.position.y - y0;
+    float x_dt = x1 - x0;
+    float y_dt = y1 - y0;
     
     float p[BUF_SIZE] = {0.0};
     float q[BUF_SIZE] = {0.0};
@@ -177,1001 +348,1206 @@ static bool clip_line_2d(int min_x, int max_x, int min_y, int max_y, RendVertex
         }
     }
 
-    if (u1 > u2)
+    *u_begin = u1;
+    *u_end = u2;
+    return u1 <= u2;
+}
+
+void Renderer::DrawLine(const RendVertex &v0, const RendVertex &v1)
+{
+    // ֻȡĻλá1/zɫ1/zĻռԵ
+    float x0 = v0.position.x;
+    float y0 = v0.position.y;
+    float x1 = v1.position.x;
+    float y1 = v1.position.y;
+    float z0 = 1.0f / v0.position.w;
+    float z1 = 1.0f / v1.position.w;
+    Vector4 c0 = v0.color;
+    Vector4 c1 = v1.color;
+
+    float u_begin = 0.0f;
+    float u_end = 1.0f;
+    if (!clip_line_2d(-kLineGuardBand, render_width_ + kLineGuardBand, -kLineGuardBand, render_height_ + kLineGuardBand,
+                      x0, y0, x1, y1, &u_begin, &u_end))
+        return;
+    if (u_begin > 0.0f || u_end < 1.0f)
+    {
+        float dx = x1 - x0;
+        float dy = y1 - y0;
+        float dz = z1 - z0;
+        Vector4 dc = c1 - c0;
+        x1 = x0 + dx * u_end;
+        y1 = y0 + dy * u_end;
+        z1 = z0 + dz * u_end;
+        c1 = c0 + dc * u_end;
+        x0 += dx * u_begin;
+        y0 += dy * u_begin;
+        z0 += dz * u_begin;
+        c0 += dc * u_begin;
+    }
+
+    // ΪλĶ˵㣬˶
+    int ix0 = static_cast<int>(floorf(x0));
+    int iy0 = static_cast<int>(floorf(y0));
+    int ix1 = static_cast<int>(floorf(x1));
+    int iy1 = static_cast<int>(floorf(y1));
+
+    // ͳһxߣ߽xy
+    int major_size = render_width_;
+    int minor_size = render_height_;
+    bool steep = abs(iy1 - iy0) > abs(ix1 - ix0);
+    if (steep)
+    {
+        swap(ix0, iy0);
+        swap(ix1, iy1);
+        swap(major_size, minor_size);
+    }
+    if (ix0 > ix1)
     {
-        return false;
-    } 
+        swap(ix0, ix1);
+        swap(iy0, iy1);
+        swap(z0, z1);
+        swap(c0, c1);
+    }
+    int dx = ix1 - ix0;
+    int dy = iy1 - iy0;
+    int sign = 1;
+    if (dy < 0)
+    {
+        dy = -dy;
+        sign = -1;
+    }
+
+    // tصĴƫΪm(t) = floor((2 * dy * t + dx) / (2 * dx))t[0, dx]
+    // ĻڵtķΧü벻üʱȫͬ
+    long long t_begin = max_t(0, -ix0);
+    long long t_end = min_t(dx, major_size - 1 - ix0);
+    // ᷽Ҫm(t)[lo, hi]
+    long long lo = sign > 0 ? -iy0 : iy0 - (minor_size - 1);
+    long long hi = sign > 0 ? minor_size - 1 - iy0 : iy0;
+    if (dy == 0)
+    {
+        if (lo > 0 || hi < 0)
+            return;
+    }
     else
     {
-        RendVertex s = v0;
-        RendVertex e = v1;
+        long long two_dx = 2LL * dx;
+        long long two_dy = 2LL * dy;
+        // m(t) >= lo  2 * dy * t >= 2 * dx * lo - dx
+        t_begin = max_t(t_begin, -floor_div(dx - two_dx * lo, two_dy));
+        // m(t) <= hi  2 * dy * t <= 2 * dx * (hi + 1) - dx - 1
+        t_end = min_t(t_end, floor_div(two_dx * (hi + 1) - dx - 1, two_dy));
+    }
+    if (t_begin > t_end)
+        return;
 
-        if (!equalf(u1, 0))
+    // num = 2 * dy * t + dx = m * 2dx + rem
+    long long two_dx = 2LL * max_t(dx, 1);
+    long long num = 2LL * dy * t_begin + dx;
+    int m = static_cast<int>(num / two_dx);
+    int rem = static_cast<int>(num % two_dx);
+    int two_dy = 2 * dy;
+
+    // Ĳֵ
+    float inv_dx = dx > 0 ? 1.0f / dx : 0.0f;
+    float dz = (z1 - z0) * inv_dx;
+    float z = z0 + dz * static_cast<float>(t_begin);
+    // ɫ16λСĶ
+    Vector4 dc = (c1 - c0) * (inv_dx * 255.0f * 65536.0f);
+    Vector4 c = c0 * (255.0f * 65536.0f) + dc * static_cast<float>(t_begin);
+    int a = static_cast<int>(c.a) + 0x8000, da = static_cast<int>(dc.a);
+    int r = static_cast<int>(c.r) + 0x8000, dr = static_cast<int>(dc.r);
+    int g = static_cast<int>(c.g) + 0x8000, dg = static_cast<int>(dc.g);
+    int b = static_cast<int>(c.b) + 0x8000, db = static_cast<int>(dc.b);
+
+    int major = ix0 + static_cast<int>(t_begin);
+    int minor = iy0 + sign * m;
+    int x = steep ? minor : major;
+    int y = steep ? major : minor;
+    // ʹÿһxyı仯ֿţÿ±
+    int major_dx = steep ? 0 : 1;
+    int major_dy = steep ? 1 : 0;
+    int minor_dx = steep ? sign : 0;
+    int minor_dy = steep ? 0 : sign;
+    for (int t = static_cast<int>(t_begin); t <= t_end; ++t)
+    {
+        int p = tile_index(x, y);
+        if (z >= one_over_z_buffer_[p])
         {
-            v0.position = s.position + u1 * (e.position - s.position);
-            v0.color = e.color + u1 * (e.color - s.color);
+            one_over_z_buffer_[p] = z;
+            tile_color_[p] = (clamp(a >> 16, 0, 255) << 24)
+                 | (clamp(r >> 16, 0, 255) << 16)
+                 | (clamp(g >> 16, 0, 255) << 8)
+                 | clamp(b >> 16, 0, 255);
         }
-        if (!equalf(u2, 1))
+        z += dz;
+        a += da;
+        r += dr;
+        g += dg;
+        b += db;
+        x += major_dx;
+        y += major_dy;
+        rem += two_dy;
+        if (rem >= two_dx)
         {
-            v1.position = s.position + u2 * (e.position - s.position);
-            v1.color = e.color + u2 * (e.color - s.color);
+            rem -= static_cast<int>(two_dx);
+            x += minor_dx;
+            y += minor_dy;
         }
-        return true;
     }
 }
 
-void Renderer::DrawLine(RendVertex v0, RendVertex v1)
+void Renderer::BeginFrame(void)
 {
-    bool flag = clip_line_2d(0, width_, 0, height_, v0, v1);
-    if (!flag)
-        return;
-
-    float x_start = v0.position.x;
-    float x_end = v1.position.x;
-    float y_start = v0.position.y;
-    float y_end = v1.position.y;
-
-    Vector4 color_start = v0.color;
-    Vector4 color_end = v1.color;
-
-    // fixme  floor ԸȡֵӰ
-    int dx = (int)x_end - (int)x_start;
-    int x_inc = (dx > 0) ? 1 : -1;
-    dx = abs(dx);
-    int dy = (int)y_end - (int)y_start;
-    int y_inc = (dy > 0) ? 1 : -1;
-    dy = abs(dy);
-
-    bool is_step_x = true;
-    int step = dx;
-    if (dx < dy)
+    vertices_.clear();
+    triangles_.clear();
+    translucent_.clear();
+    // ˮģʽ֡ɫդ߳
+    ReleaseBindings(&bindings_);
+    shadow_vertices_.clear();
+    shadow_triangles_.clear();
+    draw_list_.clear();
+    stats_.Reset();
+    if (occlusion_culling_)
+    {
+        occlusion_.Clear();
+    }
+    if (shadow_size_ > 0 && light_)
     {
-        is_step_x = false;
-        step = dy;
+        shadow_maps_[shadow_index_].SetLight(light_->position, shadow_target_, shadow_fov_, shadow_near_, shadow_far_);
     }
+}
 
-    Vector4 dc = (color_end - color_start) / (float)step;
+void Renderer::EndFrame(void)
+{
+    FlushDrawList();
+    if (raster_thread_)
+    {
+        // һ֡դٽ֡դڼ߳Ѿڴ֡ļ
+        // դ̴߳ʱûдͳƣʱƳ
+        WaitForSingleObject(raster_done_, INFINITE);
+        last_raster_stats_ = raster_stats_;
+        TakeFrameState();
+        SetEvent(raster_start_);
+    }
+    else
+    {
+        TakeFrameState();
+        RasterizeFrame();
+        last_raster_stats_ = raster_stats_;
+    }
+}
 
-    int x_count = 0;
-    int y_count = 0;
-    
-    int x = (int)x_start;
-    int y = (int)y_start;
-    Vector4 color = color_start;
+void Renderer::set_pipelined(bool flag)
+{
+    if (flag == get_pipelined())
+        return;
 
-    set_pixel(x, y, vector4_to_ARGB32(color));
-    for (int k = 1; k < step; ++k)
+    if (flag)
     {
-        x_count += dx;
-        if (x_count >= step)
+        if (IsOffscreen())
         {
-            x_count -= step;
-            x += x_inc;
-            if (is_step_x)
-                color += dc;
+            assert(0);
+            return;
         }
-        y_count += dy;
-        if (y_count >= step)
+        raster_exit_ = false;
+        raster_start_ = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+        raster_done_ = CreateEvent(nullptr, FALSE, TRUE, nullptr);
+        raster_thread_ = CreateThread(nullptr, 0, RasterThreadProc, this, 0, nullptr);
+        if (!raster_thread_)
         {
-            y_count -= step;
-            y += y_inc;
-            if (!is_step_x)
-                color += dc;
+            GT_LOG_ERROR("create raster thread failed: %d", GetLastError());
+            CloseHandle(raster_start_);
+            CloseHandle(raster_done_);
+            raster_start_ = NULL;
+            raster_done_ = NULL;
         }
-        set_pixel(x, y, vector4_to_ARGB32(color));
+    }
+    else
+    {
+        // ;֡˳
+        WaitForSingleObject(raster_done_, INFINITE);
+        last_raster_stats_ = raster_stats_;
+        raster_exit_ = true;
+        SetEvent(raster_start_);
+        WaitForSingleObject(raster_thread_, INFINITE);
+        CloseHandle(raster_thread_);
+        CloseHandle(raster_start_);
+        CloseHandle(raster_done_);
+        raster_thread_ = NULL;
+        raster_start_ = NULL;
+        raster_done_ = NULL;
     }
 }
 
-void Renderer::BeginFrame(void)
+DWORD WINAPI Renderer::RasterThreadProc(LPVOID param)
 {
-    rend_primitive_.Clear();
-    triangles_.clear();
-    for (int i = 0; i < width_; ++i)
+    Renderer *renderer = static_cast<Renderer *>(param);
+    for (;;)
     {
-        for (int j = 0; j < height_; ++j)
-        {
-            one_over_z_buffer_[j * width_ + i] = 0.0f;
-        }
+        WaitForSingleObject(renderer->raster_start_, INFINITE);
+        if (renderer->raster_exit_)
+            break;
+        renderer->RasterizeFrame();
+        SetEvent(renderer->raster_done_);
     }
+    return 0;
 }
 
-void Renderer::EndFrame(void)
+void Renderer::TakeFrameState(void)
+{
+    // ߳ûһ֡ѾĿռ䣬BeginFrameʱ
+    frame_.vertices.swap(vertices_);
+    frame_.triangles.swap(triangles_);
+    frame_.translucent.swap(translucent_);
+    frame_.bindings.swap(bindings_);
+    frame_.shadow_vertices.swap(shadow_vertices_);
+    frame_.shadow_triangles.swap(shadow_triangles_);
+    frame_.text.swap(text_quads_);
+    text_quads_.clear();
+
+    frame_.shading_mode = shading_mode_;
+    frame_.diff_perspective = diff_perspective;
+    frame_.tri_up_down = tri_up_down_;
+    // ;һ֡ĺʱɵòãʱ
+    if (resolution_reset_)
+    {
+        resolution_scale_ = 1.0f;
+        resolution_reset_ = false;
+    }
+    else
+    {
+        UpdateResolutionScale(last_raster_stats_.raster_ms);
+    }
+    frame_.render_width = width_;
+    frame_.render_height = height_;
+    if (dynamic_resolution_)
+    {
+        frame_.render_width = max_t(static_cast<int>(width_ * resolution_scale_ + 0.5f), 1);
+        frame_.render_height = max_t(static_cast<int>(height_ * resolution_scale_ + 0.5f), 1);
+    }
+    frame_.msaa_samples = msaa_samples_;
+    frame_.depth_prepass = depth_prepass_;
+    frame_.post_process = post_process_settings_;
+    frame_.shadow = nullptr;
+    if (shadow_size_ > 0 && light_ && camera_)
+    {
+        frame_.shadow = &shadow_maps_[shadow_index_];
+        frame_.camera_to_light = camera_->GetInverseModelViewMatrix();
+        frame_.camera_to_light = frame_.camera_to_light * frame_.shadow->get_view_proj();
+        const Matrix44 &perspective = camera_->GetPerpectivMatrix();
+        frame_.view_scale_x = 1.0f / ((frame_.render_width / 2) * perspective.m00);
+        frame_.view_scale_y = -1.0f / ((frame_.render_height / 2) * perspective.m11);
+        shadow_index_ ^= 1;
+    }
+}
+
+void Renderer::RasterizeFrame(void)
 {
-    d3d_device_->Clear(0, nullptr, D3DCLEAR_TARGET, 0, 0, 0);
+    raster_stats_.Reset();
+    if (frame_.shadow)
+    {
+        RasterizeShadow();
+    }
+
+    // դֻдֿɫ1/zԵĺ󻺳壬1/zһֱַֿ
+    SetRenderSize(frame_.render_width, frame_.render_height);
+    double start = get_time_ms();
+    for (int i = 0; i < tiled_size_; ++i)
+    {
+        one_over_z_buffer_[i] = 0.0f;
+    }
+    memset(tile_color_, 0, tiled_size_ * sizeof(uint32));
+    Rasterization();
+    raster_stats_.raster_ms = get_time_ms() - start;
+
+    if (IsOffscreen())
+    {
+        ResolveTiles();
+        post_process_.Apply(frame_.post_process, buffer_, width_, height_, pitch_);
+        FlushText();
+        return;
+    }
+
+    // ResolveTilesд󻺳壬Clear
     D3DLOCKED_RECT lockinfo;
     memset(&lockinfo, 0, sizeof(lockinfo));
     HRESULT res = d3d_backbuffer_->LockRect(&lockinfo, nullptr, D3DLOCK_DISCARD);
     if (FAILED(res))
     {
-        Logger::GtLogError("d3d LockRect failed: %d", GetLastError());
+        GT_LOG_ERROR("d3d LockRect failed: %d", GetLastError());
         return;
     }
     buffer_ = static_cast<uint32 *>(lockinfo.pBits);
     pitch_ = lockinfo.Pitch;
-    Rasterization();
-    d3d_backbuffer_->UnlockRect();
+    ResolveTiles();
+    post_process_.Apply(frame_.post_process, buffer_, width_, height_, pitch_);
     FlushText();
+    d3d_backbuffer_->UnlockRect();
     d3d_device_->Present(0, 0, 0, 0);
 }
 
+void Renderer::ApplyShadowBias(void)
+{
+    // 1/wĻռԵģ1/wȥͬһͰԶ
+    // üιö㣬ǹ棬ƫͬ
+    vector<RendVertex> &vertices = frame_.shadow_vertices;
+    shadow_bias_.assign(vertices.size(), 0.0f);
+    for (int i = 0; i < frame_.shadow_triangles.size(); ++i)
+    {
+        const Triangle &tri = frame_.shadow_triangles[i];
+        const Vector4 &p0 = vertices[tri.v[0]].position;
+        const Vector4 &p1 = vertices[tri.v[1]].position;
+        const Vector4 &p2 = vertices[tri.v[2]].position;
+        float area = (p1.x - p0.x) * (p2.y - p0.y) - (p2.x - p0.x) * (p1.y - p0.y);
+        if (absf(area) < 1e-6f)
+            continue;
+        float z0 = 1.0f / p0.w;
+        float dz1 = 1.0f / p1.w - z0;
+        float dz2 = 1.0f / p2.w - z0;
+        float dz_dx = (dz1 * (p2.y - p0.y) - dz2 * (p1.y - p0.y)) / area;
+        float dz_dy = (dz2 * (p1.x - p0.x) - dz1 * (p2.x - p0.x)) / area;
+        float bias = frame_.shadow->GetDepthBias(max_t(absf(dz_dx), absf(dz_dy)));
+        for (int k = 0; k < 3; ++k)
+        {
+            shadow_bias_[tri.v[k]] = max_t(shadow_bias_[tri.v[k]], bias);
+        }
+    }
+    for (int i = 0; i < vertices.size(); ++i)
+    {
+        if (shadow_bias_[i] > 0.0f)
+        {
+            float one_over_w = 1.0f / vertices[i].position.w - shadow_bias_[i];
+            vertices[i].position.w = 1.0f / max_t(one_over_w, 1e-7f);
+        }
+    }
+}
+
 void Renderer::DrawPrimitive(Primitive *primitive)
 {
-    rend_primitive_ = RendPrimitive(primitive->size);
+    Matrix44 world = Matrix44::CreateIdentity();
+    DrawPrimitiveInstanced(primitive, &world, 1);
+}
 
-    for (int i = 0; i < rend_primitive_.size; ++i)
+void Renderer::DrawPrimitive(Primitive *primitive, const Matrix44 &world)
+{
+    DrawPrimitiveInstanced(primitive, &world, 1);
+}
+
+// бڽԶƽֵ֮ȶͬһڵĻưͲʹһ
+static const float kDrawDepthBuckets = 256.0f;
+
+void Renderer::DrawPrimitiveInstanced(Primitive *primitive, const Matrix44 *transforms, int count)
+{
+    if (!draw_sorting_)
     {
-        rend_primitive_.vertexs[i].position.SetVector3(primitive->positions[i]);
-        rend_primitive_.vertexs[i].position.w = 1.0f;
-        rend_primitive_.vertexs[i].normal = primitive->normals[i];
-        rend_primitive_.vertexs[i].uv = primitive->uvs[i];
-        rend_primitive_.vertexs[i].color = primitive->colors[i];
+        ExecuteDraw(primitive, transforms, count);
+        return;
     }
 
-    mat_ = primitive->material;
+    assert(primitive);
+    assert(transforms || count == 0);
+    if (count <= 0 || primitive->size <= 0)
+        return;
 
-    Matrix44 model_view = camera_->GetModelViewMatrix();
-    ModelViewTransform(model_view);
-    Lighting();
-    float z_far = camera_->get_far();
+    // ÿʵ¼ΧĵռzûаΧʱԭ
+    double start = get_time_ms();
+    Vector4 center(0.0f, 0.0f, 0.0f, 1.0f);
+    if (primitive->has_bound)
+    {
+        center.SetVector3((primitive->bound_min + primitive->bound_max) * 0.5f);
+    }
+    const Matrix44 &view = camera_->GetModelViewMatrix();
     float z_near = camera_->get_near();
-    Clipping(z_near, z_far);
-    Matrix44 perspective = camera_->GetPerpectivMatrix();
-    Projection(perspective);
+    float scale = kDrawDepthBuckets / (camera_->get_far() - z_near);
+    for (int i = 0; i < count; ++i)
+    {
+        Vector4 pos = center * transforms[i];
+        pos = pos * view;
+        DrawCommand command;
+        command.primitive = primitive;
+        command.world = transforms[i];
+        command.texture = texture_;
+        command.normal_map = normal_map_;
+        command.shading_mode = shading_mode_;
+        command.blend = blend_mode_;
+        command.shading_rate = shading_rate_;
+        command.depth = static_cast<uint32>(clamp((pos.z - z_near) * scale, 0.0f, kDrawDepthBuckets - 1.0f));
+        draw_list_.push_back(command);
+    }
+    stats_.sort_ms += get_time_ms() - start;
 }
 
-// rend_primitive ռ
-void Renderer::ModelViewTransform(const Matrix44 &model_view)
+void Renderer::FlushDrawList(void)
 {
-    Matrix33 normal_trans = model_view.GetMatrix33();
-    normal_trans.SetInverse();
-    normal_trans.SetTranspose();
+    if (draw_list_.empty())
+        return;
 
-    // תƹλ
+    // ͸ǰӽԶ1/zܵأͬһȶͬʡͼԪ
+    // ͸ıύ˳򣬹դʱᰴԶ
+    double start = get_time_ms();
+    const vector<DrawCommand> &list = draw_list_;
+    int count = static_cast<int>(list.size());
+    draw_order_.resize(count);
+    for (int i = 0; i < count; ++i)
+    {
+        draw_order_[i] = i;
+    }
+    std::stable_sort(draw_order_.begin(), draw_order_.end(), [&list](int ia, int ib) -> bool
+    {
+        const DrawCommand &a = list[ia];
+        const DrawCommand &b = list[ib];
+        bool translucent_a = a.blend != kBlendOpaque;
+        bool translucent_b = b.blend != kBlendOpaque;
+        if (translucent_a != translucent_b)
+            return translucent_b;
+        if (translucent_a)
+            return false;
+        if (a.depth != b.depth)
+            return a.depth < b.depth;
+        // ¼ʱ󶨵飬ɫõͼԪϵtexture
+        if (a.texture != b.texture)
+            return a.texture < b.texture;
+        if (a.primitive->material != b.primitive->material)
+            return a.primitive->material < b.primitive->material;
+        return a.primitive < b.primitive;
+    });
+    stats_.sort_ms += get_time_ms() - start;
+    stats_.sorted_draws += count;
+
+    // ÿư¼ʱ״ִ̬Уִָߵǰ״̬
+    Texture2D *texture = texture_;
+    const NormalMap *normal_map = normal_map_;
+    ShadingMode shading_mode = shading_mode_;
+    BlendMode blend_mode = blend_mode_;
+    ShadingRate shading_rate = shading_rate_;
+    for (int i = 0; i < count;)
+    {
+        const DrawCommand &first = list[draw_order_[i]];
+        draw_batch_.clear();
+        int j = i;
+        for (; j < count; ++j)
+        {
+            const DrawCommand &command = list[draw_order_[j]];
+            if (command.primitive != first.primitive || command.texture != first.texture
+                || command.normal_map != first.normal_map || command.shading_mode != first.shading_mode
+                || command.blend != first.blend || command.shading_rate != first.shading_rate)
+                break;
+            draw_batch_.push_back(command.world);
+        }
+        set_texture(first.texture);
+        normal_map_ = first.normal_map;
+        shading_mode_ = first.shading_mode;
+        blend_mode_ = first.blend;
+        shading_rate_ = first.shading_rate;
+        ExecuteDraw(first.primitive, &draw_batch_[0], static_cast<int>(draw_batch_.size()));
+        i = j;
+    }
+    set_texture(texture);
+    normal_map_ = normal_map;
+    shading_mode_ = shading_mode;
+    blend_mode_ = blend_mode;
+    shading_rate_ = shading_rate;
+    draw_list_.clear();
+}
+
+void Renderer::ExecuteDraw(Primitive *primitive, const Matrix44 *transforms, int count)
+{
+    assert(primitive);
+    // ɫƱλƵĲʡƹ⡢ͷͼͬһ֡ڸλƻӰ
+    // ʱͼɫģʽFlushDrawListָɼ¼ʱģƹȡEndFrameʱ
+    bool textured = texture_ != nullptr;
+    Material *mat = primitive->material;
+    if (shading_mode_ == kFlat || shading_mode_ == kGouraud)
+    {
+        assert(light_ && mat);
+        if (!light_ || !mat)
+            return;
+    }
+
+    if (shading_mode_ == kFlat)
+    {
+        if (textured)
+            ExecuteDraw(primitive, transforms, count, FlatVertexShader(*mat, *light_), ColorPixelShader<true>(texture_));
+        else
+            ExecuteDraw(primitive, transforms, count, FlatVertexShader(*mat, *light_), ColorPixelShader<false>(texture_));
+    }
+    else if (shading_mode_ == kGouraud)
+    {
+        if (textured)
+            ExecuteDraw(primitive, transforms, count, GouraudVertexShader(*mat, *light_), ColorPixelShader<true>(texture_));
+        else
+            ExecuteDraw(primitive, transforms, count, GouraudVertexShader(*mat, *light_), ColorPixelShader<false>(texture_));
+    }
+    else if (shading_mode_ == kPhong)
+    {
+        Material material = mat ? *mat : Material();
+        Light light = light_ ? *light_ : Light();
+        const NormalMap *normal_map = (normal_map_ && !normal_map_->IsEmpty()) ? normal_map_ : nullptr;
+        UnlitVertexShader vs;
+        if (normal_map && textured)
+            ExecuteDraw(primitive, transforms, count, vs, PhongPixelShader<true, true>(material, light, texture_, normal_map));
+        else if (normal_map)
+            ExecuteDraw(primitive, transforms, count, vs, PhongPixelShader<false, true>(material, light, texture_, normal_map));
+        else if (textured)
+            ExecuteDraw(primitive, transforms, count, vs, PhongPixelShader<true, false>(material, light, texture_, normal_map));
+        else
+            ExecuteDraw(primitive, transforms, count, vs, PhongPixelShader<false, false>(material, light, texture_, normal_map));
+    }
+    else
+    {
+        if (textured)
+            ExecuteDraw(primitive, transforms, count, UnlitVertexShader(), ColorPixelShader<true>(texture_));
+        else
+            ExecuteDraw(primitive, transforms, count, UnlitVertexShader(), ColorPixelShader<false>(texture_));
+    }
+}
+
+int Renderer::PrepareInstances(Primitive *primitive, const Matrix44 *transforms, int count, bool lit)
+{
+    mat_ = primitive->material;
+
+    const Matrix44 &view = camera_->GetModelViewMatrix();
+    const Matrix44 &view_proj = camera_->GetViewProjectionMatrix();
+
+    // תƹλãʵ
     if (light_)
     {
         Vector4 pl;
         pl.SetVector3(light_->position);
         pl.w = 1.0f;
-        pl = pl * model_view;
+        pl = pl * view;
         light_pos_ = pl.GetVector3();
     }
 
-#if 0
-    for (int i = 0; i < rend_primitive_.size; ++i)
+    // ʵľ󣬱ڵʵ붥㴦
+    bool occlusion = occlusion_culling_ && primitive->has_bound;
+    double start = get_time_ms();
+    instance_matrices_.clear();
+    for (int i = 0; i < count; ++i)
     {
-        if (((i + 1) % 3) == 0)
+        Matrix44 world = transforms[i];
+        InstanceMatrix matrix;
+        matrix.model_view_proj = world * view_proj;
+        if (occlusion)
         {
-            Vector3 p0 = rend_primitive_.vertexs[i - 2].position.GetVector3();
-            Vector3 p1 = rend_primitive_.vertexs[i - 1].position.GetVector3();
-            Vector3 p2 = rend_primitive_.vertexs[i].position.GetVector3();
-
-            Vector3 e0 = p0 - p1;
-            Vector3 e1 = p1 - p2;
-
-            Vector3 n = rend_primitive_.vertexs[i-1].normal;
-            float dot = DotProduct(e0, n);
-//            Logger::GtLogInfo("before:0\t%f", dot);
-            assert(equalf(dot, 0, 0.001));
-            dot = DotProduct(e1, n);
-//            Logger::GtLogInfo("before:1\t%f", dot);
-            assert(equalf(dot, 0, 0.001));
+            ++stats_.occlusion_tested;
+            if (occlusion_.IsOccluded(primitive->bound_min, primitive->bound_max, matrix.model_view_proj))
+            {
+                ++stats_.occlusion_culled;
+                continue;
+            }
         }
+        if (lit)
+        {
+            matrix.model_view = world * view;
+            matrix.normal = matrix.model_view.GetMatrix33();
+            matrix.normal.SetInverse();
+            matrix.normal.SetTranspose();
+        }
+        instance_matrices_.push_back(matrix);
+    }
+    if (occlusion)
+    {
+        stats_.occlusion_ms += get_time_ms() - start;
     }
-#endif
+    return static_cast<int>(instance_matrices_.size());
+}
 
-    for (int i = 0; i < rend_primitive_.size; ++i)
+void Renderer::ReleaseBindings(vector<PixelShaderBinding> *bindings)
+{
+    for (int i = 0; i < bindings->size(); ++i)
     {
-        Vector4 &position = rend_primitive_.vertexs[i].position;
-        position = position * model_view;
-        Vector3 &normal = rend_primitive_.vertexs[i].normal;
-        normal = normal * normal_trans;
-        normal.SetNormalize();
+        PixelShaderBinding &binding = (*bindings)[i];
+        binding.destroy(binding.shader);
     }
+    bindings->clear();
+}
 
-#if 0
+void Renderer::FetchVertices(const Primitive *primitive)
+{
+    // 㻺ֻͼԪС仯ʱ·
+    if (rend_primitive_.size != primitive->size)
+    {
+        rend_primitive_ = RendPrimitive(primitive->size);
+    }
+    // FlatGouraudÿʵ帲ɫģʽɫȡһξ͹
     for (int i = 0; i < rend_primitive_.size; ++i)
     {
-        if (((i + 1) % 3) == 0)
-        {
-            Vector4 p0 = rend_primitive_.vertexs[i - 2].position;
-            Vector4 p1 = rend_primitive_.vertexs[i - 1].position;
-            Vector4 p2 = rend_primitive_.vertexs[i].position;
-
-            Vector3 e0 = (p0 - p1).GetVector3();
-            Vector3 e1 = (p1 - p2).GetVector3();
-
-            Vector3 N = CrossProduct(e0, e1);
-            N.SetNormalize();
-
-            float dot = DotProduct(N, e0);
-            Logger::GtLogInfo("dot e0 \t%f", dot);
-            dot = DotProduct(N, e1);
-            Logger::GtLogInfo("dot e1 \t%f", dot);
-
-            Vector3 n0 = rend_primitive_.vertexs[i - 2].normal;
-            Vector3 n1 = rend_primitive_.vertexs[i - 1].normal;
-            Vector3 n2 = rend_primitive_.vertexs[i].normal;
-            Vector3 zero = CrossProduct(N, n1);
-            zero.Display();
-
-            dot = DotProduct(e0, n0);
-            Logger::GtLogInfo("after:0\t%f", dot);
-            dot = DotProduct(e1, n0);
-            Logger::GtLogInfo("after:1\t%f", dot);
-        }
+        RendVertex &vertex = rend_primitive_.vertexs[i];
+        vertex.uv = primitive->uvs[i];
+        vertex.color = primitive->colors[i];
+        vertex.tangent.SetZero();
     }
-#endif
 }
 
-Vector4 Shading(const Vector3 &pos, const Vector3 &normal, const Material &mat, const Light &light)
+void Renderer::DrawOccluder(Primitive *primitive, const Matrix44 &world)
 {
-    // ߷ָԴ
-    Vector3 L = light.position - pos;
-    // Դ
-    float dist = L.Magnitude();
-    L.SetNormalize();
-    // ǿԴ
-    float I = 1.0f / (light.attenuation0 + light.attenuation1 * dist + light.attenuation2 * dist * dist);
-    // 
-    Vector4 amb_color = light.ambient * mat.ambient * I;
-    amb_color = clamp(amb_color, 0.0f, 1.0f);
-    Vector3 N = normal;
-    N.SetNormalize();
-    // 㷨
-    float light_angle = DotProduct(L, N);
-    light_angle = max_t(light_angle, 0.0f);
-    // 
-    Vector4 diff_color = light.diffuse * mat.diffuse * light_angle * I;
-    diff_color = clamp(diff_color, 0.0f, 1.0f);
-    // ۲췽ռ䣩
-    Vector3 V = -pos;
-    V.SetNormalize();
-    // 
-    Vector3 H = L + V;
-    H.SetNormalize();
-    // 淴
-    float view_angle = DotProduct(H, N);
-    view_angle = max_t(view_angle, 0.0f);
-    Vector4 spec_color = light.specular * mat.specular * powf(view_angle, mat.specular.w) * I;
-    spec_color = clamp(spec_color, 0.0f, 1.0f);
-    Vector4 ret = amb_color + diff_color + spec_color;    
-    return ret;
+    assert(primitive);
+    if (!occlusion_culling_)
+        return;
+
+    double start = get_time_ms();
+    Matrix44 model_view_proj = world;
+    model_view_proj = model_view_proj * camera_->GetViewProjectionMatrix();
+    occlusion_.DrawOccluder(primitive, model_view_proj);
+    stats_.occlusion_ms += get_time_ms() - start;
 }
 
-void Renderer::Lighting(void)
+void Renderer::EnableShadow(int size, const Vector3 &target, float fov, float z_near, float z_far)
 {
-    if (shading_mode_ == kFrame || shading_mode_ == kNoLightingEffect)
+    assert(size > 0);
+    // դ߳̿ڶͼͣˮ
+    bool pipelined = get_pipelined();
+    set_pipelined(false);
+    if (size != shadow_size_)
     {
-        return;
+        shadow_maps_[0].Resize(size);
+        shadow_maps_[1].Resize(size);
     }
-    else if (shading_mode_ == kFlat)
-    {
-        assert(light_);
-        if (!light_) 
-            return;
-        for (int i = 2; i < rend_primitive_.size; i += 3)
-        {
-            // Ϊ
-            if ((i + 1) % 3 != 0)
-                continue;
-
-            Vector3 p0 = rend_primitive_.vertexs[i - 2].position.GetVector3();
-            Vector3 p1 = rend_primitive_.vertexs[i - 1].position.GetVector3();
-            Vector3 p2 = rend_primitive_.vertexs[i].position.GetVector3();
+    shadow_size_ = size;
+    shadow_target_ = target;
+    shadow_fov_ = fov;
+    shadow_near_ = z_near;
+    shadow_far_ = z_far;
+    set_pipelined(pipelined);
+}
 
-            Vector3 pos = (p0 + p1 + p2) * (1.0f / 3.0f);
+void Renderer::DisableShadow(void)
+{
+    shadow_size_ = 0;
+}
 
-            Vector3 e0 = p1 - p0;
-            Vector3 e1 = p2 - p1;
+void Renderer::DrawShadowCaster(Primitive *primitive, const Matrix44 &world)
+{
+    assert(primitive);
+    if (shadow_size_ == 0 || !light_ || primitive->size <= 0)
+        return;
 
-            Vector3 normal = CrossProduct(e0, e1);
-            normal.SetNormalize();
+    // 湲ö任ͲüŽӰԼĶأ涼ҪͶӰ
+    InstanceMatrix matrix;
+    matrix.model_view_proj = world;
+    matrix.model_view_proj = matrix.model_view_proj * shadow_maps_[shadow_index_].get_view_proj();
+    FetchVertices(primitive);
+    TransformVertices(primitive, matrix, false);
+    vertices_.swap(shadow_vertices_);
+    triangles_.swap(shadow_triangles_);
+    bool backface_culling = backface_culling_;
+    backface_culling_ = false;
+    Clipping();
+    backface_culling_ = backface_culling;
+    vertices_.swap(shadow_vertices_);
+    triangles_.swap(shadow_triangles_);
+}
 
-            Vector4 color = Shading(pos, normal, *mat_, *light_);
-            rend_primitive_.vertexs[i - 2].color = color;
-            rend_primitive_.vertexs[i - 1].color = color;
-            rend_primitive_.vertexs[i].color = color;
-        }
-    }
-    else if (shading_mode_ == kGouraud)
-    {
-        assert(light_);
-        if (!light_) 
-            return;
-        for (int i = 0; i < rend_primitive_.size; ++i)
-        {
-            // λ
-            const Vector3 pos = rend_primitive_.vertexs[i].position.GetVector3();
-            const Vector3 &normal = rend_primitive_.vertexs[i].normal;
-            Vector4 color = Shading(pos, normal, *mat_, *light_);
-            rend_primitive_.vertexs[i].color = color;
-        }
-    }
-    else if (shading_mode_ == kPhong)
+void Renderer::QueueTranslucent(int first, bool lit, int binding)
+{
+    // йʱɫalphaѱսǣòʵalpha
+    float alpha = mat_ ? mat_->diffuse.w : 1.0f;
+    for (int i = first; i < triangles_.size(); ++i)
     {
-        for (int i = 0; i < rend_primitive_.size; ++i)
+        TranslucentTriangle translucent;
+        translucent.tri = triangles_[i];
+        translucent.blend = blend_mode_;
+        translucent.depth = 0.0f;
+        translucent.shader = binding;
+        for (int j = 0; j < 3; ++j)
         {
-            // ¼ԭλ
-            rend_primitive_.vertexs[i].global_pos = rend_primitive_.vertexs[i].position.GetVector3();
+            // ֻڱλƣֱӸ
+            RendVertex &vertex = vertices_[translucent.tri.v[j]];
+            if (lit)
+                vertex.color.w = alpha;
+            translucent.depth += vertex.position.w;
         }
-        return;
+        translucent.depth *= 1.0f / 3.0f;
+        translucent_.push_back(translucent);
     }
+    triangles_.resize(first);
 }
 
-// rend_primitive [N/R*x, N/T*y, F(z-N)/(F-N), z] / z
-// ͸Ӳüͼ任cvv
-void Renderer::Projection(const Matrix44 &perspective)
+// βüռƽ棺-w <= x <= w, -w <= y <= w, 0 <= z <= w
+static const int kClipPlaneCount = 6;
+
+// planeƽ룬>= 0ڲ
+static inline float clip_distance(const Vector4 &p, int plane)
 {
-    Matrix44 tran_pos = Matrix44::CreateIdentity();
-    tran_pos.SetTranslation(0, 0, 0.5);
-//    for (int i = 0; i < rend_primitive_.size; ++i)
-//    {
-//        Vector4 &position = rend_primitive_.vertexs[i].position;
-//        position = position * tran_pos;
-//        position = position * perspective;
-//    }
-    for (int i = 0; i < triangles_.size(); ++i)
+    switch (plane)
     {
-        for (int j = 0; j < 3; ++j)
-        {
-            Vector4 &position = triangles_[i].v[j].position;
-//            position = position * tran_pos;
-            position = position * perspective;
-        }
+    case 0: return p.w + p.x;
+    case 1: return p.w - p.x;
+    case 2: return p.w + p.y;
+    case 3: return p.w - p.y;
+    case 4: return p.z;
+    default: return p.w - p.z;
     }
 }
 
-static void clip_near_plane(const RendVertex &a, const RendVertex &b, RendVertex *o)
+// iλʾڵiƽ
+static inline uint32 clip_outcode(const Vector4 &p)
 {
-    assert(a.position.z <= 0);
-    assert(b.position.z > 0);
-
-    float k = (FLT_EPSILON - a.position.z) / (b.position.z - a.position.z);
-    Vector4 pos = lerp(a.position, b.position, k);
-    assert(pos.z > 0);
-    Vector3 nor = lerp(a.normal, b.normal, k);
-    Vector4 col = lerp(a.color, b.color, k);
-    Vector2 uv = lerp(a.uv, b.uv, k);
-
-    o->position = pos;
-    o->normal = nor;
-    o->color = col;
-    o->uv = uv;
+    uint32 code = 0;
+    if (p.w + p.x < 0.0f) code |= 0x01;
+    if (p.w - p.x < 0.0f) code |= 0x02;
+    if (p.w + p.y < 0.0f) code |= 0x04;
+    if (p.w - p.y < 0.0f) code |= 0x08;
+    if (p.z < 0.0f) code |= 0x10;
+    if (p.w - p.z < 0.0f) code |= 0x20;
+    return code;
 }
 
-static bool is_backface(const Vector3 &a, const Vector3 &b, const Vector3 &c)
+// üռԲֵ͸ȷ
+static void lerp_vertex(const RendVertex &a, const RendVertex &b, float k, RendVertex *o)
 {
-    Vector3 n = CrossProduct(b - a, c - a);
-    return (n.z > 0);
+    o->position = lerp(a.position, b.position, k);
+    o->normal = lerp(a.normal, b.normal, k);
+    o->color = lerp(a.color, b.color, k);
+    o->uv = lerp(a.uv, b.uv, k);
+    o->global_pos = lerp(a.global_pos, b.global_pos, k);
+    o->tangent = lerp(a.tangent, b.tangent, k);
 }
 
-void Renderer::Clipping(float z_far, float z_near)
+// rend_primitive [N/R*x, N/T*y, F(z-N)/(F-N), z]
+// ͼԪĶһͶӰβüռ䲢outcodeüʱγ
+// ֱӴռݱ任ȸһݶ
+void Renderer::TransformVertices(const Primitive *primitive, const InstanceMatrix &matrix, bool lit)
 {
-    static const int TRIANGLE_SIZE = 3;
-    static const uint32 OVER_LEFT = 0x00000F;
-    static const uint32 OVER_RIGHT = 0x0000F0;
-    static const uint32 OVER_TOP = 0x000F00;
-    static const uint32 OVER_BUTTON = 0x00F000;
-    static const uint32 OVER_FAR = 0x0F0000;
-
-    for (int i = 0; i < rend_primitive_.size; i += 3)
+    clip_codes_.resize(rend_primitive_.size);
+    for (int i = 0; i < rend_primitive_.size; ++i)
     {
-        int vertex_before_xy = 0;
-        uint32 vertex_culling_flag[TRIANGLE_SIZE] = {0};
-        bool vertex_before_flag[TRIANGLE_SIZE] = {false, false, false};
+        RendVertex &vertex = rend_primitive_.vertexs[i];
+        const Vector3 &p = primitive->positions[i];
+        vertex.position = Vector4(p.x, p.y, p.z, 1.0f) * matrix.model_view_proj;
+        clip_codes_[i] = clip_outcode(vertex.position);
+    }
+    if (!lit)
+        return;
 
-        // ʹңϣ£ǰƽ޳ ƽвü
-        for (int j = 0; j < TRIANGLE_SIZE; ++j)
+    // ռ
+    for (int i = 0; i < rend_primitive_.size; ++i)
+    {
+        RendVertex &vertex = rend_primitive_.vertexs[i];
+        const Vector3 &p = primitive->positions[i];
+        vertex.global_pos = (Vector4(p.x, p.y, p.z, 1.0f) * matrix.model_view).GetVector3();
+        vertex.normal = primitive->normals[i] * matrix.normal;
+        vertex.normal.SetNormalize();
+    }
+    // ڱڣmodel_view任Ƿ߾
+    if (primitive->tangents)
+    {
+        for (int i = 0; i < rend_primitive_.size; ++i)
         {
-            Vector4 &p0 = rend_primitive_.vertexs[i + j].position;
-
-            if (p0.x < z_near)
-                vertex_culling_flag[j] |= OVER_LEFT;
-            if (p0.x > z_near)
-                vertex_culling_flag[j] |= OVER_RIGHT;
-            if (p0.y < z_near)
-                vertex_culling_flag[j] |= OVER_BUTTON;
-            if (p0.y > z_near)
-                vertex_culling_flag[j] |= OVER_TOP;
-            if (p0.z > z_far)
-                vertex_culling_flag[j] |= OVER_FAR;
-
-            if (p0.z > 0)
-            {
-                vertex_before_flag[j] = true;
-                ++vertex_before_xy;
-            }
+            const Vector4 &t = primitive->tangents[i];
+            Vector4 tangent = Vector4(t.x, t.y, t.z, 0.0f) * matrix.model_view;
+            tangent.w = t.w;
+            rend_primitive_.vertexs[i].tangent = tangent;
         }
+    }
+}
 
-        uint32 culling = 0;
-        for (int j = 0; j < TRIANGLE_SIZE; ++j)
-        {
-            culling &= vertex_culling_flag[j];
-        }
-        // ޳
-        if (culling)
-        {
-            continue;
-        }
+// ͸Ӿ󲻸ıxyķźͱüռxyĲռͬ
+static bool is_backface(const Vector4 &a, const Vector4 &b, const Vector4 &c)
+{
+    float nz = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    return (nz > 0);
+}
 
-        RendVertex *vtx = rend_primitive_.vertexs + i;
+void Renderer::Clipping(void)
+{
+    // 任ĶŽأֱãüֻ׷ɵĽ
+    uint32 base = static_cast<uint32>(vertices_.size());
+    vertices_.insert(vertices_.end(), rend_primitive_.vertexs, rend_primitive_.vertexs + rend_primitive_.size);
 
-        bool bf = is_backface(vtx[0].position.GetVector3(),
-                              vtx[1].position.GetVector3(),
-                              vtx[2].position.GetVector3());
-        if (backface_culling_ && bf)
-        {
+    // ȴȫڲΣƽһü
+    clip_queue_.clear();
+    for (int i = 0; i + 2 < rend_primitive_.size; i += 3)
+    {
+        uint32 c0 = clip_codes_[i];
+        uint32 c1 = clip_codes_[i + 1];
+        uint32 c2 = clip_codes_[i + 2];
+        // ͬһƽ
+        if (c0 & c1 & c2)
             continue;
-        }
 
-        int v0 = 0;
-        int v1 = 1;
-        int v2 = 2;
-        // ˳ʱ˳ж
-        if (vertex_before_xy == 0)
+        const RendVertex *vtx = rend_primitive_.vertexs + i;
+        if (backface_culling_ && is_backface(vtx[0].position, vtx[1].position, vtx[2].position))
+            continue;
+
+        if ((c0 | c1 | c2) == 0)
         {
+            triangles_.push_back(Triangle(base + i, base + i + 1, base + i + 2));
             continue;
         }
-        else if (vertex_before_xy == 1)
-        {
-            if (vertex_before_flag[0])
-            {
+        clip_queue_.push_back(i);
+    }
+    if (clip_queue_.empty())
+        return;
 
-            }
-            else if (vertex_before_flag[1])
-            {
-                v0 = 1; v1 = 2; v2 = 0;
-            }
-            else if (vertex_before_flag[2])
-            {
-                v0 = 2; v1 = 0; v2 = 1;
-            }
-            // make v0 is in. v1, v2 is out.
-            // and keep the sequence of triangle.
-            clip_near_plane(vtx[v1], vtx[v0], &vtx[v1]);
-            clip_near_plane(vtx[v2], vtx[v0], &vtx[v2]);
+    double start = get_time_ms();
+    int first = static_cast<int>(triangles_.size());
+    for (size_t i = 0; i < clip_queue_.size(); ++i)
+    {
+        int v = clip_queue_[i];
+        ClipTriangle(base + v, clip_codes_[v] | clip_codes_[v + 1] | clip_codes_[v + 2]);
+    }
+    stats_.clip_triangles += static_cast<int>(clip_queue_.size());
+    stats_.clip_output += static_cast<int>(triangles_.size()) - first;
+    stats_.clip_ms += get_time_ms() - start;
+}
 
-            Triangle tri(vtx[v0], vtx[v1], vtx[v2]);
-            triangles_.push_back(tri);
-        }
-        else if (vertex_before_xy == 2)
+void Renderer::ClipTriangle(uint32 first, uint32 planes)
+{
+    // ÿƽ㣬3 + 6
+    RendVertex scratch[3 + 2 * kClipPlaneCount];
+    int poly[2][3 + kClipPlaneCount];
+    scratch[0] = vertices_[first];
+    scratch[1] = vertices_[first + 1];
+    scratch[2] = vertices_[first + 2];
+    int used = 3;
+    int *in = poly[0];
+    int *out = poly[1];
+    int count = 3;
+    in[0] = 0;
+    in[1] = 1;
+    in[2] = 2;
+
+    for (int plane = 0; plane < kClipPlaneCount; ++plane)
+    {
+        if (!(planes & (1u << plane)))
+            continue;
+        int out_count = 0;
+        for (int j = 0; j < count; ++j)
         {
-            if (!vertex_before_flag[0])
+            int a = in[j];
+            int b = in[j + 1 == count ? 0 : j + 1];
+            float da = clip_distance(scratch[a].position, plane);
+            float db = clip_distance(scratch[b].position, plane);
+            if (da >= 0.0f)
+                out[out_count++] = a;
+            if ((da >= 0.0f) != (db >= 0.0f))
             {
-                //                v0 = 0; v1 = 1; v2 = 2;
+                // ǴڲඥֵεĹߵõͬĽ
+                if (da >= 0.0f)
+                    lerp_vertex(scratch[a], scratch[b], da / (da - db), &scratch[used]);
+                else
+                    lerp_vertex(scratch[b], scratch[a], db / (db - da), &scratch[used]);
+                out[out_count++] = used++;
             }
-            else if (!vertex_before_flag[1])
-            {
-                v0 = 1; v1 = 2; v2 = 0;
-            }
-            else if (!vertex_before_flag[2])
-            {
-                v0 = 2; v1 = 0; v2 = 1;
-            }
-            // make v0 is out. v1, v2 is in. 
-            // and keep the sequence of triangle.
-            RendVertex m;
-            RendVertex n;
-
-            clip_near_plane(vtx[v0], vtx[v1], &m);
-            clip_near_plane(vtx[v0], vtx[v2], &n);
-
-            Triangle tri0(m, vtx[v1], vtx[v2]);
-            triangles_.push_back(tri0);
-            Triangle tri1(n, m, vtx[v2]);
-            triangles_.push_back(tri1);
-        }
-        else if (vertex_before_xy == 3)
-        {
-            Triangle tri(vtx[v0], vtx[v1], vtx[v2]);
-            triangles_.push_back(tri);
-        }
-        else
-        {
-            assert(0);
         }
+        count = out_count;
+        if (count < 3)
+            return;
+        swap(in, out);
+    }
+
+    // ԭеĶڶУֻ׷½㣬ٰβ
+    uint32 index[3 + kClipPlaneCount];
+    for (int j = 0; j < count; ++j)
+    {
+        index[j] = in[j] < 3 ? first + in[j] : PushVertex(scratch[in[j]]);
+    }
+    for (int j = 1; j + 1 < count; ++j)
+    {
+        triangles_.push_back(Triangle(index[0], index[j], index[j + 1]));
     }
 }
 
-static void viewport_transform(int width, int height, Triangle *tri)
+// ÿֻ任һΣܱ
+static void viewport_transform(int width, int height, std::vector<RendVertex> *vertices)
 {
     assert(width > 0);
     assert(height > 0);
     int width_div2 = width / 2;
     int height_div2 = height / 2;
 
-    for (int j = 0; j < 3; ++j)
+    for (int j = 0; j < vertices->size(); ++j)
     {
-        assert(tri->v[j].position.z > 0);
+        Vector4 &position = (*vertices)[j].position;
+        // ޳õεĶҲڳУw <= 0Ĳᱻ
+        if (position.w <= 0)
+            continue;
         // ͸ӳ
-        float div = 1 / tri->v[j].position.w;
-        tri->v[j].position.x *= div;
-        tri->v[j].position.y *= div;
-        tri->v[j].position.z *= div;
-
-//        tri->v[j].color.Display();
+        float div = 1 / position.w;
+        position.x *= div;
+        position.y *= div;
+        position.z *= div;
 
         // [x,y]任[width,height]ķΧ
-        tri->v[j].position.x *= width_div2;
-        tri->v[j].position.x += width_div2;
-        tri->v[j].position.y *= -height_div2;
-        tri->v[j].position.y += height_div2;
+        position.x *= width_div2;
+        position.x += width_div2;
+        position.y *= -height_div2;
+        position.y += height_div2;
     }
 }
 
 void Renderer::Rasterization(void)
 {
-    for (int i = 0; i < triangles_.size(); ++i)
-    {
-        viewport_transform(width_, height_, &triangles_[i]);
+    viewport_transform(render_width_, render_height_, &frame_.vertices);
 
-        if (shading_mode_ == kNoLightingEffect 
-            || shading_mode_ == kFlat 
-            || shading_mode_ == kGouraud 
-            || shading_mode_ == kPhong)
-        {
-            DiffTriangle(&triangles_[i]);
-        }
-        else if (shading_mode_ == kFrame)
-        {
-            RendVertex v0 = triangles_[i].v[0];
-            RendVertex v1 = triangles_[i].v[1];
-            RendVertex v2 = triangles_[i].v[2];
+    // ߿ģʽز
+    if (frame_.shading_mode == kFrame)
+    {
+        RasterizeWireframe();
+        return;
+    }
 
-            DrawLine(v0, v1);
-            DrawLine(v1, v2);
-            DrawLine(v2, v0);
-        }
+    // ɫڻʱѾѡãֻϱ֡Ӱͷֱ
+    vector<PixelShaderBinding> &bindings = frame_.bindings;
+    for (int i = 0; i < bindings.size(); ++i)
+    {
+        bindings[i].bind(this, bindings[i].shader);
     }
+    RasterizeShaded();
 }
 
-
-void Renderer::DiffTriangle(Triangle *tri)
+void Renderer::RasterizeShadow(void)
 {
-    RendVertex &v0 = tri->v[0];
-    Vector4 &p0 = v0.position;
-    RendVertex &v1 = tri->v[1];
-    Vector4 &p1 = v1.position;
-    RendVertex &v2 = tri->v[2];
-    Vector4 &p2 = v2.position;
-
-    if (((int)p0.x == (int)p1.x) && ((int)p1.x == (int)p2.x))
-        return;
-    if (((int)p0.y == (int)p1.y) && ((int)p1.y == (int)p2.y))
-        return;
-
-    // TODO ӦÿùεʽŻd
-    // Ļ꣬yᳯ
-    if (p0.y > p1.y)
+    // ͼ÷ֿ1/z棬ͼĴСդ֮ٻָ֡ķֱ
+    double start = get_time_ms();
+    int size = frame_.shadow->get_size();
+    SetRenderSize(size, size);
+    for (int i = 0; i < tiled_size_; ++i)
     {
-        swap(v0, v1);
+        one_over_z_buffer_[i] = 0.0f;
     }
-    if (p0.y > p2.y)
+    viewport_transform(size, size, &frame_.shadow_vertices);
+    ApplyShadowBias();
+
+    // ɨֻframe_еĶΣʱӰͶ
+    // 1/z͸ȷõֻ/ҲЧ
+    frame_.vertices.swap(frame_.shadow_vertices);
+    frame_.triangles.swap(frame_.shadow_triangles);
+    bool diff_perspective = frame_.diff_perspective;
+    int tri_up_down = frame_.tri_up_down;
+    frame_.diff_perspective = true;
+    frame_.tri_up_down = 0;
+    DiffTriangles<kDepthPassPrepass>(DepthOnlyShader(), 0, static_cast<int>(frame_.triangles.size()));
+    frame_.diff_perspective = diff_perspective;
+    frame_.tri_up_down = tri_up_down;
+    frame_.vertices.swap(frame_.shadow_vertices);
+    frame_.triangles.swap(frame_.shadow_triangles);
+    raster_stats_.shadow_pixels = raster_stats_.prepass_pixels;
+    raster_stats_.prepass_pixels = 0;
+
+    shadow_depth_.resize(size * size);
+    for (int y = 0; y < size; ++y)
     {
-        swap(v0, v2);
+        for (int x0 = 0; x0 < size; x0 += kTileSize)
+        {
+            int columns = min_t(kTileSize, size - x0);
+            memcpy(&shadow_depth_[y * size + x0], one_over_z_buffer_ + tile_index(x0, y), columns * sizeof(float));
+        }
     }
-    if (p1.y > p2.y)
+    frame_.shadow->Resolve(&shadow_depth_[0]);
+    raster_stats_.shadow_ms = get_time_ms() - start;
+}
+
+void Renderer::RasterizeShaded(void)
+{
+    // λƵηΧβӣ˳ɨ裬ֻһɫʱ˳ͬ
+    const vector<PixelShaderBinding> &bindings = frame_.bindings;
+    int count = static_cast<int>(bindings.size());
+    bool msaa = frame_.msaa_samples > 1;
+    if (msaa)
     {
-        swap(v1, v2);
-    }
-    
-    // ƽ
-    /*       v0             v1
-             _____________
-             \           /
-              \         /
-               \       /
-                \     /
-                 \   /
-                  \ /  
-                  v2
-    */
-    if ((int)p0.y == (int)p1.y)
-    {
-        if (p0.x > p1.x)
-            swap(v0, v1);
-        if (tri_up_down_ == 0 || tri_up_down_ == 2) DiffTriangleDown(v0, v1, v2);
-    }
-    // ƽ
-    /*              v0
-                    /\
-                   /  \
-                  /    \
-                 /      \
-                /        \
-            v2 ------------ v1
-    */
-    else if ((int)p1.y == (int)p2.y)
-    {
-        if (p2.x > p1.x)
-            swap(v1, v2);
-        if (tri_up_down_ == 0 || tri_up_down_ == 1) DiffTriangleUp(v0, v1, v2);
+        ClearMsaa();
+        for (int i = 0; i < count; ++i)
+        {
+            bindings[i].rasterize(this, bindings[i], kDepthPassShade, true);
+        }
+        ResolveMsaa(!frame_.translucent.empty());
     }
-    else
+    else if (frame_.depth_prepass)
     {
-        // ֵе
-        RendVertex m;
-        float k =  (p1.y - p0.y) / (p2.y - p0.y);
-        m.position = lerp(p0, p2, k);
-        if (diff_perspective)
+        // 1/zͬһɨߴֱӱȽȣԤȾҪɫ
+        double start = get_time_ms();
+        DiffTriangles<kDepthPassPrepass>(DepthOnlyShader(), 0, static_cast<int>(frame_.triangles.size()));
+        double mid = get_time_ms();
+        for (int i = 0; i < count; ++i)
         {
-            float div = lerp((1 / tri->v[0].position.w), (1 / tri->v[2].position.w), k);
-            m.position.w = 1.0f / div;
-            m.color = lerp((tri->v[0].color / tri->v[0].position.w), (tri->v[2].color / tri->v[2].position.w), k) / div;
-            m.uv = lerp((tri->v[0].uv / tri->v[0].position.w), (tri->v[2].uv / tri->v[2].position.w), k) / div;
-            m.normal = lerp((tri->v[0].normal / tri->v[0].position.w), (tri->v[2].normal / tri->v[2].position.w), k) / div;
-            m.global_pos = lerp((tri->v[0].global_pos / tri->v[0].position.w), (tri->v[2].global_pos / tri->v[2].position.w), k) / div;
+            bindings[i].rasterize(this, bindings[i], kDepthPassEqual, false);
         }
-        else
+        raster_stats_.prepass_ms = mid - start;
+        raster_stats_.shading_ms = get_time_ms() - mid;
+    }
+    else
+    {
+        double start = get_time_ms();
+        for (int i = 0; i < count; ++i)
         {
-            m.color = lerp(tri->v[0].color, tri->v[2].color, k);
-            m.uv = lerp(tri->v[0].uv, tri->v[2].uv, k);
-            m.normal = lerp(tri->v[0].normal, tri->v[2].normal, k);
-            m.global_pos = lerp(tri->v[0].global_pos, tri->v[2].global_pos, k);
+            bindings[i].rasterize(this, bindings[i], kDepthPassShade, false);
         }
+        raster_stats_.shading_ms = get_time_ms() - start;
+    }
 
-        // 
-        if (p1.x < m.position.x)
-        {
-            if (tri_up_down_ == 0 || tri_up_down_ == 1) DiffTriangleUp(v0, m, v1);
-            if (tri_up_down_ == 0 || tri_up_down_ == 2) DiffTriangleDown(v1, m, v2);
-        }
-        // ҵ
-        else
-        {
-            if (tri_up_down_ == 0 || tri_up_down_ == 1) DiffTriangleUp(v0, v1, m);
-            if (tri_up_down_ == 0 || tri_up_down_ == 2) DiffTriangleDown(m, v1, v2);
-        }
+    if (!frame_.translucent.empty())
+    {
+        RasterizeTranslucent();
     }
 }
 
-    /*              v0
-                    /\
-                   /  \
-                  /    \
-                 /      \
-                /        \
-            v2 ------------ v1
-    */
-void Renderer::DiffTriangleUp(const RendVertex &v0, const RendVertex &v1, const RendVertex &v2)
+void Renderer::RasterizeWireframe(void)
 {
-    float dy = v1.position.y - v0.position.y;
-    float dx_left = (v2.position.x - v0.position.x) / dy;
-    float dx_right = (v1.position.x - v0.position.x) / dy;
-
-    float done_over_z_left = (1.0f / v2.position.w - 1.0f / v0.position.w) / dy;
-    float done_over_z_right = (1.0f / v1.position.w - 1.0f / v0.position.w) / dy;
-
-    Vector4 dc_left = (v2.color - v0.color) / dy;
-    Vector4 dc_right = (v1.color - v0.color) / dy;
-
-    // ͸Ӳֵuv
-    Vector2 uv_over_z_top = v0.uv / v0.position.w;
-    Vector2 uv_over_z_left = v2.uv / v2.position.w;
-    Vector2 uv_over_z_right = v1.uv / v1.position.w;
-
-    Vector2 duv_over_z_left = (uv_over_z_left - uv_over_z_top) / dy;
-    Vector2 duv_over_z_right = (uv_over_z_right - uv_over_z_top) / dy;
-    
-    // ӳֵuv
-    Vector2 duv_left = (v2.uv - v0.uv) / dy;
-    Vector2 duv_right = (v1.uv - v0.uv) / dy;
+    int count = static_cast<int>(frame_.triangles.size());
+    wireframe_set_.Reset(count * 3);
+    for (int i = 0; i < count; ++i)
+    {
+        const Triangle &tri = frame_.triangles[i];
+        for (int k = 0; k < 3; ++k)
+        {
+            const RendVertex &a = frame_.vertices[tri.v[k]];
+            const RendVertex &b = frame_.vertices[tri.v[k == 2 ? 0 : k + 1]];
+            if (wireframe_set_.Insert(a.position, b.position))
+            {
+                DrawLine(a, b);
+            }
+        }
+    }
+    wireframe_edges_ = wireframe_set_.get_size();
+    wireframe_triangle_edges_ = count * 3;
 
-    // Էֵ߲
-    Vector3 dnormal_left = (v2.normal - v0.normal) / dy;
-    Vector3 dnormal_right = (v1.normal - v0.normal) / dy;
+    // ͸λڲ͸߿֮
+    const vector<TranslucentTriangle> &list = frame_.translucent;
+    for (int i = 0; i < list.size(); ++i)
+    {
+        const Triangle &tri = list[i].tri;
+        const RendVertex *vtx = &frame_.vertices[0];
+        DrawLine(vtx[tri.v[0]], vtx[tri.v[1]]);
+        DrawLine(vtx[tri.v[1]], vtx[tri.v[2]]);
+        DrawLine(vtx[tri.v[2]], vtx[tri.v[0]]);
+    }
+}
 
-    // ԭλֵ
-    Vector3 dpos_left = (v2.global_pos - v0.global_pos) / dy;
-    Vector3 dpos_right = (v1.global_pos - v0.global_pos) / dy;
-    
-    float x_begin = v0.position.x;
-    float x_end = v0.position.x;
-    float one_over_z_begin = 1.0f / v0.position.w;
-    float one_over_z_end = 1.0f / v0.position.w;
-    Vector4 color_begin = v0.color;
-    Vector4 color_end = v0.color;
-    Vector2 uv_over_z_begin = uv_over_z_top;
-    Vector2 uv_over_z_end = uv_over_z_top;
-    Vector2 uv_begin = v0.uv;
-    Vector2 uv_end = v0.uv;
-    Vector3 normal_begin = v0.normal;
-    Vector3 normal_end = v0.normal;
-    Vector3 pos_begin = v0.global_pos;
-    Vector3 pos_end = v0.global_pos;
-
-    int y = (int)v0.position.y;
-    if (y < 0)
-    {
-        float d = -v0.position.y;
-        x_begin += dx_left * d;
-        x_end += dx_right * d;
-        one_over_z_begin += done_over_z_left * d;
-        one_over_z_end += done_over_z_right * d;
-        color_begin += dc_left * d;
-        color_end += dc_right * d;
-        uv_over_z_begin += duv_over_z_left * d;
-        uv_over_z_end += duv_over_z_right * d;
-        uv_begin += duv_left * d;
-        uv_end += duv_right * d;
-        normal_begin += dnormal_left * d;
-        normal_end += dnormal_right * d;
-        pos_begin += dpos_left * d;
-        pos_end += dpos_right * d;
-        y = 0;
+void Renderer::ClearMsaa(void)
+{
+    int samples = frame_.msaa_samples;
+    int pixels = render_width_ * render_height_;
+    // ֱʽʱֻǰһ֣Ҳ·
+    if (msaa_allocated_ != samples || static_cast<int>(msaa_state_.size()) < pixels)
+    {
+        msaa_color_.resize(pixels * samples);
+        msaa_depth_.resize(pixels * samples);
+        msaa_state_.resize(pixels);
+        msaa_allocated_ = samples;
     }
-    
-    int bumpmap_width = 0;
-    int bumpmap_height = 0;
-    float s1 = v1.uv.u - v0.uv.u;
-    float s2 = v2.uv.u - v0.uv.u;
-    float t1 = v1.uv.v - v0.uv.v;
-    float t2 = v2.uv.v - v0.uv.v;
-    float div = s1 * t2 - s2 * t1;
-    Vector3 Q1 = v1.position.GetVector3() - v0.position.GetVector3();
-    Vector3 Q2 = v2.position.GetVector3() - v0.position.GetVector3();
-    Vector3 B = (s2 * Q1 - s1 * Q2) / div;
-    B.SetNormalize();
-    Vector3 T = (t2 * Q1 - t1 * Q2) / div;
-    T.SetNormalize();
-    if (bumpmap_ && shading_mode_ == kPhong)
-    {
-        bumpmap_width = bumpmap_->get_width();
-        bumpmap_height = bumpmap_->get_height();
-    }
-
-    // floor v1.position.y
-    for (; y < min_t((int)v1.position.y, height_); ++y)
-    {
-        int x = (int)x_begin;
-        float done_over_z = (one_over_z_begin - one_over_z_end) / (x_begin - x_end);
-        float one_over_z = one_over_z_begin;
-        Vector4 dc = (color_begin - color_end) / (x_begin - x_end);
-        Vector4 c = color_begin;
-        Vector2 duv_over_z = (uv_over_z_begin - uv_over_z_end) / (x_begin - x_end);
-        Vector2 uv_over_z = uv_over_z_begin;
-        Vector2 duv = (uv_begin - uv_end) / (x_begin - x_end);
-        Vector2 uv = uv_begin;
-        Vector3 dnormal = (normal_begin - normal_end) / (x_begin - x_end);
-        Vector3 normal = normal_begin;
-        Vector3 dpos = (pos_begin - pos_end) / (x_begin - x_end);
-        Vector3 pos = pos_begin;
-        if (x_begin < 0)
-        {
-            one_over_z += done_over_z * (-x_begin);
-            c += dc * (-x_begin);
-            uv_over_z += duv_over_z * (-x_begin);
-            uv += duv * (-x_begin);
-            normal += dnormal * (-x_begin);
-            pos += dpos * (-x_begin);
-            x = 0;
-        }
+    // ڵһдʱųʼ
+    memset(&msaa_state_[0], kMsaaCleared, pixels);
+}
 
-        // floor x_end
-        for (; x < min_t((int)(x_end), width_); ++x,
-                                              one_over_z += done_over_z,
-                                              c += dc,
-                                              uv += duv,
-                                              uv_over_z += duv_over_z,
-                                              normal += dnormal,
-                                              pos += dpos)
+void Renderer::ResolveMsaa(bool resolve_depth)
+{
+    int samples = frame_.msaa_samples;
+    int shift = samples == kMsaa8 ? 3 : 2;
+    for (int y = 0; y < render_height_; ++y)
+    {
+        int p = y * render_width_;
+        for (int x = 0; x < render_width_; ++x, ++p)
         {
-            // 1/z buffer 
-            float prev_one_over_z = get_one_over_z_buffer(x, y);
-            if (one_over_z < prev_one_over_z)
+            const uint32 *s = &msaa_color_[p * samples];
+            uint32 &dst = tile_color_[tile_index(x, y)];
+            if (msaa_state_[p] == kMsaaCleared)
+            {
+                dst = 0;
                 continue;
-            set_one_over_z_buffer(x, y, one_over_z);
-
-            if (shading_mode_ == kPhong)
+            }
+            if (resolve_depth)
             {
-                if (bumpmap_)
+                const float *depth = &msaa_depth_[p * samples];
+                float one_over_z = depth[0];
+                for (int i = 1; i < samples; ++i)
                 {
-                    int x = uv.x * (bumpmap_width - 3) + 1;
-                    int y = uv.y * (bumpmap_height - 3) + 1;
-//                    uint8 off_x = bumpmap_->GetDumpData(x + 1, y) - bumpmap_->GetDumpData(x - 1, y);
-//                    uint8 off_y = bumpmap_->GetDumpData(x, y + 1) - bumpmap_->GetDumpData(y, y - 1);
-//                    normal += (off_x / 255.0f) * B + (off_y / 255.0f) * T;
+                    one_over_z = max_t(one_over_z, depth[i]);
                 }
-                // Phongɫʱcÿ¼
-                c = Shading(pos, normal, *mat_, *light_);
+                set_one_over_z_buffer(x, y, one_over_z);
             }
-
-            Vector4 cvtex(1.0f, 1.0f, 1.0f, 1.0f);
-            if (texture_)
+            if (msaa_state_[p] == kMsaaCompressed)
             {
-                Vector2 uv_ = uv;
-                if (diff_perspective)
-                {
-                    uv_ = uv_over_z / one_over_z;
-                }
-                uv_.u = clamp(uv_.u, 0.0f, 1.0f);
-                uv_.v = clamp(uv_.v, 0.0f, 1.0f);
-                cvtex = texture_->GetDataUV(uv_.u, uv_.v);
+                dst = s[0];
+                continue;
             }
-            uint32 cl = vector4_to_ARGB32(clamp(c * cvtex, 0.0f, 1.0f));
-            set_pixel(x, y, cl);
+            // ͨһۼӣÿͨռ16λ8Ҳ
+            uint32 rb = 0;
+            uint32 ag = 0;
+            for (int i = 0; i < samples; ++i)
+            {
+                rb += s[i] & 0x00ff00ff;
+                ag += (s[i] >> 8) & 0x00ff00ff;
+            }
+            rb = (rb >> shift) & 0x00ff00ff;
+            ag = (ag >> shift) & 0x00ff00ff;
+            dst = (ag << 8) | rb;
         }
-        x_begin += dx_left;
-        x_end += dx_right;
-        one_over_z_begin += done_over_z_left;
-        one_over_z_end += done_over_z_right;
-        color_begin += dc_left;
-        color_end += dc_right;
-        uv_over_z_begin += duv_over_z_left;
-        uv_over_z_end += duv_over_z_right;
-        uv_begin += duv_left;
-        uv_end += duv_right;
-        normal_begin += dnormal_left;
-        normal_end += dnormal_right;
-        pos_begin += dpos_left;
-        pos_end += dpos_right;
     }
 }
 
-    /*       v0             v1
-             _____________
-             \           /
-              \         /
-               \       /
-                \     /
-                 \   /
-                  \ /  
-                  v2
-    */
-void Renderer::DiffTriangleDown(const RendVertex &v0, const RendVertex &v1, const RendVertex &v2)
+void Renderer::RasterizeTranslucent(void)
 {
-    float dy = v2.position.y - v0.position.y;
-    float dx_left = (v2.position.x - v0.position.x) / dy;
-    float dx_right = (v2.position.x - v1.position.x) / dy;
-    
-    float done_over_z_left = (1.0f / v2.position.w - 1.0f / v0.position.w) / dy;
-    float done_over_z_right = (1.0f / v2.position.w - 1.0f / v1.position.w) / dy;
-
-    Vector4 dc_left = (v2.color - v0.color) / dy;
-    Vector4 dc_right = (v2.color - v1.color) / dy;
-
-    // ͸Ӳֵuv
-    Vector2 uv_over_z_bottom = v2.uv / v2.position.w;
-    Vector2 uv_over_z_left = v0.uv / v0.position.w;
-    Vector2 uv_over_z_right = v1.uv / v1.position.w;
-
-    Vector2 duv_over_z_left = (uv_over_z_bottom - uv_over_z_left) / dy;
-    Vector2 duv_over_z_right = (uv_over_z_bottom - uv_over_z_right) / dy;
-
-    Vector2 duv_left = (v2.uv - v0.uv) / dy;
-    Vector2 duv_right = (v2.uv - v1.uv) / dy;
-
-    Vector3 dnormal_left = (v2.normal - v0.normal) / dy;
-    Vector3 dnormal_right = (v2.normal - v1.normal) / dy;
-
-    Vector3 dpos_left = (v2.global_pos - v0.global_pos) / dy;
-    Vector3 dpos_right = (v2.global_pos - v0.global_pos) / dy;
-
-    float x_begin = v0.position.x;
-    float x_end = v1.position.x;
-    float one_over_z_begin = 1.0f / v0.position.w;
-    float one_over_z_end = 1.0f / v1.position.w;
-    Vector4 color_begin = v0.color;
-    Vector4 color_end = v1.color;
-    Vector2 uv_over_z_begin = uv_over_z_left;
-    Vector2 uv_over_z_end = uv_over_z_right;
-    Vector2 uv_begin = v0.uv;
-    Vector2 uv_end = v1.uv;
-    Vector3 normal_begin = v0.normal;
-    Vector3 normal_end = v1.normal;
-    Vector3 pos_begin = v0.global_pos;
-    Vector3 pos_end = v1.global_pos;
-
-    int y = (int)v0.position.y;
-    if (y < 0)
-    {
-        float d = -v0.position.y;
-        x_begin += dx_left * d;
-        x_end += dx_right * d;
-        one_over_z_begin += done_over_z_left * d;
-        one_over_z_end += done_over_z_right * d;
-        color_begin += dc_left * d;
-        color_end += dc_right * d;
-        uv_over_z_begin += duv_over_z_left * d;
-        uv_over_z_end += duv_over_z_right * d;
-        uv_begin += duv_left * d;
-        uv_end += duv_right * d;
-        normal_begin += dnormal_left * d;
-        normal_end += dnormal_right * d;
-        pos_begin += dpos_left *d;
-        pos_end += dpos_right *d;
-        y = 0;
-    }
-
-    int bumpmap_width = 0;
-    int bumpmap_height = 0;
-    if (bumpmap_)
-    {
-        bumpmap_width = bumpmap_->get_width();
-        bumpmap_height = bumpmap_->get_height();
-    }
-
-    for (; y < min_t((int)v2.position.y, height_); ++y)
-    {
-        int x = (int)x_begin;
-        float done_over_z = (one_over_z_begin - one_over_z_end) / (x_begin - x_end);
-        float one_over_z = one_over_z_begin;
-        Vector4 dc = (color_begin - color_end) / (x_begin - x_end);
-        Vector4 c = color_begin;
-        Vector2 duv_over_z = (uv_over_z_begin - uv_over_z_end) / (x_begin - x_end);
-        Vector2 uv_over_z = uv_over_z_begin;
-        Vector2 duv = (uv_begin - uv_end) / (x_begin - x_end);
-        Vector2 uv = uv_begin;
-        Vector3 dnormal = (normal_begin - normal_end) / (x_begin - x_end);
-        Vector3 normal = normal_begin;
-        Vector3 dpos = (pos_begin - pos_end) / (x_begin - x_end);
-        Vector3 pos = pos_begin;
-        if (x_begin < 0)
-        {
-            one_over_z += done_over_z * (-x_begin);
-            c += dc * (-x_begin);
-            uv_over_z += duv_over_z * (-x_begin);
-            uv += duv * (-x_begin);
-            normal += dnormal * (-x_begin);
-            pos += dpos * (-x_begin);
-            x = 0;
-        }
-        for (; x < min_t((int)(x_end), width_); ++x,
-                                              one_over_z += done_over_z,
-                                              c += dc,
-                                              uv_over_z += duv_over_z,
-                                              uv += duv,
-                                              normal += dnormal,
-                                              pos += dpos)
-        {
-            float prev_one_over_z = get_one_over_z_buffer(x, y);
-            if (one_over_z < prev_one_over_z)
-                continue;
-            set_one_over_z_buffer(x, y, one_over_z);
+    const vector<TranslucentTriangle> &list = frame_.translucent;
+    const RendVertex *vtx = &frame_.vertices[0];
+    int count = static_cast<int>(list.size());
 
-            if (shading_mode_ == kPhong)
-            {
-                if (bumpmap_)
-                {
-//                    int x = uv.x * (bumpmap_width - 3) + 1;
-//                    int y = uv.y * (bumpmap_height - 3) + 1;
-//                    uint8 off_x = bumpmap_->GetDumpData(x + 1, y) - bumpmap_->GetDumpData(x - 1, y);
-//                    uint8 off_y = bumpmap_->GetDumpData(x, y + 1) - bumpmap_->GetDumpData(y, y - 1);
-//                    normal.x += (off_x / 255.0f);
-//                    normal.y += (off_y / 255.0f);
-                }
+    // Զһٰ˳ֵ飬Ȼͬʱύ˳
+    translucent_order_.resize(count);
+    for (int i = 0; i < count; ++i)
+    {
+        translucent_order_[i] = i;
+    }
+    std::stable_sort(translucent_order_.begin(), translucent_order_.end(), [&list](int a, int b)
+    {
+        return list[a].depth > list[b].depth;
+    });
 
-                c = Shading(pos, normal, *mat_, *light_);
+    int tiles_x = (render_width_ + kTranslucentTileSize - 1) / kTranslucentTileSize;
+    int tiles_y = (render_height_ + kTranslucentTileSize - 1) / kTranslucentTileSize;
+    translucent_tiles_.resize(tiles_x * tiles_y);
+    for (int i = 0; i < tiles_x * tiles_y; ++i)
+    {
+        translucent_tiles_[i].clear();
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        int index = translucent_order_[i];
+        const Triangle &tri = list[index].tri;
+        const Vector4 &p0 = vtx[tri.v[0]].position;
+        const Vector4 &p1 = vtx[tri.v[1]].position;
+        const Vector4 &p2 = vtx[tri.v[2]].position;
+        float min_x = min_t(p0.x, min_t(p1.x, p2.x));
+        float max_x = max_t(p0.x, max_t(p1.x, p2.x));
+        float min_y = min_t(p0.y, min_t(p1.y, p2.y));
+        float max_y = max_t(p0.y, max_t(p1.y, p2.y));
+        if (max_x < 0.0f || max_y < 0.0f || min_x >= render_width_ || min_y >= render_height_)
+            continue;
+        int tx0 = max_t(static_cast<int>(min_x), 0) / kTranslucentTileSize;
+        int tx1 = min_t(static_cast<int>(max_x), render_width_ - 1) / kTranslucentTileSize;
+        int ty0 = max_t(static_cast<int>(min_y), 0) / kTranslucentTileSize;
+        int ty1 = min_t(static_cast<int>(max_y), render_height_ - 1) / kTranslucentTileSize;
+        for (int ty = ty0; ty <= ty1; ++ty)
+        {
+            for (int tx = tx0; tx <= tx1; ++tx)
+            {
+                translucent_tiles_[ty * tiles_x + tx].push_back(index);
             }
-            Vector4 cvtex(1.0f, 1.0f, 1.0f, 1.0f);
-            if (texture_)
+        }
+    }
+
+    // һڵĶ͸дͬһƬɫȣڻ
+    blend_row_.resize(kTranslucentTileSize);
+    for (int ty = 0; ty < tiles_y; ++ty)
+    {
+        for (int tx = 0; tx < tiles_x; ++tx)
+        {
+            const vector<int> &tile = translucent_tiles_[ty * tiles_x + tx];
+            int min_x = tx * kTranslucentTileSize;
+            int min_y = ty * kTranslucentTileSize;
+            int max_x = min_t(min_x + kTranslucentTileSize, render_width_) - 1;
+            int max_y = min_t(min_y + kTranslucentTileSize, render_height_) - 1;
+            for (int i = 0; i < tile.size(); ++i)
             {
-                Vector2 uv_ = uv;
-                if (diff_perspective)
-                {
-                    uv_ = uv_over_z / one_over_z;
-                }
-                uv_.u = clamp(uv_.u, 0.0f, 1.0f);
-                uv_.v = clamp(uv_.v, 0.0f, 1.0f);
-                cvtex = texture_->GetDataUV(uv_.u, uv_.v);
+                const TranslucentTriangle &translucent = list[tile[i]];
+                const PixelShaderBinding &binding = frame_.bindings[translucent.shader];
+                binding.blend(this, binding, translucent, min_x, min_y, max_x, max_y);
             }
-            uint32 cl = vector4_to_ARGB32(clamp(c * cvtex, 0.0f, 1.0f));
-            set_pixel(x, y, cl);
         }
-        x_begin += dx_left;
-        x_end += dx_right;
-        one_over_z_begin += done_over_z_left;
-        one_over_z_end += done_over_z_right;
-        color_begin += dc_left;
-        color_end += dc_right;
-        uv_over_z_begin += duv_over_z_left;
-        uv_over_z_end += duv_over_z_right;
-        uv_begin += duv_left;
-        uv_end += duv_right;
-        normal_begin += dnormal_left;
-        normal_end += dnormal_right;
-        pos_begin += dpos_left;
-        pos_end += dpos_right;
     }
 }
 
@@ -1200,11 +1576,8 @@ void Renderer::DisplayTriangle(void)
         for (int j = 0; j < 3; ++j)
         {
             memset(text_buf, 0, sizeof(text_buf));
-            sprintf(text_buf, "x:%8.3f y:%8.3f z:%8.3f w:%8.3f",
-                    triangles_[i].v[j].position.x,
-                    triangles_[i].v[j].position.y,
-                    triangles_[i].v[j].position.z,
-                    triangles_[i].v[j].position.w);
+            const Vector4 &p = vertices_[triangles_[i].v[j]].position;
+            sprintf(text_buf, "x:%8.3f y:%8.3f z:%8.3f w:%8.3f", p.x, p.y, p.z, p.w);
             DrawScreenText(10, 15 * (i * 4 + (j + 1)), text_buf);
         }
     }
@@ -1243,6 +1616,43 @@ void Renderer::DisplayStatus(void)
     if (backface_culling_)
         DrawScreenText(x, line_gap * ++line, "޳");
 
+    if (get_pipelined())
+        DrawScreenText(x, line_gap * ++line, "ˮ");
+
+    if (post_process_settings_.fxaa)
+        DrawScreenText(x, line_gap * ++line, "FXAA");
+
+    if (post_process_settings_.tone_mapping)
+        DrawScreenText(x, line_gap * ++line, "ɫӳ");
+
+    if (shadow_size_ > 0)
+    {
+        char shadow[32] = {0};
+        int pcf = get_shadow_pcf();
+        sprintf(shadow, "Ӱ PCF %dx%d", pcf, pcf);
+        DrawScreenText(x, line_gap * ++line, shadow);
+    }
+
+    if (msaa_samples_ > 1)
+    {
+        char msaa[16] = {0};
+        sprintf(msaa, "MSAA %dx", msaa_samples_);
+        DrawScreenText(x, line_gap * ++line, msaa);
+    }
+    else if (depth_prepass_)
+    {
+        char prepass[64] = {0};
+        sprintf(prepass, "ԤȾ ɫ %d/%d", last_raster_stats_.shaded_pixels, last_raster_stats_.prepass_pixels);
+        DrawScreenText(x, line_gap * ++line, prepass);
+    }
+
+    if (dynamic_resolution_)
+    {
+        char resolution[64] = {0};
+        sprintf(resolution, "ֱ̬ %d%% %.1fms", static_cast<int>(resolution_scale_ * 100.0f + 0.5f), last_raster_stats_.raster_ms);
+        DrawScreenText(x, line_gap * ++line, resolution);
+    }
+
     switch(tri_up_down_)
     {
     case 0:
@@ -1257,33 +1667,44 @@ void Renderer::DisplayStatus(void)
     default:
         break;
     }
-}
 
-void Renderer::FlushText(void)
-{
-    if (text_string_.empty())
-        return;
+    char buf[64] = {0};
+    sprintf(buf, " %d", static_cast<int>(triangles_.size()));
+    DrawScreenText(x, line_gap * ++line, buf);
 
-    HDC hdc;
-    HRESULT res = d3d_backbuffer_->GetDC(&hdc);
-    if (FAILED(res))
+    if (!translucent_.empty())
     {
-        Logger::GtLogError("d3d9 GetDC failed: %d", GetLastError());
-        return;
+        sprintf(buf, "͸ %d", static_cast<int>(translucent_.size()));
+        DrawScreenText(x, line_gap * ++line, buf);
     }
-    SelectObject(hdc, font_);
-    SetBkMode(hdc, TRANSPARENT);
-    SetTextColor(hdc, text_color_);
-    for (int i = 0; i < text_string_.size(); ++i)
-    {
-        RECT rect;
-        rect.left = text_pos_[i].x;
-        rect.right = text_string_[i].size() * 10 + rect.left;
-        rect.top = text_pos_[i].y;
-        rect.bottom = rect.top + 20;
-        DrawText(hdc, text_string_[i].c_str(), text_string_[i].length(), &rect, DT_LEFT);
-    }
-    text_pos_.clear();
-    text_string_.clear();
-    d3d_backbuffer_->ReleaseDC(hdc);
+
+    // ʱҪEndFrameɣʾִеĻ
+    if (draw_sorting_)
+    {
+        sprintf(buf, " %d", static_cast<int>(draw_list_.size()));
+        DrawScreenText(x, line_gap * ++line, buf);
+    }
+
+    if (shading_rate_ != kShadingRate1x1)
+    {
+        static const char *kRateName[kShadingRateCount] = {"1x1", "2x2", "4x4", "Ӧ"};
+        sprintf(buf, "ɫƵ %s  %d/%d", kRateName[shading_rate_],
+                last_raster_stats_.lighting_samples, last_raster_stats_.shaded_pixels);
+        DrawScreenText(x, line_gap * ++line, buf);
+    }
+
+    if (occlusion_culling_)
+    {
+        int percent = stats_.occlusion_tested > 0 ? 100 * stats_.occlusion_culled / stats_.occlusion_tested : 0;
+        sprintf(buf, "ڵ޳ %d/%d (%d%%)", stats_.occlusion_culled, stats_.occlusion_tested, percent);
+        DrawScreenText(x, line_gap * ++line, buf);
+        sprintf(buf, "ʡ %.2fms", stats_.GetOcclusionSavedMs());
+        DrawScreenText(x, line_gap * ++line, buf);
+    }
+}
+
+void Renderer::FlushText(void)
+{
+    text_renderer_.Blit(frame_.text, buffer_, width_, height_, pitch_);
+    frame_.text.clear();
 }
\ No newline at end of file
@@ -7,9 +7,18 @@
 #include "mathdef.h"
 #include "matrix.h"
 #include "Primitive.h"
+#include "Occlusion.h"
+#include "Light.h"
+#include "PostProcess.h"
+#include "ShadowMap.h"
+#include "NormalMap.h"
+#include "Shader.h"
+#include "TextRenderer.h"
+#include "EdgeSet.h"
 
 class Camera;
 class Light;
+class Renderer;
 
 enum MatrixType
 {
@@ -27,25 +36,271 @@ enum ShadingMode
     kShadingModeCount = 5
 };
 
+enum MsaaSamples
+{
+    kMsaa4 = 4,
+    kMsaa8 = 8
+};
+
+// ɫϷʽaΪԴɫalpha
+enum BlendMode
+{
+    kBlendOpaque = 0,
+    // src * a + dst * (1 - a)
+    kBlendAlpha = 1,
+    // src * a + dst
+    kBlendAdditive = 2,
+    // src + dst * (1 - a)ԴɫԤalpha
+    kBlendPremultiplied = 3,
+    kBlendModeCount = 4
+};
+
+// ɨߵȲԷʽ
+enum DepthPass
+{
+    // 1/zСڻʱͨд1/zɫ
+    kDepthPassShade = 0,
+    // ԤȾֻд1/zֵҲɫ
+    kDepthPassPrepass = 1,
+    // ԤȾ֮1/z뻺Ȳɫд1/z
+    kDepthPassEqual = 2
+};
+
 class Texture2D;
 
+// ʵľڴǰ
+// model_viewnormalֻҪʱ
+class InstanceMatrix
+{
+public:
+    Matrix44 model_view_proj;
+    Matrix44 model_view;
+    Matrix33 normal;
+};
+
+// DrawPrimitiveֻ¼бEndFrameʱδ
+class DrawCommand
+{
+public:
+    Primitive *primitive;
+    Matrix44 world;
+    // ¼ʱĻ״̬EndFrameִʱָ
+    Texture2D *texture;
+    const NormalMap *normal_map;
+    ShadingMode shading_mode;
+    BlendMode blend;
+    ShadingRate shading_rate;
+    // ΧڽԶƽ֮ȷֶΣԽСԽ
+    uint32 depth;
+};
+
+// ͸Σڲ͸֮ȵдȣԶ
+class TranslucentTriangle
+{
+public:
+    Triangle tri;
+    BlendMode blend;
+    // õȣwƽֵԽԽԶ
+    float depth;
+    // ƵɫFrameState::bindingsе±
+    int shader;
+};
+
+// һλƵɫƵϣդʱԭ͵ãRenderer::DrawPrimitive
+// ָ붼ָɫʵģ壬դѭȻȫ
+class PixelShaderBinding
+{
+public:
+    void *shader;
+    void (*destroy)(void *shader);
+    // դʼʱһΣPhongɫȡñ֡Ӱ
+    void (*bind)(Renderer *renderer, void *shader);
+    // ɨ豾λƵĲ͸Σmsaaʱdepth
+    void (*rasterize)(Renderer *renderer, const PixelShaderBinding &binding, DepthPass depth, bool msaa);
+    void (*blend)(Renderer *renderer, const PixelShaderBinding &binding, const TranslucentTriangle &translucent,
+                  int min_x, int min_y, int max_x, int max_y);
+    // λƵĲ͸trianglesеķΧ[first, last)
+    int first;
+    int last;
+};
+
+// դһ֡ȫ״̬EndFrameʱRendererȡ
+// ˮģʽ¹դֻ߳ݿգ߳̿Լ޸ƹ⡢ɫģʽ
+class FrameState
+{
+public:
+    FrameState(void)
+        :shading_mode(kFrame)
+        ,diff_perspective(false)
+        ,tri_up_down(0)
+        ,render_width(0)
+        ,render_height(0)
+        ,msaa_samples(1)
+        ,depth_prepass(false)
+        ,shadow(nullptr)
+        ,view_scale_x(0.0f)
+        ,view_scale_y(0.0f) {}
+
+    // õĶ㣬դʼʱͳһӿڱ任
+    std::vector<RendVertex> vertices;
+    std::vector<Triangle> triangles;
+    std::vector<TranslucentTriangle> translucent;
+    // ÿλƵɫύ˳򣬸ǵηΧβ
+    std::vector<PixelShaderBinding> bindings;
+    std::vector<GlyphQuad> text;
+    // ӰͶڹԴüռеĶΣդʼʱȻshadow
+    std::vector<RendVertex> shadow_vertices;
+    std::vector<Triangle> shadow_triangles;
+    ShadingMode shading_mode;
+    bool diff_perspective;
+    int tri_up_down;
+    // դķֱʣ󻺳壬Ŵ󵽺󻺳
+    int render_width;
+    int render_height;
+    int msaa_samples;
+    bool depth_prepass;
+    PostProcessSettings post_process;
+    ShadowMap *shadow;
+    // ռ䵽Դüռ
+    Matrix44 camera_to_light;
+    // Ļwԭռxy
+    float view_scale_x;
+    float view_scale_y;
+};
+
+// ÿ֡ͳƣBeginFrameʱ
+class RenderStats
+{
+public:
+    RenderStats(void)
+    {
+        Reset();
+    }
+
+    void Reset(void)
+    {
+        occlusion_tested = 0;
+        occlusion_culled = 0;
+        occlusion_ms = 0.0;
+        geometry_instances = 0;
+        geometry_ms = 0.0;
+        clip_triangles = 0;
+        clip_output = 0;
+        clip_ms = 0.0;
+        sorted_draws = 0;
+        sort_ms = 0.0;
+    }
+
+    // δ޳ʵƽκʱ㱻޳ʵʡʱ
+    double GetOcclusionSavedMs(void) const
+    {
+        if (geometry_instances == 0)
+            return 0.0;
+        return occlusion_culled * geometry_ms / geometry_instances - occlusion_ms;
+    }
+
+    int occlusion_tested;
+    int occlusion_culled;
+    // ڵդΧвԵĺʱ
+    double occlusion_ms;
+    int geometry_instances;
+    // 任աüͶӰĺʱ
+    double geometry_ms;
+    // ׶ƽ桢Ҫƽüüʱ
+    int clip_triangles;
+    int clip_output;
+    double clip_ms;
+    // беʵ¼ʱEndFrameʱĺʱ
+    int sorted_draws;
+    double sort_ms;
+};
+
+// դ׶εͳƣÿ֡դʼʱ
+// ֻͳƲ͸εɨߣMSAAͰ͸
+class RasterStats
+{
+public:
+    RasterStats(void)
+    {
+        Reset();
+    }
+
+    void Reset(void)
+    {
+        shaded_pixels = 0;
+        prepass_pixels = 0;
+        prepass_ms = 0.0;
+        shading_ms = 0.0;
+        raster_ms = 0.0;
+        shadow_pixels = 0;
+        shadow_ms = 0.0;
+        lighting_samples = 0;
+        for (int i = 0; i < 3; ++i)
+        {
+            rate_triangles[i] = 0;
+        }
+    }
+
+    // ԤȾͨȲԵؾǲԤȾʱҪɫ
+    int GetSkippedPixels(void) const
+    {
+        return prepass_pixels > 0 ? prepass_pixels - shaded_pixels : 0;
+    }
+
+    // ɫĴ
+    int shaded_pixels;
+    // ԤȾͨȲԵ
+    int prepass_pixels;
+    double prepass_ms;
+    // ɫһɨߵĺʱ
+    double shading_ms;
+    // շֿ黺浽դĺʱֱ̬ʰ
+    double raster_ms;
+    // ӰͼͨȲԵադResolveĺʱraster_ms
+    int shadow_pixels;
+    double shadow_ms;
+    // յĴɫʱshaded_pixels
+    int lighting_samples;
+    // 1x12x24x4ɫֻͳPhong
+    int rate_triangles[3];
+};
+
 class Renderer
 {
 public:
+    // դʱɫ1/zkTileSize x kTileSizeֿ飬ÿţڰ
+    static const int kTileShift = 6;
+    static const int kTileSize = 1 << kTileShift;
+
     Renderer(void);
     ~Renderer(void);
     void Initialize(HWND hwnd, int width, int height);
+    // 豸Ⱦڲɫ棬Ⱦʹ
+    void InitializeOffscreen(int width, int height);
     void Uninitialize(void);
 
+    bool IsOffscreen(void)
+    {
+        return color_buffer_ != nullptr;
+    }
+
+    // ģʽEndFrame֮Ⱦÿpitchֽ
+    const uint32 *get_color_buffer(void)
+    {
+        return color_buffer_;
+    }
+
+    int get_pitch(void)
+    {
+        return pitch_;
+    }
+
     Texture2D CreateTexture2D(void);
+    // ʱ֮ǰ֡ύĻڹդʱҪTexture2DʱŽ
     void set_texture(Texture2D *texture)
     {
-        if (texture_ && texture_->IsLocked())
-        {
-            texture_->UnLock();
-        }
         texture_ = texture;
-        if (!texture_->IsLocked())
+        if (texture_ && !texture_->IsLocked())
         {
             texture_->Lock();
         }
@@ -56,34 +311,28 @@ public:
         return texture_;
     }
 
-    void set_bumpmap(Texture2D *bumpmap)
+    // ͼɵڼʱӸ߶ͼɣֻPhongɫʹߵЧ
+    void set_normal_map(const NormalMap *normal_map)
     {
-        if (bumpmap_ && bumpmap_->IsLoaded())
-        {
-            bumpmap_->UnLock();
-        }
-        bumpmap_ = bumpmap;
-        if (!bumpmap_->IsLocked())
-        {
-            bumpmap_->Lock();
-        }
+        normal_map_ = normal_map;
     }
 
-    Texture2D *get_bumpmap(void)
+    const NormalMap *get_normal_map(void) const
     {
-        return bumpmap_;
+        return normal_map_;
     }
 
-    void DrawLine(RendVertex v0, RendVertex v1);
+    // üBresenhamߣ˶ֵɫ1/z
+    void DrawLine(const RendVertex &v0, const RendVertex &v1);
 
+    // дֿɫ棬EndFrameʱ󻺳
     void set_pixel(int x, int y, uint32 c)
     {
-        int idx = y * (pitch_ / 4) + x;
-//        Logger::GtLogInfo("idx %d", idx);
-        buffer_[idx] = c;
+        tile_color_[tile_index(x, y)] = c;
     }
 
 
+    // colorΪCOLORREFGDISetTextColorͬ
     void set_text_color(uint32 color)
     {
         text_color_ = color;
@@ -91,39 +340,122 @@ public:
 
     void DrawScreenText(Point pos, string text)
     {
-        text_pos_.push_back(pos);
-        text_string_.push_back(text);
+        DrawScreenText(pos.x, pos.y, text);
     }
 
     void DrawScreenText(int x, int y, string text)
     {
-        text_pos_.push_back(Point(x, y));
-        text_string_.push_back(text);
+        uint32 argb = 0xff000000 | (GetRValue(text_color_) << 16) | (GetGValue(text_color_) << 8) | GetBValue(text_color_);
+        text_renderer_.Layout(x, y, text.c_str(), argb, &text_quads_);
+    }
+
+    // argbalpha͸뱳
+    void DrawScreenText(int x, int y, const char *text, uint32 argb)
+    {
+        text_renderer_.Layout(x, y, text, argb, &text_quads_);
     }
 
     void BeginFrame(void);
 
     void EndFrame(void);
 
+    // ˮģʽEndFrameֻύգɹդ߳ɹդPresent
+    // ߳漴ʼһ֡ļδ¸ߵһ֡ӳ١ģʽ֧
+    void set_pipelined(bool flag);
+
+    bool get_pipelined(void)
+    {
+        return raster_thread_ != NULL;
+    }
+
     void set_camera(Camera *camera)
     {
         camera_ = camera;
     }
 
+    Camera *get_camera(void)
+    {
+        return camera_;
+    }
+
+    int get_width(void)
+    {
+        return width_;
+    }
+
+    int get_height(void)
+    {
+        return height_;
+    }
+
     void set_light(Light *light)
     {
         light_ = light;
     }
 
+    Light *get_light(void)
+    {
+        return light_;
+    }
+
     void set_backface_culling(bool flag)
     {
         backface_culling_ = flag;
     }
 
+    // ѱֻ֡Ͻbuffer_դͺ֮
     void FlushText(void);
 
     // 
     void DrawPrimitive(Primitive *primitive);
+    void DrawPrimitive(Primitive *primitive, const Matrix44 &world);
+    // 任λͬһͼԪݡʺֻȡһ
+    void DrawPrimitiveInstanced(Primitive *primitive, const Matrix44 *transforms, int count);
+    // õߵɫƣɫģʽɫĽӿڼShader.h
+    // ɫһݱ浽դδб
+    template <class VertexShader, class PixelShader>
+    void DrawPrimitive(Primitive *primitive, const Matrix44 &world, const VertexShader &vs, const PixelShader &ps)
+    {
+        ExecuteDraw(primitive, &world, 1, vs, ps);
+    }
+
+    template <class VertexShader, class PixelShader>
+    void DrawPrimitiveInstanced(Primitive *primitive, const Matrix44 *transforms, int count,
+                                const VertexShader &vs, const PixelShader &ps)
+    {
+        ExecuteDraw(primitive, transforms, count, vs, ps);
+    }
+
+    // ȽбEndFrameʱ͸ӽԶͬȶڰͲִ
+    // ͼԪ뱣ЧEndFrameڵӰͶõɫĻȻִУ
+    void set_draw_sorting(bool flag)
+    {
+        draw_sorting_ = flag;
+    }
+
+    bool get_draw_sorting(void)
+    {
+        return draw_sorting_;
+    }
+
+    // DrawPrimitiveڶ㴦֮ǰڵͼԪΧ
+    void set_occlusion_culling(bool flag)
+    {
+        occlusion_culling_ = flag;
+    }
+
+    bool get_occlusion_culling(void)
+    {
+        return occlusion_culling_;
+    }
+
+    // ڵдڵ棬ڱڵ֮ǰãᱻ
+    void DrawOccluder(Primitive *primitive, const Matrix44 &world);
+
+    const RenderStats &get_stats(void)
+    {
+        return stats_;
+    }
 
     void switch_diff_perspective(void)
     {
@@ -141,6 +473,132 @@ public:
         shading_mode_ = mode;
     }
 
+    ShadingMode get_shading_mode(void)
+    {
+        return shading_mode_;
+    }
+
+    // زݣsamplesȡ1رգ48ֻģʽ
+    void set_msaa(int samples)
+    {
+        assert(samples == 1 || samples == kMsaa4 || samples == kMsaa8);
+        msaa_samples_ = samples;
+    }
+
+    int get_msaa(void)
+    {
+        return msaa_samples_;
+    }
+
+    // ԤȾֻд1/zٶ1/zȵɫÿֻɫһ
+    // ɫԽصԽԽ㣬ز߿ģʽ²Ч
+    void set_depth_prepass(bool flag)
+    {
+        depth_prepass_ = flag;
+    }
+
+    bool get_depth_prepass(void)
+    {
+        return depth_prepass_;
+    }
+
+    // ֱ̬ʣһ֡Ĺդʱڲֱʣʹʱӽbudget_ms˫ԷŴ󵽺󻺳
+    // min_scaleΪűޣ԰󻺳ķֱʻ
+    void set_dynamic_resolution(bool flag, float budget_ms = 8.0f, float min_scale = 0.5f);
+
+    bool get_dynamic_resolution(void)
+    {
+        return dynamic_resolution_;
+    }
+
+    // ύһ֡ڲֱ󻺳֮
+    float get_resolution_scale(void)
+    {
+        return resolution_reset_ ? 1.0f : resolution_scale_;
+    }
+
+    // һ֡դ׶εͳƣˮģʽEndFrameʱѾһ֡
+    const RasterStats &get_raster_stats(void)
+    {
+        return last_raster_stats_;
+    }
+
+    // һ֡߿ģʽʵʻıȥغεı
+    int get_wireframe_edges(void)
+    {
+        return wireframe_edges_;
+    }
+
+    int get_wireframe_triangle_edges(void)
+    {
+        return wireframe_triangle_edges_;
+    }
+
+    // ֮ƵͼԪĻϷʽkBlendOpaqueν͸
+    // alphaȡɫalphaйʱȡalphaalpha
+    void set_blend_mode(BlendMode mode)
+    {
+        blend_mode_ = mode;
+    }
+
+    BlendMode get_blend_mode(void)
+    {
+        return blend_mode_;
+    }
+
+    // ֮ƵͼԪPhongռƵʣμ¼
+    void set_shading_rate(ShadingRate rate)
+    {
+        shading_rate_ = rate;
+    }
+
+    ShadingRate get_shading_rate(void)
+    {
+        return shading_rate_;
+    }
+
+    // դ֮󡢻֮ǰ֡ĺ
+    void set_post_process(const PostProcessSettings &settings)
+    {
+        post_process_settings_ = settings;
+    }
+
+    const PostProcessSettings &get_post_process(void)
+    {
+        return post_process_settings_;
+    }
+
+    // ӰӵƹλÿtargetȾsize x sizeͼfovΪǶ
+    // ֻPhongɫ²
+    void EnableShadow(int size, const Vector3 &target, float fov, float z_near, float z_far);
+    void DisableShadow(void);
+
+    bool get_shadow(void)
+    {
+        return shadow_size_ > 0;
+    }
+
+    // 1Ϊ㣬2Ϊ2x23Ϊ3x3
+    void set_shadow_pcf(int taps)
+    {
+        shadow_maps_[0].set_pcf(taps);
+        shadow_maps_[1].set_pcf(taps);
+    }
+
+    int get_shadow_pcf(void)
+    {
+        return shadow_maps_[0].get_pcf();
+    }
+
+    // ͶӰڹԴӽ±任ü£դʼʱȻ֡ͼBeginFrame֮
+    void DrawShadowCaster(Primitive *primitive, const Matrix44 &world);
+
+    // ߳1ʾڹդ߳ϴ
+    void set_post_process_threads(int count)
+    {
+        post_process_.set_thread_count(count);
+    }
+
     IDirect3DDevice9 *get_device(void)
     {
         return d3d_device_;
@@ -150,30 +608,124 @@ public:
     void DisplayTriangle(void);
     void DisplayStatus(void);
 private:
+    int tile_index(int x, int y) const
+    {
+        return (((y >> kTileShift) * tiles_x_ + (x >> kTileShift)) << (2 * kTileShift))
+             + ((y & (kTileSize - 1)) << kTileShift) + (x & (kTileSize - 1));
+    }
+
     void set_one_over_z_buffer(int x, int y, float v)
     {
-        one_over_z_buffer_[y * width_ + x] = v;
+        one_over_z_buffer_[tile_index(x, y)] = v;
     }
 
     float get_one_over_z_buffer(int x, int y)
     {
-        return one_over_z_buffer_[y * width_ + x];
+        return one_over_z_buffer_[tile_index(x, y)];
+    }
+    // ɫģʽ챾λƵɫδ
+    void ExecuteDraw(Primitive *primitive, const Matrix44 *transforms, int count);
+    // 任ɫͲüɫͱλƲηΧ
+    template <class VertexShader, class PixelShader>
+    void ExecuteDraw(Primitive *primitive, const Matrix44 *transforms, int count,
+                     const VertexShader &vs, const PixelShader &ps);
+    // δڵ޳ʵľ󣬷ʵ
+    int PrepareInstances(Primitive *primitive, const Matrix44 *transforms, int count, bool lit);
+    // ͷѾդɫ
+    static void ReleaseBindings(std::vector<PixelShaderBinding> *bindings);
+    template <class PixelShader>
+    static void DestroyShader(void *shader);
+    template <class PixelShader>
+    static void BindShader(Renderer *renderer, void *shader);
+    template <class PixelShader>
+    static void RasterizeBinding(Renderer *renderer, const PixelShaderBinding &binding, DepthPass depth, bool msaa);
+    template <class PixelShader>
+    static void BlendBinding(Renderer *renderer, const PixelShaderBinding &binding, const TranslucentTriangle &translucent,
+                             int min_x, int min_y, int max_x, int max_y);
+    // ִлбڵͬһͼԪϲһʵ
+    void FlushDrawList(void);
+    // ıդķֱʣֿ黺ֻڳѷĴСʱ·
+    void SetRenderSize(int width, int height);
+    // ѷֿɫ水пbuffer_ֱʲͬʱ˫ԷŴ
+    void ResolveTiles(void);
+    void UpscaleTiles(void);
+    // TakeFrameStateʱӳһ֡դʱű̶ֻ߳д
+    void UpdateResolutionScale(double raster_ms);
+    // ͼԪuvɫȡrend_primitive_ÿλһΣʵ
+    void FetchVertices(const Primitive *primitive);
+    // instance_matrices_еÿʵ任ɫͲüɫɵÿλƹһ
+    // litʱռλáߺߣbindingΪλƵɫ±
+    template <class VertexShader>
+    void ProcessInstances(const Primitive *primitive, const VertexShader &shader, bool lit, int binding);
+    // rend_primitive_еÿεöɫ
+    template <class VertexShader>
+    void ShadeVertices(const VertexShader &shader);
+    // ռһα任βüռ䣬ͬʱÿoutcode
+    // litʱռλô浽global_pos任ߺ
+    void TransformVertices(const Primitive *primitive, const InstanceMatrix &matrix, bool lit);
+
+    // outcode޳ΣƽγClipTriangle
+    // rend_primitive_׷ӵvertices_ֻ±꣬ÿʵ׷һ
+    void Clipping(void);
+    // Sutherland-HodgmanƽüfirstΪ׶vertices_е±꣬planesΪҪüƽ
+    // ֻ׷ӲüɵĽ㣬β
+    void ClipTriangle(uint32 first, uint32 planes);
+    uint32 PushVertex(const RendVertex &vertex)
+    {
+        vertices_.push_back(vertex);
+        return static_cast<uint32>(vertices_.size() - 1);
     }
-    // TODO 
-    void Lighting(void);
-    // TODO 任ͼռ *
-    void ModelViewTransform(const Matrix44 &model_view);
-    // TODO ͸ͶӰ *
-    void Projection(const Matrix44 &perspective);
 
-    // TODO ü *
-    void Clipping(float z_far, float z_near);
+    // ѵǰ֡Ĺդ״̬תƵframe_
+    void TakeFrameState(void);
+    // ȡ󻺳塢դ֡Presentֻframe_
+    void RasterizeFrame(void);
+    // ԤȾɨ߰ӰͶﻭframe_.shadow
+    void RasterizeShadow(void);
+    // εбʰӰͶ1/wԶдʱӵƫ
+    void ApplyShadowBias(void);
+    static DWORD WINAPI RasterThreadProc(LPVOID param);
 
     // TODO դ *
     void Rasterization(void);
-    void DiffTriangle(Triangle *tri);
-    void DiffTriangleUp(const RendVertex &v0, const RendVertex &v1, const RendVertex &v2);
-    void DiffTriangleDown(const RendVertex &v0, const RendVertex &v1, const RendVertex &v2);
+    // ˳ɫդɫʵShader.h
+    void RasterizeShaded(void);
+    // ɨframe_.triangles[first, last)
+    template <DepthPass kDepth, class Shader>
+    void DiffTriangles(const Shader &shader, int first, int last);
+    // εɫƵѡʵֻShader::kCoarseShadingɫʵɫİ汾
+    template <class Shader, uint32 kPerspective, DepthPass kDepth>
+    void DiffTriangleRate(const Triangle &tri, const Shader &shader);
+    // kPerspectiveΪShader::kVaryings͸У
+    // kRateShiftΪ0ʱؼգÿ(1 << kRateShift)^2Ŀֻһ
+    template <class Shader, uint32 kPerspective, DepthPass kDepth, int kRateShift>
+    void DiffTriangle(const Triangle &tri, const Shader &shader);
+    template <class Shader, uint32 kPerspective, DepthPass kDepth, int kRateShift>
+    void DiffTriangleUp(const RendVertex &v0, const RendVertex &v1, const RendVertex &v2, const Shader &shader);
+    template <class Shader, uint32 kPerspective, DepthPass kDepth, int kRateShift>
+    void DiffTriangleDown(const RendVertex &v0, const RendVertex &v1, const RendVertex &v2, const Shader &shader);
+    // ɨ֮ΣdyΪ߹ͬĸ߶ȣɨ赽y_endΪֹ
+    template <class Shader, uint32 kPerspective, DepthPass kDepth, int kRateShift>
+    void DiffTrapezoid(const RendVertex &left_top, const RendVertex &left_bottom,
+                       const RendVertex &right_top, const RendVertex &right_bottom,
+                       float dy, int y_end, const Shader &shader);
+
+    // MSAA㸲Ǻ1/zԣÿֻɫһ
+    template <class Shader>
+    void DiffTriangleMsaa(const Triangle &tri, const Shader &shader);
+    void ClearMsaa(void);
+    // Ѳϳɵֿɫ棬resolve_depthʱÿĲд1/z
+    void ResolveMsaa(bool resolve_depth);
+
+    // ѱλ¼δtriangles_Ƶ͸Уlitʱalphaȡʵ
+    void QueueTranslucent(int first, bool lit, int binding);
+    // ߿ģʽεĹֻһΣ͸
+    void RasterizeWireframe(void);
+    // ͸ηֿϣÿƵɫ
+    void RasterizeTranslucent(void);
+    // ֻ[min_x, max_x] x [min_y, max_y]Χڵ
+    template <class Shader>
+    void DiffTriangleBlend(const TranslucentTriangle &translucent, int min_x, int min_y, int max_x, int max_y, const Shader &shader);
 private:
     Renderer(const Renderer&);
     Renderer& operator=(const Renderer&);
@@ -185,15 +737,37 @@ private:
     bool backface_culling_;
     ShadingMode shading_mode_;
 
+    // 󻺳ĴС
     int width_;
     int height_;
     int pitch_;
+    // դ׶ʹõķֱʣֻɹդ׶η
+    int render_width_;
+    int render_height_;
     // ָbackbufer
     uint32 *buffer_;
-    // 1/z-buffer
+    // ģʽеɫ
+    uint32 *color_buffer_;
+    // 1/z-bufferֿţת
     // ֲֵ[1, 0)֮䣬ֵԽصԽ
     float *one_over_z_buffer_;
-    HFONT font_;
+    int tiles_x_;
+    // ֿԵһĲҲ
+    int tiled_size_;
+    // ѷķֿ黺Сͷֱʱͷ
+    int tiled_capacity_;
+    // դдɫֿ
+    uint32 *tile_color_;
+    // ŴʱÿеԴڷֿ黺еƫƣԼҲصȨ(0-255)
+    std::vector<int> upscale_offsets_;
+    std::vector<uint32> upscale_weights_;
+
+    bool dynamic_resolution_;
+    float resolution_budget_ms_;
+    float resolution_min_scale_;
+    float resolution_scale_;
+    // set_dynamic_resolutionTakeFrameStateűָΪ1
+    bool resolution_reset_;
     
     Camera *camera_;
     Light *light_;
@@ -201,16 +775,95 @@ private:
     Material *mat_;
 
     RendPrimitive rend_primitive_;
+    std::vector<InstanceMatrix> instance_matrices_;
+    // ÿڲüռеoutcodeԼȴü
+    std::vector<uint32> clip_codes_;
+    std::vector<int> clip_queue_;
+    // 任Ķأ͸Ͱ͸ι
+    std::vector<RendVertex> vertices_;
     std::vector<Triangle> triangles_;
-
-    std::vector<Point> text_pos_;
-    std::vector<std::string> text_string_;
+    // ֡ÿλƵɫդ׶κһBeginFrameʱͷ
+    std::vector<PixelShaderBinding> bindings_;
+
+    ShadingRate shading_rate_;
+    // ɫʱǰÿĹգstampcoarse_stamp_ͬʱЧ
+    std::vector<Vector4> coarse_lighting_;
+    std::vector<uint32> coarse_stamps_;
+    uint32 coarse_stamp_;
+
+    bool draw_sorting_;
+    std::vector<DrawCommand> draw_list_;
+    std::vector<int> draw_order_;
+    std::vector<Matrix44> draw_batch_;
+
+    BlendMode blend_mode_;
+    std::vector<TranslucentTriangle> translucent_;
+    // դ׶ÿڵİ͸±
+    std::vector<std::vector<int> > translucent_tiles_;
+    std::vector<int> translucent_order_;
+    // һдϵԴɫδͨԵΪ0
+    std::vector<uint32> blend_row_;
+
+    // ߿ģʽıȥأֻɹդ׶η
+    EdgeSet wireframe_set_;
+    int wireframe_edges_;
+    int wireframe_triangle_edges_;
+
+    int msaa_samples_;
+    // MSAA棬ֻɹդ׶ηʣÿmsaa_samples
+    int msaa_allocated_;
+    std::vector<uint32> msaa_color_;
+    std::vector<float> msaa_depth_;
+    // ÿصĲ洢״̬RasterStage.hеMsaaPixelState
+    std::vector<uint8> msaa_state_;
+
+    bool depth_prepass_;
+    // դ׶дˮģʽֱ̲߳Ӷ
+    RasterStats raster_stats_;
+    // EndFrameʱraster_stats_ƣֻ߳
+    RasterStats last_raster_stats_;
+
+    PostProcessSettings post_process_settings_;
+    PostProcess post_process_;
+
+    // ˮģʽ¹դ̻߳һ֡ͼ߳һŵĵƹ
+    ShadowMap shadow_maps_[2];
+    // ֡ӰͶüĶ
+    std::vector<RendVertex> shadow_vertices_;
+    std::vector<Triangle> shadow_triangles_;
+    // ӷֿ1/zͼԼÿӰ1/wƫƣֻɹդ׶η
+    std::vector<float> shadow_depth_;
+    std::vector<float> shadow_bias_;
+    int shadow_index_;
+    int shadow_size_;
+    Vector3 shadow_target_;
+    float shadow_fov_;
+    float shadow_near_;
+    float shadow_far_;
+
+    // ڹդ֡
+    FrameState frame_;
+    HANDLE raster_thread_;
+    // ύ֡
+    HANDLE raster_start_;
+    // һ֡դɣύһ֡
+    HANDLE raster_done_;
+    volatile bool raster_exit_;
+
+    OcclusionBuffer occlusion_;
+    bool occlusion_culling_;
+    RenderStats stats_;
+
+    TextRenderer text_renderer_;
+    std::vector<GlyphQuad> text_quads_;
     uint32 text_color_;
 
     Texture2D *texture_;
-    Texture2D *bumpmap_;
+    const NormalMap *normal_map_;
     bool flat_;
     bool diff_perspective;
     int tri_up_down_;
 };
 
+// դģ嶨壬뵥ԪԼɫʵ
+#include "RasterStage.h"
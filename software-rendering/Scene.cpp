@@ -7,6 +7,9 @@
 
 using std::string;
 
+// LODĻռλ
+static const float kLodErrorPixels = 1.0f;
+
 void Scene::LoadFromXFile(string file, IDirect3DDevice9 *device)
 {
     assert(device);
@@ -25,7 +28,7 @@ void Scene::LoadFromXFile(string file, IDirect3DDevice9 *device)
                                     &mesh);           // ppMesh
     if (FAILED(res))
     {
-        Logger::GtLogError("load mesh from X file failed:%s", file.c_str());
+        GT_LOG_ERROR("load mesh from X file failed:%s", file.c_str());
         return;
     }
     assert(num_material == 1);
@@ -90,24 +93,67 @@ void Scene::LoadFromXFile(string file, IDirect3DDevice9 *device)
         }
     }
 
-    Primitive  verteies(num_vertex, nullptr, nullptr);
+    IndexedMesh verteies;
+    verteies.positions.resize(num_vertex);
+    verteies.normals.resize(num_vertex);
+    verteies.uvs.resize(num_vertex);
     for (int i = 0; i < num_vertex; ++i)
     {
         verteies.positions[i] = *reinterpret_cast<Vector3 *>(vertex_data + vertex_size * i + offset_pos);
-        verteies.positions[i].Display();
         verteies.normals[i] = *reinterpret_cast<Vector3 *>(vertex_data + vertex_size * i + offset_nor);
-        verteies.normals[i].Display();
         verteies.uvs[i] = *reinterpret_cast<Vector2 *>(vertex_data + vertex_size * i + offset_tex);
-        verteies.uvs[i].Display();
     }
-    primitive_ = verteies;
 
     vertex_buffer->Unlock();
     vertex_buffer->Release();
+
+    // ȡб洢
+    DWORD num_face = mesh->GetNumFaces();
+    IDirect3DIndexBuffer9 *index_buffer = nullptr;
+    res = mesh->GetIndexBuffer(&index_buffer);
+    assert(SUCCEEDED(res));
+    void *index_data = nullptr;
+    res = index_buffer->Lock(0, 0, &index_data, D3DLOCK_READONLY);
+    assert(SUCCEEDED(res));
+
+    bool is_32bit = (mesh->GetOptions() & D3DXMESH_32BIT) != 0;
+    verteies.indices.resize(num_face * 3);
+    for (DWORD i = 0; i < num_face * 3; ++i)
+    {
+        if (is_32bit)
+            verteies.indices[i] = static_cast<uint32 *>(index_data)[i];
+        else
+            verteies.indices[i] = static_cast<uint16 *>(index_data)[i];
+    }
+
+    index_buffer->Unlock();
+    index_buffer->Release();
+    mesh->Release();
+
+    // ֻڼʱһΣͼɫʱֵʹ
+    verteies.ComputeTangents();
+
+    // ʱLOD
+    lod_.Build(verteies, &material_, &texture_);
 }
 
 
 void Scene::Update(Renderer *renderer)
 {
-    renderer->DrawPrimitive(&primitive_);
+    if (lod_.get_level_count() == 0)
+        return;
+
+    lod_level_ = Draw(renderer);
+}
+
+int Scene::Draw(Renderer *renderer)
+{
+    if (lod_.get_level_count() == 0)
+        return 0;
+
+    Matrix44 world = Matrix44::CreateIdentity();
+    int level = lod_.SelectLevel(renderer->get_camera(), world, renderer->get_height(), kLodErrorPixels);
+    renderer->DrawShadowCaster(lod_.get_level(level), world);
+    renderer->DrawPrimitive(lod_.get_level(level), world);
+    return level;
 }
\ No newline at end of file
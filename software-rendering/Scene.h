@@ -2,6 +2,7 @@
 #include <string>
 #include <d3d9.h>
 #include "Primitive.h"
+#include "MeshLod.h"
 
 class Renderer;
 
@@ -9,18 +10,38 @@ class Scene
 {
 public:
     Scene(void)
-        :texture_(nullptr) {}
+        :texture_(nullptr)
+        ,lod_level_(0) {}
 
     ~Scene(void) {}
 
     void LoadFromXFile(std::string file, IDirect3DDevice9 *device);
     void Update(Renderer *renderer);
+    // ѡLODƣ޸ĳ״̬Rendererͬʱ
+    int Draw(Renderer *renderer);
+
+    bool IsLoaded(void)
+    {
+        return lod_.get_level_count() > 0;
+    }
+
+    // ȫ
+    Primitive *get_primitive(void)
+    {
+        return lod_.get_level(0);
+    }
+
+    int get_lod_level(void)
+    {
+        return lod_level_;
+    }
 
 private:
     Scene(Scene &);
     Scene operator=(Scene &);
 
-    Primitive primitive_;
+    MeshLod lod_;
+    int lod_level_;
     Material material_;
     Texture2D texture_;
 };
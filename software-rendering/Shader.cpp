@@ -0,0 +1,55 @@
+#include "Shader.h"
+
+Vector4 Shading(const Vector3 &pos, const Vector3 &normal, const Material &mat, const Light &light, float visibility)
+{
+    // ߷ָԴ
+    Vector3 L = light.position - pos;
+    // Դ
+    float dist = L.Magnitude();
+    L.SetNormalize();
+    // ǿԴ
+    float I = 1.0f / (light.attenuation0 + light.attenuation1 * dist + light.attenuation2 * dist * dist);
+    float I_direct = I * visibility;
+    // 
+    Vector4 amb_color = light.ambient * mat.ambient * I;
+    amb_color = clamp(amb_color, 0.0f, 1.0f);
+    Vector3 N = normal;
+    N.SetNormalize();
+    // 㷨
+    float light_angle = DotProduct(L, N);
+    light_angle = max_t(light_angle, 0.0f);
+    // 
+    Vector4 diff_color = light.diffuse * mat.diffuse * light_angle * I_direct;
+    diff_color = clamp(diff_color, 0.0f, 1.0f);
+    // ۲췽ռ䣩
+    Vector3 V = -pos;
+    V.SetNormalize();
+    // 
+    Vector3 H = L + V;
+    H.SetNormalize();
+    // 淴
+    float view_angle = DotProduct(H, N);
+    view_angle = max_t(view_angle, 0.0f);
+    Vector4 spec_color = light.specular * mat.specular * powf(view_angle, mat.specular.w) * I_direct;
+    spec_color = clamp(spec_color, 0.0f, 1.0f);
+    Vector4 ret = amb_color + diff_color + spec_color;    
+    return ret;
+}
+
+Vector3 perturb_normal(const NormalMap &normal_map, const Vector2 &uv, const Vector3 &normal, const Vector4 &tangent)
+{
+    Vector3 N = normal;
+    N.SetNormalize();
+    // ֵ߲뷨ߴֱ
+    Vector3 T(tangent.x, tangent.y, tangent.z);
+    T = T - N * DotProduct(N, T);
+    float len = T.Magnitude();
+    if (len < 1e-6f)
+        return N;
+    T = T * (1.0f / len);
+    Vector3 B = CrossProduct(N, T);
+    if (tangent.w < 0.0f)
+        B = -B;
+    Vector3 n = normal_map.Sample(uv.u, uv.v);
+    return T * n.x + B * n.y + N * n.z;
+}
\ No newline at end of file
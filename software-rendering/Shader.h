@@ -0,0 +1,245 @@
+#pragma once
+#include "typedef.h"
+#include "vector.h"
+#include "matrix.h"
+#include "mathdef.h"
+#include "Primitive.h"
+#include "Light.h"
+#include "NormalMap.h"
+#include "ShadowMap.h"
+#include "Texture2D.h"
+
+// ɫͨ࣬麯Rendererɫʵդģ壬ȫ
+//
+// ɫvoid operator()(RendVertex *tri) const
+//   triΪռһε㣬FlatҪΣ԰ε
+//   static const bool kLitʾǷglobal_posnormaltangentΪfalseʱЩ
+// ɫstatic const uint32 kVaryingsҪֵԣդֻЩ
+//   uint32 operator()(float x, float y, float one_over_z, const Varyings &v) const
+//   xyΪĻ꣬ARGBɫ
+//   static const bool kCoarseShadingʾǷֵð㣬Ϊfalseʱֻصİ汾
+//   ΪtrueʱҪṩoperator()Combine(Lighting(...), v)
+//   ɫʱǰڿļһΣɿڵعãؼ
+//   Vector4 Lighting(float x, float y, float one_over_z, const Varyings &v) const
+//   uint32 Combine(const Vector4 &lighting, const Varyings &v) const
+// ɫRenderer::DrawPrimitiveÿλƴ룬õɫģʽҲʵֵ
+
+// դֵ
+enum Varying
+{
+    kVaryingColor = 1,
+    kVaryingUv = 2,
+    kVaryingNormal = 4,
+    kVaryingPos = 8,
+    kVaryingTangent = 16
+};
+
+// ֵԣkVaryingsеĳԱᱻд
+class Varyings
+{
+public:
+    Vector4 color;
+    Vector2 uv;
+    Vector3 normal;
+    Vector3 pos;
+    Vector4 tangent;
+};
+
+// ռĹգvisibilityΪӰбյıֻӰ;淴
+Vector4 Shading(const Vector3 &pos, const Vector3 &normal, const Material &mat, const Light &light, float visibility = 1.0f);
+// òֵõ߽TBNѷͼе߿ռ䷨߱任ռ
+Vector3 perturb_normal(const NormalMap &normal_map, const Vector2 &uv, const Vector3 &normal, const Vector4 &tangent);
+
+// 淨߼һιգɫͬ
+class FlatVertexShader
+{
+public:
+    static const bool kLit = true;
+
+    FlatVertexShader(const Material &mat, const Light &light)
+        :mat_(mat)
+        ,light_(light) {}
+
+    void operator()(RendVertex *tri) const
+    {
+        const Vector3 &p0 = tri[0].global_pos;
+        const Vector3 &p1 = tri[1].global_pos;
+        const Vector3 &p2 = tri[2].global_pos;
+
+        Vector3 pos = (p0 + p1 + p2) * (1.0f / 3.0f);
+
+        Vector3 e0 = p1 - p0;
+        Vector3 e1 = p2 - p1;
+
+        Vector3 normal = CrossProduct(e0, e1);
+        normal.SetNormalize();
+
+        Vector4 color = Shading(pos, normal, mat_, light_);
+        tri[0].color = color;
+        tri[1].color = color;
+        tri[2].color = color;
+    }
+
+private:
+    Material mat_;
+    Light light_;
+};
+
+// 𶥵
+class GouraudVertexShader
+{
+public:
+    static const bool kLit = true;
+
+    GouraudVertexShader(const Material &mat, const Light &light)
+        :mat_(mat)
+        ,light_(light) {}
+
+    void operator()(RendVertex *tri) const
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            tri[i].color = Shading(tri[i].global_pos, tri[i].normal, mat_, light_);
+        }
+    }
+
+private:
+    Material mat_;
+    Light light_;
+};
+
+// ޹աPhongʹãɫ
+class UnlitVertexShader
+{
+public:
+    static const bool kLit = false;
+
+    void operator()(RendVertex *tri) const {}
+};
+
+// ɫ
+template <bool kTextured>
+static inline uint32 textured_color(Texture2D *texture, const Vector4 &color, const Vector2 &uv)
+{
+    if (!kTextured)
+        return vector4_to_ARGB32(clamp(color, 0.0f, 1.0f));
+    float u = clamp(uv.u, 0.0f, 1.0f);
+    float v = clamp(uv.v, 0.0f, 1.0f);
+    return vector4_to_ARGB32(clamp(color * texture->GetDataUV(u, v), 0.0f, 1.0f));
+}
+
+// ԤȾãֵκԣɨֻд1/z
+class DepthOnlyShader
+{
+public:
+    static const uint32 kVaryings = 0;
+    static const bool kCoarseShading = false;
+
+    uint32 operator()(float x, float y, float one_over_z, const Varyings &v) const
+    {
+        return 0;
+    }
+};
+
+// ֱֵĶɫ޹աFlatGouraudʹ
+template <bool kTextured>
+class ColorPixelShader
+{
+public:
+    static const uint32 kVaryings = kVaryingColor | (kTextured ? kVaryingUv : 0);
+    static const bool kCoarseShading = false;
+
+    explicit ColorPixelShader(Texture2D *texture)
+        :texture_(texture) {}
+
+    uint32 operator()(float x, float y, float one_over_z, const Varyings &v) const
+    {
+        return textured_color<kTextured>(texture_, v.color, v.uv);
+    }
+
+private:
+    Texture2D *texture_;
+};
+
+// عգѡӰͷͼ
+template <bool kTextured, bool kNormalMapped>
+class PhongPixelShader
+{
+public:
+    // ͼuvȡֵûʱҲҪֵuv
+    static const uint32 kVaryings = kVaryingColor | kVaryingNormal | kVaryingPos
+                                  | ((kTextured || kNormalMapped) ? kVaryingUv : 0)
+                                  | (kNormalMapped ? kVaryingTangent : 0);
+    // հ㣬Ⱥ
+    static const bool kCoarseShading = true;
+
+    PhongPixelShader(const Material &mat, const Light &light, Texture2D *texture, const NormalMap *normal_map)
+        :mat_(mat)
+        ,light_(light)
+        ,texture_(texture)
+        ,normal_map_(normal_map)
+        ,shadow_(nullptr)
+        ,view_scale_x_(0.0f)
+        ,view_scale_y_(0.0f)
+        ,half_width_(0)
+        ,half_height_(0) {}
+
+    // view_scale_xview_scale_yΪĻwԭռxyı
+    void set_shadow(const ShadowMap *shadow, const Matrix44 &camera_to_light,
+                    float view_scale_x, float view_scale_y, int width, int height)
+    {
+        shadow_ = shadow;
+        camera_to_light_ = camera_to_light;
+        view_scale_x_ = view_scale_x;
+        view_scale_y_ = view_scale_y;
+        half_width_ = width / 2;
+        half_height_ = height / 2;
+    }
+
+    uint32 operator()(float x, float y, float one_over_z, const Varyings &v) const
+    {
+        return Combine(Lighting(x, y, one_over_z, v), v);
+    }
+
+    // Ӱͼ͹
+    Vector4 Lighting(float x, float y, float one_over_z, const Varyings &v) const
+    {
+        float visibility = 1.0f;
+        if (shadow_)
+        {
+            // ɨ߶λĻռԲֵӰĻ1/zԭ׼ȷռλ
+            float w = 1.0f / one_over_z;
+            Vector4 view_pos((x - half_width_) * view_scale_x_ * w,
+                             (y - half_height_) * view_scale_y_ * w,
+                             w,
+                             1.0f);
+            visibility = shadow_->Lookup(view_pos * camera_to_light_);
+        }
+        if (kNormalMapped && v.tangent.w != 0.0f)
+        {
+            Vector3 n = perturb_normal(*normal_map_, v.uv, v.normal, v.tangent);
+            return Shading(v.pos, n, mat_, light_, visibility);
+        }
+        return Shading(v.pos, v.normal, mat_, light_, visibility);
+    }
+
+    uint32 Combine(const Vector4 &lighting, const Varyings &v) const
+    {
+        // ֵõalpha͸Ҫ
+        Vector4 color = lighting;
+        color.w = v.color.w;
+        return textured_color<kTextured>(texture_, color, v.uv);
+    }
+
+private:
+    Material mat_;
+    Light light_;
+    Texture2D *texture_;
+    const NormalMap *normal_map_;
+    const ShadowMap *shadow_;
+    Matrix44 camera_to_light_;
+    float view_scale_x_;
+    float view_scale_y_;
+    int half_width_;
+    int half_height_;
+};
\ No newline at end of file
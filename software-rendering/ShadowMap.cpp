@@ -0,0 +1,131 @@
+#include "ShadowMap.h"
+#include <assert.h>
+#include <algorithm>
+
+ShadowMap::ShadowMap(void)
+    :size_(0)
+    ,pcf_(2)
+    ,bias_(0.0005f)
+    ,slope_bias_(2.5f)
+    ,z_near_(0.1f)
+    ,z_far_(100.0f)
+{
+    view_proj_ = Matrix44::CreateIdentity();
+}
+
+void ShadowMap::Resize(int size)
+{
+    assert(size > 0);
+    size_ = size;
+    depth_.resize(size * size);
+    Clear();
+}
+
+void ShadowMap::SetLight(const Vector3 &pos, const Vector3 &target, float fov, float z_near, float z_far)
+{
+    Vector3 n = target - pos;
+    n.SetNormalize();
+    // Դ·ʱһο
+    Vector3 up(0.0f, 1.0f, 0.0f);
+    if (absf(DotProduct(n, up)) > 0.99f)
+        up = Vector3(0.0f, 0.0f, 1.0f);
+    Vector3 u = CrossProduct(up, n);
+    u.SetNormalize();
+    Vector3 v = CrossProduct(n, u);
+
+    Matrix44 view = Matrix44::CreateIdentity();
+    view.m00 = u.x; view.m10 = u.y; view.m20 = u.z;
+    view.m01 = v.x; view.m11 = v.y; view.m21 = v.z;
+    view.m02 = n.x; view.m12 = n.y; view.m22 = n.z;
+    view.SetTranslation(-DotProduct(pos, u), -DotProduct(pos, v), -DotProduct(pos, n));
+
+    Matrix44 proj;
+    proj.SetPerspectiveMatrixLH(z_far, z_near, angle2radian(fov), 1.0f);
+    view_proj_ = view * proj;
+    z_near_ = z_near;
+    z_far_ = z_far;
+}
+
+void ShadowMap::Clear(void)
+{
+    std::fill(depth_.begin(), depth_.end(), 1.0f);
+}
+
+float ShadowMap::GetDepthBias(float slope) const
+{
+    // z/w = f / (f - n) * (1 - n / w)z/wƫƳf * n / (f - n)1/wƫ
+    float scale = (z_far_ - z_near_) / (z_far_ * z_near_);
+    return bias_ * scale + slope_bias_ * slope;
+}
+
+void ShadowMap::Resolve(const float *one_over_w)
+{
+    assert(one_over_w);
+    // 0ʾûڵȡԶ
+    float a = z_far_ / (z_far_ - z_near_);
+    float b = a * z_near_;
+    int count = size_ * size_;
+    for (int i = 0; i < count; ++i)
+    {
+        depth_[i] = one_over_w[i] > 0.0f ? a - b * one_over_w[i] : 1.0f;
+    }
+}
+
+float ShadowMap::Lookup(const Vector4 &light_clip) const
+{
+    if (size_ == 0 || light_clip.w <= 0.0f)
+        return 1.0f;
+
+    float inv_w = 1.0f / light_clip.w;
+    float z = light_clip.z * inv_w;
+    // λ
+    float u = (light_clip.x * inv_w * 0.5f + 0.5f) * size_ - 0.5f;
+    float v = (-light_clip.y * inv_w * 0.5f + 0.5f) * size_ - 0.5f;
+    // Դ׶֮ⲻӰ
+    if (u < -1.0f || v < -1.0f || u > size_ || v > size_ || z > 1.0f)
+        return 1.0f;
+
+    int max_index = size_ - 1;
+    if (pcf_ == 1)
+    {
+        int x = clamp(static_cast<int>(u + 0.5f), 0, max_index);
+        int y = clamp(static_cast<int>(v + 0.5f), 0, max_index);
+        return z <= get_depth(x, y) ? 1.0f : 0.0f;
+    }
+
+    if (pcf_ == 2)
+    {
+        // ĸȽϽ˫ȨػϣСзֱδضϵλٽصԵ
+        float fu = floorf(u);
+        float fv = floorf(v);
+        float s = u - fu;
+        float t = v - fv;
+        int iu = static_cast<int>(fu);
+        int iv = static_cast<int>(fv);
+        int x0 = clamp(iu, 0, max_index);
+        int y0 = clamp(iv, 0, max_index);
+        int x1 = clamp(iu + 1, 0, max_index);
+        int y1 = clamp(iv + 1, 0, max_index);
+        float lit00 = z <= get_depth(x0, y0) ? 1.0f : 0.0f;
+        float lit10 = z <= get_depth(x1, y0) ? 1.0f : 0.0f;
+        float lit01 = z <= get_depth(x0, y1) ? 1.0f : 0.0f;
+        float lit11 = z <= get_depth(x1, y1) ? 1.0f : 0.0f;
+        return (lit00 * (1.0f - s) + lit10 * s) * (1.0f - t)
+             + (lit01 * (1.0f - s) + lit11 * s) * t;
+    }
+
+    // uvΪȡ
+    int cx = static_cast<int>(floorf(u + 0.5f));
+    int cy = static_cast<int>(floorf(v + 0.5f));
+    int lit = 0;
+    for (int dy = -1; dy <= 1; ++dy)
+    {
+        int y = clamp(cy + dy, 0, max_index);
+        for (int dx = -1; dx <= 1; ++dx)
+        {
+            int x = clamp(cx + dx, 0, max_index);
+            lit += z <= get_depth(x, y) ? 1 : 0;
+        }
+    }
+    return lit * (1.0f / 9.0f);
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+#include <vector>
+#include "typedef.h"
+#include "vector.h"
+#include "matrix.h"
+
+// ԴӽǵͼֻͶӰz/wֵԽСԽ
+// RendererԤȾɨ߹դֵֻ1/wResolveд
+class ShadowMap
+{
+public:
+    ShadowMap(void);
+    ~ShadowMap(void) {}
+
+    void Resize(int size);
+
+    int get_size(void) const
+    {
+        return size_;
+    }
+
+    // ԴpostargetfovΪǶ
+    void SetLight(const Vector3 &pos, const Vector3 &target, float fov, float z_near, float z_far);
+
+    // ռ䵽Դüռ
+    const Matrix44 &get_view_proj(void) const
+    {
+        return view_proj_;
+    }
+
+    void Clear(void);
+
+    // one_over_wΪդõsize x size1/wдţ0ʾûڵתz/w
+    void Resolve(const float *one_over_w);
+
+    // Դüռеĵ㣬رյı0ΪȫӰ
+    float Lookup(const Vector4 &light_clip) const;
+
+    // PCF1Ϊ㣬2Ϊ2x2˫ԣ3Ϊ3x3
+    void set_pcf(int taps)
+    {
+        pcf_ = clamp(taps, 1, 3);
+    }
+
+    int get_pcf(void) const
+    {
+        return pcf_;
+    }
+
+    // ƫƣֹڵ
+    // դʱÿεȼbias + slope_bias * ÿصȱ仯
+    void set_bias(float bias, float slope_bias)
+    {
+        bias_ = bias;
+        slope_bias_ = slope_bias;
+    }
+
+    // ɹդʱ1/wҪȥslopeΪε1/wÿص仯
+    float GetDepthBias(float slope) const;
+
+private:
+    ShadowMap(const ShadowMap&);
+    ShadowMap& operator=(const ShadowMap&);
+
+    float get_depth(int x, int y) const
+    {
+        return depth_[y * size_ + x];
+    }
+
+    int size_;
+    std::vector<float> depth_;
+    Matrix44 view_proj_;
+    int pcf_;
+    float bias_;
+    float slope_bias_;
+    float z_near_;
+    float z_far_;
+};
\ No newline at end of file
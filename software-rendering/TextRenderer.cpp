@@ -0,0 +1,422 @@
+#include "TextRenderer.h"
+#include <assert.h>
+#include <string.h>
+#include <emmintrin.h>
+#include "Logger.h"
+
+// 8x8壬ַ0x200x7eÿֽһУλΪߵ
+static const uint8 kFont8x8[95][8] =
+{
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // ' '
+    {0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00}, // '!'
+    {0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // '"'
+    {0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36, 0x00}, // '#'
+    {0x0C, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x0C, 0x00}, // '$'
+    {0x00, 0x63, 0x33, 0x18, 0x0C, 0x66, 0x63, 0x00}, // '%'
+    {0x1C, 0x36, 0x1C, 0x6E, 0x3B, 0x33, 0x6E, 0x00}, // '&'
+    {0x06, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00}, // '''
+    {0x18, 0x0C, 0x06, 0x06, 0x06, 0x0C, 0x18, 0x00}, // '('
+    {0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06, 0x00}, // ')'
+    {0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00}, // '*'
+    {0x00, 0x0C, 0x0C, 0x3F, 0x0C, 0x0C, 0x00, 0x00}, // '+'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x06}, // ','
+    {0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00}, // '-'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00}, // '.'
+    {0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01, 0x00}, // '/'
+    {0x3E, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x3E, 0x00}, // '0'
+    {0x0C, 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x3F, 0x00}, // '1'
+    {0x1E, 0x33, 0x30, 0x1C, 0x06, 0x33, 0x3F, 0x00}, // '2'
+    {0x1E, 0x33, 0x30, 0x1C, 0x30, 0x33, 0x1E, 0x00}, // '3'
+    {0x38, 0x3C, 0x36, 0x33, 0x7F, 0x30, 0x78, 0x00}, // '4'
+    {0x3F, 0x03, 0x1F, 0x30, 0x30, 0x33, 0x1E, 0x00}, // '5'
+    {0x1C, 0x06, 0x03, 0x1F, 0x33, 0x33, 0x1E, 0x00}, // '6'
+    {0x3F, 0x33, 0x30, 0x18, 0x0C, 0x0C, 0x0C, 0x00}, // '7'
+    {0x1E, 0x33, 0x33, 0x1E, 0x33, 0x33, 0x1E, 0x00}, // '8'
+    {0x1E, 0x33, 0x33, 0x3E, 0x30, 0x18, 0x0E, 0x00}, // '9'
+    {0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x00}, // ':'
+    {0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x06}, // ';'
+    {0x18, 0x0C, 0x06, 0x03, 0x06, 0x0C, 0x18, 0x00}, // '<'
+    {0x00, 0x00, 0x3F, 0x00, 0x00, 0x3F, 0x00, 0x00}, // '='
+    {0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06, 0x00}, // '>'
+    {0x1E, 0x33, 0x30, 0x18, 0x0C, 0x00, 0x0C, 0x00}, // '?'
+    {0x3E, 0x63, 0x7B, 0x7B, 0x7B, 0x03, 0x1E, 0x00}, // '@'
+    {0x0C, 0x1E, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x00}, // 'A'
+    {0x3F, 0x66, 0x66, 0x3E, 0x66, 0x66, 0x3F, 0x00}, // 'B'
+    {0x3C, 0x66, 0x03, 0x03, 0x03, 0x66, 0x3C, 0x00}, // 'C'
+    {0x1F, 0x36, 0x66, 0x66, 0x66, 0x36, 0x1F, 0x00}, // 'D'
+    {0x7F, 0x46, 0x16, 0x1E, 0x16, 0x46, 0x7F, 0x00}, // 'E'
+    {0x7F, 0x46, 0x16, 0x1E, 0x16, 0x06, 0x0F, 0x00}, // 'F'
+    {0x3C, 0x66, 0x03, 0x03, 0x73, 0x66, 0x7C, 0x00}, // 'G'
+    {0x33, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x33, 0x00}, // 'H'
+    {0x1E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00}, // 'I'
+    {0x78, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E, 0x00}, // 'J'
+    {0x67, 0x66, 0x36, 0x1E, 0x36, 0x66, 0x67, 0x00}, // 'K'
+    {0x0F, 0x06, 0x06, 0x06, 0x46, 0x66, 0x7F, 0x00}, // 'L'
+    {0x63, 0x77, 0x7F, 0x7F, 0x6B, 0x63, 0x63, 0x00}, // 'M'
+    {0x63, 0x67, 0x6F, 0x7B, 0x73, 0x63, 0x63, 0x00}, // 'N'
+    {0x1C, 0x36, 0x63, 0x63, 0x63, 0x36, 0x1C, 0x00}, // 'O'
+    {0x3F, 0x66, 0x66, 0x3E, 0x06, 0x06, 0x0F, 0x00}, // 'P'
+    {0x1E, 0x33, 0x33, 0x33, 0x3B, 0x1E, 0x38, 0x00}, // 'Q'
+    {0x3F, 0x66, 0x66, 0x3E, 0x36, 0x66, 0x67, 0x00}, // 'R'
+    {0x1E, 0x33, 0x07, 0x0E, 0x38, 0x33, 0x1E, 0x00}, // 'S'
+    {0x3F, 0x2D, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00}, // 'T'
+    {0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x00}, // 'U'
+    {0x33, 0x33, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00}, // 'V'
+    {0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63, 0x00}, // 'W'
+    {0x63, 0x63, 0x36, 0x1C, 0x1C, 0x36, 0x63, 0x00}, // 'X'
+    {0x33, 0x33, 0x33, 0x1E, 0x0C, 0x0C, 0x1E, 0x00}, // 'Y'
+    {0x7F, 0x63, 0x31, 0x18, 0x4C, 0x66, 0x7F, 0x00}, // 'Z'
+    {0x1E, 0x06, 0x06, 0x06, 0x06, 0x06, 0x1E, 0x00}, // '['
+    {0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x40, 0x00}, // '\'
+    {0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E, 0x00}, // ']'
+    {0x08, 0x1C, 0x36, 0x63, 0x00, 0x00, 0x00, 0x00}, // '^'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF}, // '_'
+    {0x0C, 0x0C, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00}, // '`'
+    {0x00, 0x00, 0x1E, 0x30, 0x3E, 0x33, 0x6E, 0x00}, // 'a'
+    {0x07, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3B, 0x00}, // 'b'
+    {0x00, 0x00, 0x1E, 0x33, 0x03, 0x33, 0x1E, 0x00}, // 'c'
+    {0x38, 0x30, 0x30, 0x3E, 0x33, 0x33, 0x6E, 0x00}, // 'd'
+    {0x00, 0x00, 0x1E, 0x33, 0x3F, 0x03, 0x1E, 0x00}, // 'e'
+    {0x1C, 0x36, 0x06, 0x0F, 0x06, 0x06, 0x0F, 0x00}, // 'f'
+    {0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x1F}, // 'g'
+    {0x07, 0x06, 0x36, 0x6E, 0x66, 0x66, 0x67, 0x00}, // 'h'
+    {0x0C, 0x00, 0x0E, 0x0C, 0x0C, 0x0C, 0x1E, 0x00}, // 'i'
+    {0x30, 0x00, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E}, // 'j'
+    {0x07, 0x06, 0x66, 0x36, 0x1E, 0x36, 0x67, 0x00}, // 'k'
+    {0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00}, // 'l'
+    {0x00, 0x00, 0x33, 0x7F, 0x7F, 0x6B, 0x63, 0x00}, // 'm'
+    {0x00, 0x00, 0x1F, 0x33, 0x33, 0x33, 0x33, 0x00}, // 'n'
+    {0x00, 0x00, 0x1E, 0x33, 0x33, 0x33, 0x1E, 0x00}, // 'o'
+    {0x00, 0x00, 0x3B, 0x66, 0x66, 0x3E, 0x06, 0x0F}, // 'p'
+    {0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x78}, // 'q'
+    {0x00, 0x00, 0x3B, 0x6E, 0x66, 0x06, 0x0F, 0x00}, // 'r'
+    {0x00, 0x00, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x00}, // 's'
+    {0x08, 0x0C, 0x3E, 0x0C, 0x0C, 0x2C, 0x18, 0x00}, // 't'
+    {0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x6E, 0x00}, // 'u'
+    {0x00, 0x00, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00}, // 'v'
+    {0x00, 0x00, 0x63, 0x6B, 0x7F, 0x7F, 0x36, 0x00}, // 'w'
+    {0x00, 0x00, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x00}, // 'x'
+    {0x00, 0x00, 0x33, 0x33, 0x33, 0x3E, 0x30, 0x1F}, // 'y'
+    {0x00, 0x00, 0x3F, 0x19, 0x0C, 0x26, 0x3F, 0x00}, // 'z'
+    {0x38, 0x0C, 0x0C, 0x07, 0x0C, 0x0C, 0x38, 0x00}, // '{'
+    {0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00}, // '|'
+    {0x07, 0x0C, 0x0C, 0x38, 0x0C, 0x0C, 0x07, 0x00}, // '}'
+    {0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}  // '~'
+};
+
+static const int kAsciiSize = 8;
+// ˫ַֽդõλͼ߳
+static const int kWideCell = 16;
+
+TextRenderer::TextRenderer(void)
+    :atlas_(kAtlasSize * kAtlasSize, 0)
+    ,shelf_x_(0)
+    ,shelf_y_(0)
+    ,shelf_height_(0)
+    ,dc_(NULL)
+    ,bitmap_(NULL)
+    ,font_(NULL)
+    ,bits_(nullptr)
+    ,gdi_failed_(false)
+{
+    BakeAscii();
+}
+
+TextRenderer::~TextRenderer(void)
+{
+    Uninitialize();
+}
+
+void TextRenderer::Uninitialize(void)
+{
+    if (dc_)
+    {
+        DeleteDC(dc_);
+        dc_ = NULL;
+    }
+    if (bitmap_)
+    {
+        DeleteObject(bitmap_);
+        bitmap_ = NULL;
+        bits_ = nullptr;
+    }
+    if (font_)
+    {
+        DeleteObject(font_);
+        font_ = NULL;
+    }
+}
+
+bool TextRenderer::Allocate(int width, int height, int *x, int *y)
+{
+    if (shelf_x_ + width > kAtlasSize)
+    {
+        shelf_y_ += shelf_height_;
+        shelf_x_ = 0;
+        shelf_height_ = 0;
+    }
+    if (shelf_y_ + height > kAtlasSize)
+        return false;
+    *x = shelf_x_;
+    *y = shelf_y_;
+    shelf_x_ += width;
+    shelf_height_ = max_t(shelf_height_, height);
+    return true;
+}
+
+void TextRenderer::BakeAscii(void)
+{
+    for (int code = 0; code < 128; ++code)
+    {
+        Glyph &glyph = ascii_[code];
+        if (code < 0x20 || code > 0x7e)
+            continue;
+        glyph.advance = kAsciiSize;
+        // 8x8ڴֱ
+        glyph.offset_y = (kLineHeight - kAsciiSize) / 2;
+
+        const uint8 *rows = kFont8x8[code - 0x20];
+        bool blank = true;
+        for (int i = 0; i < kAsciiSize; ++i)
+        {
+            blank = blank && rows[i] == 0;
+        }
+        // հַֻǰı
+        if (blank)
+            continue;
+
+        int x = 0;
+        int y = 0;
+        bool ok = Allocate(kAsciiSize, kAsciiSize, &x, &y);
+        assert(ok);
+        glyph.atlas_x = x;
+        glyph.atlas_y = y;
+        glyph.width = kAsciiSize;
+        glyph.height = kAsciiSize;
+        for (int row = 0; row < kAsciiSize; ++row)
+        {
+            uint8 *dst = &atlas_[(y + row) * kAtlasSize + x];
+            for (int col = 0; col < kAsciiSize; ++col)
+            {
+                dst[col] = (rows[row] >> col) & 1 ? 255 : 0;
+            }
+        }
+    }
+}
+
+bool TextRenderer::BakeWide(unsigned int code, Glyph *glyph)
+{
+    if (gdi_failed_)
+        return false;
+
+    // ڴDCDIBҪں豸
+    if (!dc_)
+    {
+        BITMAPINFO info;
+        memset(&info, 0, sizeof(info));
+        info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        info.bmiHeader.biWidth = kWideCell;
+        info.bmiHeader.biHeight = -kWideCell;
+        info.bmiHeader.biPlanes = 1;
+        info.bmiHeader.biBitCount = 32;
+        info.bmiHeader.biCompression = BI_RGB;
+
+        LOGFONT lfont;
+        memset(&lfont, 0, sizeof(lfont));
+        lfont.lfHeight = kLineHeight;
+        lfont.lfCharSet = GB2312_CHARSET;
+        lfont.lfQuality = ANTIALIASED_QUALITY;
+        strcpy_s(lfont.lfFaceName, "SimSun");
+
+        void *bits = nullptr;
+        dc_ = CreateCompatibleDC(NULL);
+        if (dc_)
+        {
+            bitmap_ = CreateDIBSection(dc_, &info, DIB_RGB_COLORS, &bits, NULL, 0);
+        }
+        font_ = CreateFontIndirect(&lfont);
+        if (!dc_ || !bitmap_ || !font_)
+        {
+            GT_LOG_ERROR("create glyph dc failed: %d", GetLastError());
+            Uninitialize();
+            gdi_failed_ = true;
+            return false;
+        }
+        bits_ = static_cast<uint32 *>(bits);
+        SelectObject(dc_, bitmap_);
+        SelectObject(dc_, font_);
+        SetBkMode(dc_, TRANSPARENT);
+        SetTextColor(dc_, RGB(255, 255, 255));
+    }
+
+    char text[2] = {static_cast<char>(code >> 8), static_cast<char>(code & 0xff)};
+    SIZE size;
+    memset(bits_, 0, kWideCell * kWideCell * sizeof(uint32));
+    if (!TextOutA(dc_, 0, 0, text, 2) || !GetTextExtentPoint32A(dc_, text, 2, &size))
+        return false;
+    GdiFlush();
+
+    int width = min_t(static_cast<int>(size.cx), kWideCell);
+    int height = min_t(static_cast<int>(size.cy), kWideCell);
+    int x = 0;
+    int y = 0;
+    if (!Allocate(width, height, &x, &y))
+    {
+        GT_LOG_ERROR("glyph atlas is full");
+        return false;
+    }
+    // ֺڵףȡɫͨΪ
+    for (int row = 0; row < height; ++row)
+    {
+        uint8 *dst = &atlas_[(y + row) * kAtlasSize + x];
+        const uint32 *src = bits_ + row * kWideCell;
+        for (int col = 0; col < width; ++col)
+        {
+            dst[col] = static_cast<uint8>((src[col] >> 8) & 0xff);
+        }
+    }
+    glyph->atlas_x = x;
+    glyph->atlas_y = y;
+    glyph->width = width;
+    glyph->height = height;
+    glyph->offset_y = (kLineHeight - height) / 2;
+    glyph->advance = width;
+    return true;
+}
+
+const Glyph *TextRenderer::FindGlyph(unsigned int code)
+{
+    if (code < 128)
+        return &ascii_[code];
+
+    std::map<unsigned int, Glyph>::iterator it = wide_.find(code);
+    if (it != wide_.end())
+        return &it->second;
+
+    // դʧַܵʾΪʺţͬ
+    Glyph glyph;
+    if (!BakeWide(code, &glyph))
+    {
+        glyph = ascii_['?'];
+    }
+    return &(wide_[code] = glyph);
+}
+
+int TextRenderer::Layout(int x, int y, const char *text, uint32 color, std::vector<GlyphQuad> *quads)
+{
+    assert(text);
+    int pen_x = x;
+    int pen_y = y;
+    int width = 0;
+    const uint8 *s = reinterpret_cast<const uint8 *>(text);
+    while (*s)
+    {
+        unsigned int code = *s++;
+        // GBK˫ַֽ
+        if (code >= 0x81 && *s)
+        {
+            code = (code << 8) | *s++;
+        }
+        if (code == '\n')
+        {
+            pen_x = x;
+            pen_y += kLineHeight;
+            continue;
+        }
+
+        const Glyph *glyph = FindGlyph(code);
+        if (quads && glyph->width > 0)
+        {
+            GlyphQuad quad;
+            quad.x = pen_x;
+            quad.y = pen_y + glyph->offset_y;
+            quad.atlas_x = glyph->atlas_x;
+            quad.atlas_y = glyph->atlas_y;
+            quad.width = glyph->width;
+            quad.height = glyph->height;
+            quad.color = color;
+            quads->push_back(quad);
+        }
+        pen_x += glyph->advance;
+        width = max_t(width, pen_x - x);
+    }
+    return width;
+}
+
+int TextRenderer::MeasureText(const char *text)
+{
+    return Layout(0, 0, text, 0, nullptr);
+}
+
+// x * f / 255룬xf255
+static inline uint32 mul_div255(uint32 x, uint32 f)
+{
+    uint32 t = x * f + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+static inline __m128i mul_div255_epi16(__m128i x, __m128i f)
+{
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(x, f), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+void TextRenderer::Blit(const std::vector<GlyphQuad> &quads, uint32 *buffer, int width, int height, int pitch) const
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i full = _mm_set1_epi16(255);
+    int stride = pitch / 4;
+    for (int q = 0; q < quads.size(); ++q)
+    {
+        const GlyphQuad &quad = quads[q];
+        int x_begin = max_t(quad.x, 0);
+        int x_end = min_t(quad.x + quad.width, width);
+        int y_begin = max_t(quad.y, 0);
+        int y_end = min_t(quad.y + quad.height, height);
+        if (x_begin >= x_end || y_begin >= y_end)
+            continue;
+
+        // alpha =  * ɫalpha
+        uint32 alpha = quad.color >> 24;
+        __m128i color = _mm_unpacklo_epi8(_mm_set1_epi32(quad.color), zero);
+        __m128i color_alpha = _mm_set1_epi16(static_cast<short>(alpha));
+        int count = x_end - x_begin;
+        for (int y = y_begin; y < y_end; ++y)
+        {
+            const uint8 *cover = &atlas_[(quad.atlas_y + y - quad.y) * kAtlasSize + quad.atlas_x + x_begin - quad.x];
+            uint32 *dst = buffer + y * stride + x_begin;
+            int i = 0;
+            for (; i + 4 <= count; i += 4)
+            {
+                int bits;
+                memcpy(&bits, cover + i, 4);
+                if (!bits)
+                    continue;
+                // ÿصĸʸƵ4ͨ
+                __m128i c = _mm_cvtsi32_si128(bits);
+                c = _mm_unpacklo_epi8(c, c);
+                c = _mm_unpacklo_epi16(c, c);
+                __m128i a_lo = mul_div255_epi16(_mm_unpacklo_epi8(c, zero), color_alpha);
+                __m128i a_hi = mul_div255_epi16(_mm_unpackhi_epi8(c, zero), color_alpha);
+                __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+                __m128i lo = _mm_add_epi16(mul_div255_epi16(color, a_lo), mul_div255_epi16(_mm_unpacklo_epi8(d, zero), _mm_sub_epi16(full, a_lo)));
+                __m128i hi = _mm_add_epi16(mul_div255_epi16(color, a_hi), mul_div255_epi16(_mm_unpackhi_epi8(d, zero), _mm_sub_epi16(full, a_hi)));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(lo, hi));
+            }
+            for (; i < count; ++i)
+            {
+                if (!cover[i])
+                    continue;
+                uint32 a = mul_div255(cover[i], alpha);
+                uint32 out = 0;
+                for (int shift = 0; shift < 32; shift += 8)
+                {
+                    uint32 s = (quad.color >> shift) & 0xff;
+                    uint32 d = (dst[i] >> shift) & 0xff;
+                    out |= min_t(mul_div255(s, a) + mul_div255(d, 255 - a), 255u) << shift;
+                }
+                dst[i] = out;
+            }
+        }
+    }
+}
\ No newline at end of file
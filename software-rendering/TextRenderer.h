@@ -0,0 +1,93 @@
+#pragma once
+#include <map>
+#include <vector>
+#include <Windows.h>
+#include "typedef.h"
+
+// ͼеһ
+class Glyph
+{
+public:
+    Glyph(void)
+        :atlas_x(0)
+        ,atlas_y(0)
+        ,width(0)
+        ,height(0)
+        ,offset_y(0)
+        ,advance(0) {}
+
+    int atlas_x;
+    int atlas_y;
+    int width;
+    int height;
+    // жƫ
+    int offset_y;
+    int advance;
+};
+
+// һƵΣxyΪĻ
+class GlyphQuad
+{
+public:
+    int x;
+    int y;
+    int atlas_x;
+    int atlas_y;
+    int width;
+    int height;
+    uint32 color;
+};
+
+// Ⱦ豸ģʽͬ
+// 8λʻһͼASCIIõ8x8壬
+// ַGBK˫ֽڣһõʱGDIդ񻯷ͼ֮λòٱ仯
+// ųıΣʱʳɫalphaϽɫ
+class TextRenderer
+{
+public:
+    enum
+    {
+        kAtlasSize = 512,
+        kLineHeight = 12
+    };
+
+    TextRenderer(void);
+    ~TextRenderer(void);
+
+    // ͷGDIԴͼ
+    void Uninitialize(void);
+
+    // һGBKųı׷ӵquadscolorΪARGB32ؿ
+    int Layout(int x, int y, const char *text, uint32 color, std::vector<GlyphQuad> *quads);
+
+    // ֻ
+    int MeasureText(const char *text);
+
+    // Layoutڲͬ߳ͬʱãѾͼβٱ޸
+    void Blit(const std::vector<GlyphQuad> &quads, uint32 *buffer, int width, int height, int pitch) const;
+
+private:
+    TextRenderer(const TextRenderer&);
+    TextRenderer& operator=(const TextRenderer&);
+
+    const Glyph *FindGlyph(unsigned int code);
+    // дҷͼռ
+    bool Allocate(int width, int height, int *x, int *y);
+    void BakeAscii(void);
+    // GDIդһ˫ַֽ
+    bool BakeWide(unsigned int code, Glyph *glyph);
+
+    std::vector<uint8> atlas_;
+    int shelf_x_;
+    int shelf_y_;
+    int shelf_height_;
+
+    Glyph ascii_[128];
+    std::map<unsigned int, Glyph> wide_;
+
+    HDC dc_;
+    HBITMAP bitmap_;
+    HFONT font_;
+    uint32 *bits_;
+    bool gdi_failed_;
+};
\ No newline at end of file
@@ -59,7 +59,7 @@ bool Texture2D::Load(string filename, IDirect3DDevice9 *device)
                                               &texture);
     if (FAILED(hr))
     {
-        Logger::GtLogError("load texture failed %s\n", filename.c_str());
+        GT_LOG_ERROR("load texture failed %s\n", filename.c_str());
         switch (hr)
         {
         case D3DERR_INVALIDCALL:
@@ -114,7 +114,7 @@ bool Texture2D::Lock(void)
     HRESULT hr = texture_->LockRect(0, &rect, nullptr, D3DLOCK_READONLY);
     if (FAILED(hr))
     {
-        Logger::GtLogError("lock texture failed");
+        GT_LOG_ERROR("lock texture failed");
         return false;
     }
     pitch_ = rect.Pitch;
@@ -133,7 +133,7 @@ void Texture2D::UnLock(void)
     HRESULT hr = texture_->UnlockRect(0);
     if (hr != D3D_OK)
     {
-        Logger::GtLogError("unlock texture failed");
+        GT_LOG_ERROR("unlock texture failed");
         return;
     }
     pitch_ = 0;
@@ -145,12 +145,12 @@ uint32 Texture2D::GetData(int x, int y)
 {
     if (!is_loaded_ || !is_locked_)
     {
-        Logger::GtLogError("can't get data from texture without loaded or locked: %s", filename_.c_str());
+        GT_LOG_ERROR("can't get data from texture without loaded or locked: %s", filename_.c_str());
         return 0;
     }
     if (x < 0 || x >= width_ || y < 0 || y >= height_)
     {
-        Logger::GtLogError("access texture is out of range");
+        GT_LOG_ERROR("access texture is out of range");
         assert(0);
         return 0;
     }
@@ -176,12 +176,12 @@ Vector4 Texture2D::GetDataUV(float u, float v)
 {
     if (!is_loaded_ || !is_locked_)
     {
-        Logger::GtLogError("can't get data from texture without loaded or locked: %s", filename_.c_str());
+        GT_LOG_ERROR("can't get data from texture without loaded or locked: %s", filename_.c_str());
         return Vector4();
     }
     if (u < 0 || u > 1.0 || v < 0 || v > 1.0)
     {
-        Logger::GtLogError("access texture is out of range");
+        GT_LOG_ERROR("access texture is out of range");
         assert(0);
         return Vector4();
     }
@@ -223,12 +223,12 @@ uint8 Texture2D::GetDumpData(int x, int y)
 {
     if (!is_loaded_ || !is_locked_)
     {
-        Logger::GtLogError("can't get data from texture without loaded or locked: %s", filename_.c_str());
+        GT_LOG_ERROR("can't get data from texture without loaded or locked: %s", filename_.c_str());
         return 0;
     }
     if (x < 0 || x > width_ || y < 0 || y >= height_)
     {
-        Logger::GtLogError("access texture is out of range");
+        GT_LOG_ERROR("access texture is out of range");
         assert(0);
         return 0;
     }
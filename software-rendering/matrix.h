@@ -183,10 +183,10 @@ public:
 #ifdef _DEBUG
     void Display(void) const
     {
-        Logger::GtLogInfo("Matrix33 content:");
-        Logger::GtLog("%8.3f %8.3f %8.3f", m00, m01, m02);
-        Logger::GtLog("%8.3f %8.3f %8.3f", m10, m11, m12);
-        Logger::GtLog("%8.3f %8.3f %8.3f", m20, m21, m22);
+        GT_LOG_INFO("Matrix33 content:");
+        GT_LOG_DEBUG("%8.3f %8.3f %8.3f", m00, m01, m02);
+        GT_LOG_DEBUG("%8.3f %8.3f %8.3f", m10, m11, m12);
+        GT_LOG_DEBUG("%8.3f %8.3f %8.3f", m20, m21, m22);
         return;
     }
 #endif
@@ -400,11 +400,11 @@ public:
 #ifdef _DEBUG
     void Display(void) const
     {
-        Logger::GtLogInfo("Matrix44 content:");
-        Logger::GtLog("%8.3f %8.3f %8.3f %8.3f", m00, m01, m02, m03);
-        Logger::GtLog("%8.3f %8.3f %8.3f %8.3f", m10, m11, m12, m13);
-        Logger::GtLog("%8.3f %8.3f %8.3f %8.3f", m20, m21, m22, m23);
-        Logger::GtLog("%8.3f %8.3f %8.3f %8.3f", m30, m31, m32, m33);
+        GT_LOG_INFO("Matrix44 content:");
+        GT_LOG_DEBUG("%8.3f %8.3f %8.3f %8.3f", m00, m01, m02, m03);
+        GT_LOG_DEBUG("%8.3f %8.3f %8.3f %8.3f", m10, m11, m12, m13);
+        GT_LOG_DEBUG("%8.3f %8.3f %8.3f %8.3f", m20, m21, m22, m23);
+        GT_LOG_DEBUG("%8.3f %8.3f %8.3f %8.3f", m30, m31, m32, m33);
         return;
     }
 #endif
@@ -16,6 +16,37 @@ Vector3 RotateByQuat(const Vector3 &v, const Quat &q)
     return Vector3(tmp.x, tmp.y, tmp.z);
 }
 
+Quat Slerp(const Quat &a, const Quat &b, float t)
+{
+    float cos_omega = a.w*b.w + a.x*b.x + a.y*b.y + a.z*b.z;
+    // q-qʾͬһתȡнǽСһ
+    float sign = 1.0f;
+    if (cos_omega < 0.0f)
+    {
+        sign = -1.0f;
+        cos_omega = -cos_omega;
+    }
+
+    float k0 = 1.0f - t;
+    float k1 = t;
+    // нǺСʱ˻ΪԲֵԽӽ0sin
+    if (cos_omega < 0.9999f)
+    {
+        float omega = acosf(cos_omega);
+        float one_over_sin = 1.0f / sinf(omega);
+        k0 = sinf((1.0f - t) * omega) * one_over_sin;
+        k1 = sinf(t * omega) * one_over_sin;
+    }
+    k1 *= sign;
+
+    Quat ret(a.w*k0 + b.w*k1,
+             a.x*k0 + b.x*k1,
+             a.y*k0 + b.y*k1,
+             a.z*k0 + b.z*k1);
+    ret.Normalize();
+    return ret;
+}
+
 // TODO REMOVE
 Quat RotateByQuat(const Quat &p, const Quat &q)
 {
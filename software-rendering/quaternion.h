@@ -221,8 +221,8 @@ public:
 #ifdef _DEBUG
     void Display(void)
     {
-        Logger::GtLogInfo("Quat content:");
-        Logger::GtLog("%8.3f %8.3f %8.3f %8.3f", w, x, y, z);
+        GT_LOG_INFO("Quat content:");
+        GT_LOG_DEBUG("%8.3f %8.3f %8.3f %8.3f", w, x, y, z);
         return;
     }
 #endif
@@ -232,6 +232,9 @@ Quat operator*(const Quat &p, const Quat &q);
 
 Vector3 RotateByQuat(const Vector3 &v, const Quat &q);
 
+// Բֵt[0, 1]֮䣬ؽ϶̵Ļֵ
+Quat Slerp(const Quat &a, const Quat &b, float t);
+
 #pragma warning(default:4201)
 //  ṹľ
 #pragma warning(pop)
\ No newline at end of file
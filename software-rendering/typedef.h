@@ -7,6 +7,7 @@ typedef unsigned int uint32;
 typedef int int32;
 #endif
 typedef unsigned char uint8;
+typedef unsigned short uint16;
 
 static const float gkPi = 3.141592653f;
 
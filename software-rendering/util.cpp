@@ -1,7 +1,20 @@
 #include "util.h"
 #include <utility>
+#include <Windows.h>
 #include "Primitive.h"
 
+double get_time_ms(void)
+{
+    static LARGE_INTEGER freq = {0};
+    if (freq.QuadPart == 0)
+    {
+        QueryPerformanceFrequency(&freq);
+    }
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return static_cast<double>(counter.QuadPart) * 1000.0 / static_cast<double>(freq.QuadPart);
+}
+
 void get_primitive(PrimitiveType t, Primitive *pri)
 {
     pri->Clear();
@@ -114,4 +127,5 @@ void get_primitive(PrimitiveType t, Primitive *pri)
 
         *pri = std::move(primitive);
     }
+    pri->ComputeBound();
 }
\ No newline at end of file
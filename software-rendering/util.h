@@ -30,3 +30,6 @@ enum PrimitiveType
 
 class Primitive;
 void get_primitive(PrimitiveType t, Primitive *pri);
+
+// ߾ȼʱλ
+double get_time_ms(void);
@@ -119,8 +119,8 @@ public:
 #ifdef _DEBUG
     void Display(void) const
     {
-        Logger::GtLogInfo("Vector2 content:");
-        Logger::GtLog("%f8.3 %f8.3", x, y);
+        GT_LOG_INFO("Vector2 content:");
+        GT_LOG_DEBUG("%f8.3 %f8.3", x, y);
     }
 #endif
 };
@@ -278,8 +278,8 @@ public:
 #ifdef _DEBUG
     void Display(void) const
     {
-        Logger::GtLogInfo("Vector3 content:");
-        Logger::GtLog("%8.3f %8.3f %8.3f", x, y, z);
+        GT_LOG_INFO("Vector3 content:");
+        GT_LOG_DEBUG("%8.3f %8.3f %8.3f", x, y, z);
     }
 #endif
 };
@@ -437,8 +437,8 @@ public:
 #ifdef _DEBUG
     void Display(void) const
     {
-        Logger::GtLogInfo("Vector4 content:");
-        Logger::GtLog("%8.3f %8.3f %8.3f %8.3f", x, y, z, w);
+        GT_LOG_INFO("Vector4 content:");
+        GT_LOG_DEBUG("%8.3f %8.3f %8.3f %8.3f", x, y, z, w);
     }
 #endif
 };